@@ -0,0 +1,84 @@
+#include "BackflushAnalyzer.h"
+
+#include <math.h>
+#include <algorithm>
+
+BackflushAnalyzer::BackflushAnalyzer()
+    : active(false), done(false), haveSample(false), initial(0), lastPressure(0), startMillis(0), lastMillis(0), integral(0), elapsed(0),
+      bandAnchor(0), bandSum(0), bandCount(0), bandStart(0), recovered(0), timeConstant(0) {
+}
+
+void BackflushAnalyzer::begin(uint32_t now) {
+    active = true;
+    done = false;
+    haveSample = false;
+    startMillis = now;
+    lastMillis = startMillis;
+    integral = 0;
+    elapsed = 0;
+    bandCount = 0;
+}
+
+bool BackflushAnalyzer::update(uint32_t now, float pressure) {
+    if (!active) {
+        return false;
+    }
+
+    if (!haveSample) {
+        initial = pressure;
+        haveSample = true;
+    } else {
+        float dt = (now - lastMillis) / 1000.0f;
+        integral += (pressure + lastPressure) / 2 * dt;
+        elapsed += dt;
+    }
+    lastMillis = now;
+    lastPressure = pressure;
+
+    // Restart the run whenever the pressure leaves the band around its start
+    if (bandCount == 0 || fabsf(pressure - bandAnchor) > SETTLE_BAND) {
+        bandAnchor = pressure;
+        bandSum = 0;
+        bandCount = 0;
+        bandStart = elapsed;
+    }
+    bandSum += pressure;
+    bandCount++;
+
+    if (elapsed - bandStart >= SETTLE_SECONDS || (now - startMillis) / 1000 >= MAX_SECONDS) {
+        finish();
+        return true;
+    }
+    return false;
+}
+
+void BackflushAnalyzer::finish() {
+    active = false;
+    done = true;
+    recovered = bandSum / bandCount;
+
+    // Area between the curve and the final level, over the initial offset
+    float step = initial - recovered;
+    if (fabsf(step) < SETTLE_BAND || elapsed <= 0) {
+        timeConstant = 0;
+    } else {
+        float area = (float)(integral - recovered * elapsed);
+        timeConstant = std::min(std::max(area / step, 0.0f), (float)MAX_SECONDS);
+    }
+}
+
+bool BackflushAnalyzer::getResult(float& recoveredPressure, float& timeConstantSeconds) const {
+    if (!done || recovered < MIN_RECOVERED) {
+        return false;
+    }
+    recoveredPressure = recovered;
+    timeConstantSeconds = timeConstant;
+    return true;
+}
+
+float BackflushAnalyzer::reductionPercent(float beforePressure, float recoveredPressure) {
+    if (beforePressure <= 0) {
+        return 0;
+    }
+    return (beforePressure - recoveredPressure) / beforePressure * 100.0f;
+}
@@ -0,0 +1,59 @@
+#ifndef BACKFLUSHANALYZER_H
+#define BACKFLUSHANALYZER_H
+
+#include <stdint.h>
+
+// Follows the live pressure after a backflush until it settles, and reports the
+// recovered pressure and the time constant of the recovery. Each sample is O(1):
+// for an exponential approach p(t) = final + (p0 - final) * exp(-t / tau), the
+// area between the curve and the final level is (p0 - final) * tau, so only the
+// running integral of the pressure has to be kept. The caller passes the time
+// (millis()), so tools/backflush-analyzer-test can check it on synthetic recoveries.
+class BackflushAnalyzer {
+private:
+    static const uint32_t SETTLE_SECONDS = 20;       // Pressure must stay within the band this long
+    static constexpr float SETTLE_BAND = 0.02f;      // bar
+    static const uint32_t MAX_SECONDS = 300;         // Give up waiting for the pressure to settle
+    static constexpr float MIN_RECOVERED = 0.05f;    // Lower means the pump is not running (bar)
+
+    bool active;
+    bool done;
+    bool haveSample;
+    float initial;           // First sample after the relay turned off
+    float lastPressure;
+    uint32_t startMillis;
+    uint32_t lastMillis;
+    double integral;         // Integral of the pressure since the first sample (bar*s)
+    float elapsed;           // Seconds since the first sample
+
+    // Current run of samples within SETTLE_BAND of its first sample
+    float bandAnchor;
+    float bandSum;
+    uint32_t bandCount;
+    float bandStart;         // Seconds since the first sample when the run began
+
+    float recovered;
+    float timeConstant;
+
+    void finish();
+
+public:
+    BackflushAnalyzer();
+
+    // Start following the pressure once the relay has turned off
+    void begin(uint32_t now);
+    void cancel() { active = false; }
+
+    // Feed a live sample; returns true once, when the result becomes available
+    bool update(uint32_t now, float pressure);
+
+    bool isActive() const { return active; }
+
+    // Result of the last completed analysis; false if the pump was not running
+    bool getResult(float& recoveredPressure, float& timeConstantSeconds) const;
+
+    // Reduction from the pressure before the flush, in percent
+    static float reductionPercent(float beforePressure, float recoveredPressure);
+};
+
+#endif // BACKFLUSHANALYZER_H
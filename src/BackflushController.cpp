@@ -0,0 +1,104 @@
+#include "BackflushController.h"
+
+BackflushController::BackflushController()
+    : state(IDLE), armed(true), requested(false), lastRequested(false),
+      startedAt(0), endedAt(0), duration(0), day(0), flushesToday(0) {
+    guard.threshold = 2.0f;
+    guard.hysteresis = 0.2f;
+    guard.settleSeconds = 60;
+    guard.lockoutSeconds = 3600;
+    guard.maxPerDay = 0;
+}
+
+void BackflushController::start(uint32_t now, uint32_t durationSeconds, bool onRequest) {
+    state = FLUSHING;
+    startedAt = now;
+    duration = durationSeconds;
+    lastRequested = onRequest;
+    requested = false;
+    armed = false;
+    if (!onRequest) {
+        flushesToday++;
+    }
+}
+
+void BackflushController::end(uint32_t now) {
+    state = SETTLING;
+    endedAt = now;
+}
+
+BackflushController::Action BackflushController::update(uint32_t now, float pressure, uint32_t currentDay, uint32_t durationSeconds) {
+    if (currentDay != day) {
+        day = currentDay;
+        flushesToday = 0;
+    }
+
+    switch (state) {
+        case FLUSHING:
+            if (now - startedAt >= duration * 1000) {
+                end(now);
+                return STOP;
+            }
+            return NONE;
+        case SETTLING:
+            if (now - endedAt < guard.settleSeconds * 1000) {
+                break;
+            }
+            state = LOCKOUT;
+            // fall through
+        case LOCKOUT:
+            if (now - endedAt >= guard.lockoutSeconds * 1000) {
+                state = IDLE;
+            }
+            break;
+        case IDLE:
+            break;
+    }
+
+    // Requested flushes only wait for the current one to finish
+    if (requested) {
+        start(now, durationSeconds, true);
+        return START;
+    }
+
+    // The smoothed pressure still lags the flush while settling
+    if (state == SETTLING) {
+        return NONE;
+    }
+    if (!armed && pressure < guard.threshold - guard.hysteresis) {
+        armed = true;
+    }
+
+    if (state == IDLE && armed && pressure >= guard.threshold) {
+        if (isDailyLimitReached()) {
+            return NONE;
+        }
+        start(now, durationSeconds, false);
+        return START;
+    }
+    return NONE;
+}
+
+void BackflushController::stop(uint32_t now) {
+    if (state == FLUSHING) {
+        end(now);
+    }
+}
+
+uint32_t BackflushController::getLockoutRemaining(uint32_t now) const {
+    if (state == IDLE || state == FLUSHING) {
+        return 0;
+    }
+    uint32_t elapsed = (now - endedAt) / 1000;
+    return elapsed < guard.lockoutSeconds ? guard.lockoutSeconds - elapsed : 0;
+}
+
+const char* BackflushController::stateName(State state) {
+    switch (state) {
+        case IDLE:     return "idle";
+        case FLUSHING: return "flushing";
+        case SETTLING: return "settling";
+        case LOCKOUT:  return "lockout";
+    }
+    return "unknown";
+}
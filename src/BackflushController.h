@@ -0,0 +1,90 @@
+#ifndef BACKFLUSHCONTROLLER_H
+#define BACKFLUSHCONTROLLER_H
+
+// Decides when the backflush relay turns on and off.
+//
+//   IDLE -> FLUSHING -> SETTLING -> LOCKOUT -> IDLE
+//
+// A flush starts automatically when the pressure reaches the threshold, or on
+// request (manual, scheduled, predictive). After it ends the pressure is ignored
+// for the settle window, as the smoothed value still lags the flush, and no
+// automatic flush starts until the lockout has passed. The automatic trigger
+// then only re-arms once the pressure has dropped below the threshold by the
+// hysteresis, and at most maxPerDay automatic flushes run per day.
+// Times and days come from the caller; tools/backflush-controller-test checks
+// the transitions with synthetic traces.
+
+#include <stdint.h>
+
+struct BackflushGuard {
+    float threshold;         // Automatic trigger pressure (bar)
+    float hysteresis;        // Re-arm below threshold - hysteresis (bar)
+    uint32_t settleSeconds;  // Pressure ignored this long after a flush
+    uint32_t lockoutSeconds; // No automatic flush this long after a flush
+    uint8_t maxPerDay;       // Automatic flushes per day, 0 = unlimited
+};
+
+class BackflushController {
+public:
+    enum State {
+        IDLE,
+        FLUSHING,
+        SETTLING,
+        LOCKOUT
+    };
+
+    enum Action {
+        NONE,
+        START,               // Turn the relay on
+        STOP                 // Turn the relay off, the duration has passed
+    };
+
+private:
+    BackflushGuard guard;
+    State state;
+    bool armed;              // Automatic trigger allowed once the pressure reaches the threshold
+    bool requested;          // A flush was requested regardless of the pressure
+    bool lastRequested;      // Whether the current/last flush was requested
+    uint32_t startedAt;      // millis() when the flush started
+    uint32_t endedAt;        // millis() when the flush ended
+    uint32_t duration;       // Seconds
+    uint32_t day;            // Day the flush count belongs to
+    uint8_t flushesToday;    // Automatic flushes
+
+    void start(uint32_t now, uint32_t durationSeconds, bool onRequest);
+    void end(uint32_t now);
+
+public:
+    BackflushController();
+
+    void configure(const BackflushGuard& flushGuard) { guard = flushGuard; }
+    void setThreshold(float threshold) { guard.threshold = threshold; }
+    const BackflushGuard& getGuard() const { return guard; }
+
+    // Ask for a flush regardless of the pressure, the lockout and the daily limit
+    void request() { requested = true; }
+
+    // Advance with the current time, pressure and day number. durationSeconds is
+    // used if a flush starts now.
+    Action update(uint32_t now, float pressure, uint32_t currentDay, uint32_t durationSeconds);
+
+    // End the flush early (adaptive duration, or stopped from the web page)
+    void stop(uint32_t now);
+
+    State getState() const { return state; }
+    bool isArmed() const { return armed; }
+    bool wasRequested() const { return lastRequested; }
+    uint8_t getFlushesToday() const { return flushesToday; }
+    bool isDailyLimitReached() const { return guard.maxPerDay > 0 && flushesToday >= guard.maxPerDay; }
+
+    // Seconds until an automatic flush is allowed again, 0 if it is
+    uint32_t getLockoutRemaining(uint32_t now) const;
+
+    // Day number for update() of a local time (TimeManager::getCurrentTime()),
+    // so the daily limit resets at local midnight rather than midnight UTC
+    static uint32_t dayOf(int64_t localTime) { return localTime / 86400; }
+
+    static const char* stateName(State state);
+};
+
+#endif // BACKFLUSHCONTROLLER_H
@@ -1,9 +1,11 @@
 #include "BackflushLogger.h"
 
-const char* BackflushLogger::LOG_FILE = "/backflush_log.json";
+const char* BackflushLogger::LOG_FILE = "/backflush_log.bin";
+const char* BackflushLogger::LEGACY_LOG_FILE = "/backflush_log.json";
 
-BackflushLogger::BackflushLogger(TimeManager& tm) 
-    : timeManager(tm), initialized(false) {
+BackflushLogger::BackflushLogger(TimeManager& tm)
+    : timeManager(tm), oldestSlot(0), count(0), nextSequence(0), initialized(false), lastSlot(0) {
+    memset(&lastRecord, 0, sizeof(lastRecord));
 }
 
 void BackflushLogger::begin() {
@@ -12,278 +14,407 @@ void BackflushLogger::begin() {
         Serial.println("Failed to mount file system");
         return;
     }
-    
-    // Load existing events
-    if (loadEvents()) {
-        Serial.println("Backflush events loaded successfully");
-        Serial.print("Number of events: ");
-        Serial.println(events.size());
-    } else {
-        Serial.println("No backflush events found or error loading events");
-        events.clear();
+
+    // Open the ring, moving the JSON log of older firmware into it
+    if (!openLog()) {
+        Serial.println("Failed to open backflush log");
+        return;
     }
-    
     initialized = true;
+
+    if (LittleFS.exists(LEGACY_LOG_FILE) && migrateLegacyLog()) {
+        LittleFS.remove(LEGACY_LOG_FILE);
+    }
+
+    Serial.print("Backflush events: ");
+    Serial.println(count);
 }
 
-bool BackflushLogger::loadEvents() {
-    // Check if file exists
+bool BackflushLogger::openLog() {
     if (!LittleFS.exists(LOG_FILE)) {
-        return false;
+        return createLog();
     }
-    
-    // Open file for reading
+
     File file = LittleFS.open(LOG_FILE, "r");
     if (!file) {
         return false;
     }
-    
-    // Parse JSON
-    DynamicJsonDocument doc(16384); // Adjust size as needed
+
+    BackflushFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != LOG_FILE_MAGIC || header.version != LOG_FILE_VERSION || header.headerSize != sizeof(BackflushFileHeader) ||
+        header.recordSize != sizeof(BackflushRecord) || header.capacity != MAX_EVENTS) {
+        file.close();
+        Serial.println("Invalid backflush log, starting a new one");
+        return createLog();
+    }
+
+    // A partly written record at the end (power loss) is ignored and overwritten later
+    size_t slots = min((size_t)((file.size() - sizeof(header)) / sizeof(BackflushRecord)), (size_t)MAX_EVENTS);
+    count = slots;
+    oldestSlot = 0;
+
+    if (slots == MAX_EVENTS) {
+        // Once the ring has wrapped, the slots before the oldest one are the newest
+        // lap, numbered on from slot 0; binary search for the first one that is not
+        BackflushRecord first, record;
+        size_t lo = 1, hi = MAX_EVENTS;
+        if (readRecord(file, 0, first)) {
+            while (lo < hi) {
+                size_t m = (lo + hi) / 2;
+                if (!readRecord(file, m, record)) {
+                    break;
+                }
+                if ((uint16_t)(record.sequence - first.sequence) == m) {
+                    lo = m + 1;
+                } else {
+                    hi = m;
+                }
+            }
+        }
+        oldestSlot = lo % MAX_EVENTS;
+    }
+
+    nextSequence = 0;
+    if (count > 0) {
+        lastSlot = (oldestSlot + count - 1) % MAX_EVENTS;
+        readRecord(file, lastSlot, lastRecord);
+        nextSequence = lastRecord.sequence + 1;
+    }
+    file.close();
+    return true;
+}
+
+bool BackflushLogger::createLog() {
+    File file = LittleFS.open(LOG_FILE, "w");
+    if (!file) {
+        return false;
+    }
+
+    BackflushFileHeader header;
+    header.magic = LOG_FILE_MAGIC;
+    header.version = LOG_FILE_VERSION;
+    header.headerSize = sizeof(BackflushFileHeader);
+    header.recordSize = sizeof(BackflushRecord);
+    header.capacity = MAX_EVENTS;
+    header.reserved = 0;
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    file.close();
+
+    oldestSlot = 0;
+    count = 0;
+    nextSequence = 0;
+    analyzer.cancel();
+    return ok;
+}
+
+bool BackflushLogger::migrateLegacyLog() {
+    File file = LittleFS.open(LEGACY_LOG_FILE, "r");
+    if (!file) {
+        return false;
+    }
+
+    // Older firmware kept at most 20 events, so the document stays small
+    JsonDocument doc;
     DeserializationError error = deserializeJson(doc, file);
     file.close();
-    
+
     if (error) {
         Serial.print("Failed to parse backflush log: ");
         Serial.println(error.c_str());
         return false;
     }
-    
-    // Clear existing events
-    events.clear();
-    
-    // Read events from JSON
+
     JsonArray eventsArray = doc["events"].as<JsonArray>();
     for (JsonObject eventObj : eventsArray) {
-        BackflushEvent event;
-        event.timestamp = eventObj["timestamp"].as<time_t>();
-        event.pressure = eventObj["pressure"].as<float>();
-        event.duration = eventObj["duration"].as<unsigned int>();
-        
-        // Load type if available, default to "Auto" for backward compatibility
-        if (eventObj.containsKey("type")) {
-            event.type = eventObj["type"].as<String>();
-        } else {
-            event.type = "Auto";
-        }
-        
-        events.push_back(event);
+        BackflushRecord record;
+        memset(&record, 0, sizeof(record));
+        record.timestamp = eventObj["timestamp"].as<uint32_t>();
+        record.pressure = encodePressure(eventObj["pressure"].as<float>());
+        record.duration = eventObj["duration"].as<unsigned int>();
+        record.type = parseType(eventObj["type"] | "Auto");
+        record.flags = BACKFLUSH_FLAG_COMPLETED;
+        lastSlot = appendRecord(record);
+        lastRecord = record;
     }
-    
+
+    Serial.print("Migrated ");
+    Serial.print(eventsArray.size());
+    Serial.println(" backflush events");
     return true;
 }
 
-bool BackflushLogger::saveEvents() {
-    // Create JSON document
-    DynamicJsonDocument doc(16384); // Adjust size as needed
-    
-    // Create events array
-    JsonArray eventsArray = doc.createNestedArray("events");
-    
-    // Add events to array
-    for (const BackflushEvent& event : events) {
-        JsonObject eventObj = eventsArray.createNestedObject();
-        eventObj["timestamp"] = event.timestamp;
-        eventObj["pressure"] = event.pressure;
-        eventObj["duration"] = event.duration;
-        eventObj["type"] = event.type.length() > 0 ? event.type : "Auto";
-    }
-    
-    // Open file for writing
-    File file = LittleFS.open(LOG_FILE, "w");
+bool BackflushLogger::readRecord(File& file, size_t slot, BackflushRecord& record) {
+    return file.seek(sizeof(BackflushFileHeader) + slot * sizeof(BackflushRecord), SeekSet) &&
+           file.read((uint8_t*)&record, sizeof(record)) == sizeof(record);
+}
+
+bool BackflushLogger::writeRecord(size_t slot, const BackflushRecord& record) {
+    File file = LittleFS.open(LOG_FILE, "r+");
     if (!file) {
+        Serial.println("Failed to open backflush log for writing");
         return false;
     }
-    
-    // Serialize JSON to file
-    if (serializeJson(doc, file) == 0) {
-        file.close();
+
+    bool ok = file.seek(sizeof(BackflushFileHeader) + slot * sizeof(BackflushRecord), SeekSet) &&
+              file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Failed to write backflush log");
+    }
+    return ok;
+}
+
+size_t BackflushLogger::appendRecord(BackflushRecord& record) {
+    record.sequence = nextSequence++;
+
+    // Fill the ring, then overwrite the oldest record
+    size_t slot = (oldestSlot + count) % MAX_EVENTS;
+    if (count < MAX_EVENTS) {
+        count++;
+    } else {
+        oldestSlot = (oldestSlot + 1) % MAX_EVENTS;
+    }
+
+    writeRecord(slot, record);
+    return slot;
+}
+
+BackflushEvent BackflushLogger::toEvent(const BackflushRecord& record) {
+    BackflushEvent event;
+    event.timestamp = record.timestamp;
+    event.pressure = decodePressure(record.pressure);
+    event.postPressure = (record.flags & BACKFLUSH_FLAG_RECOVERY) ? decodePressure(record.postPressure) : NAN;
+    event.recoveryTau = (record.flags & BACKFLUSH_FLAG_RECOVERY) ? record.recoveryTau / 10.0f : NAN;
+    event.duration = record.duration;
+    event.type = (BackflushType)record.type;
+    return event;
+}
+
+void BackflushLogger::logEvent(float pressure, unsigned int duration, BackflushType type) {
+    if (!initialized || !timeManager.isTimeInitialized()) {
+        return;
+    }
+
+    // Create new record with GMT timestamp
+    BackflushRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = timeManager.getCurrentGMTTime();
+    record.pressure = encodePressure(pressure);
+    record.duration = min(duration, 0xFFFFu);
+    record.type = type;
+
+    lastSlot = appendRecord(record);
+    lastRecord = record;
+    analyzer.cancel();
+}
+
+void BackflushLogger::logSkipped(float pressure) {
+    if (!initialized || !timeManager.isTimeInitialized()) {
+        return;
+    }
+
+    BackflushRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = timeManager.getCurrentGMTTime();
+    record.pressure = encodePressure(pressure);
+    record.type = BACKFLUSH_SKIPPED;
+    record.flags = BACKFLUSH_FLAG_COMPLETED;
+
+    // The ring may overwrite the last backflush only once it holds nothing else
+    size_t slot = appendRecord(record);
+    if (slot == lastSlot) {
+        lastRecord = record;
+    }
+}
+
+bool BackflushLogger::getLastRecoveredPressure(float& pressure) const {
+    if (count == 0 || lastRecord.type == BACKFLUSH_SKIPPED || !(lastRecord.flags & BACKFLUSH_FLAG_RECOVERY)) {
         return false;
     }
-    
-    file.close();
+
+    pressure = decodePressure(lastRecord.postPressure);
     return true;
 }
 
-void BackflushLogger::logEvent(float pressure, unsigned int duration, const String& type) {
-    if (!initialized || !timeManager.isTimeInitialized()) {
+void BackflushLogger::endEvent(unsigned int actualDuration) {
+    if (!initialized || count == 0 || (lastRecord.flags & BACKFLUSH_FLAG_COMPLETED)) {
         return;
     }
-    
-    // Create new event with GMT timestamp
-    BackflushEvent event;
-    event.timestamp = timeManager.getCurrentGMTTime();
-    event.pressure = pressure;
-    event.duration = duration;
-    event.type = type;
-    
-    // Add to events list
-    events.push_back(event);
-    
-    // If we have too many events, trim them
-    if (events.size() > MAX_EVENTS) {
-        trimOldEvents(MAX_EVENTS);
+
+    lastRecord.duration = min(actualDuration, 0xFFFFu);
+    lastRecord.flags |= BACKFLUSH_FLAG_COMPLETED;
+    writeRecord(lastSlot, lastRecord);
+
+    analyzer.begin(millis());
+}
+
+void BackflushLogger::update(float currentPressure) {
+    if (!analyzer.update(millis(), currentPressure)) {
+        return;
+    }
+
+    // Store the recovery with the event; nothing is stored if the pump was not running
+    float recovered, timeConstant;
+    if (analyzer.getResult(recovered, timeConstant)) {
+        Serial.print("Backflush recovery: ");
+        Serial.print(recovered, 2);
+        Serial.print(" bar, tau ");
+        Serial.print(timeConstant, 1);
+        Serial.println(" s");
+
+        lastRecord.postPressure = encodePressure(recovered);
+        lastRecord.recoveryTau = (uint16_t)lroundf(timeConstant * 10);
+        lastRecord.flags |= BACKFLUSH_FLAG_RECOVERY;
+        writeRecord(lastSlot, lastRecord);
     }
-    
-    // Check available space
-    checkSpaceAndTrim();
-    
-    // Save events to file
-    saveEvents();
 }
 
-String BackflushLogger::getEventsAsJson() {
-    DynamicJsonDocument doc(16384); // Adjust size as needed
-    
+size_t BackflushLogger::getEvents(size_t skip, size_t limit, BackflushEventCallback callback) {
+    if (!initialized || skip >= count) {
+        return 0;
+    }
+
+    File file = LittleFS.open(LOG_FILE, "r");
+    if (!file) {
+        return 0;
+    }
+
+    size_t end = min(count, skip + limit);
+    size_t passed = 0;
+    for (size_t i = skip; i < end; i++) {
+        BackflushRecord record;
+        if (!readRecord(file, (oldestSlot + count - 1 - i) % MAX_EVENTS, record)) {
+            break;
+        }
+        callback(toEvent(record));
+        passed++;
+    }
+    file.close();
+    return passed;
+}
+
+String BackflushLogger::getEventsAsJson(size_t limit) {
+    JsonDocument doc;
+
     // Create events array
-    JsonArray eventsArray = doc.createNestedArray("events");
-    
-    // Add events to array
-    for (const BackflushEvent& event : events) {
-        JsonObject eventObj = eventsArray.createNestedObject();
+    JsonArray eventsArray = doc["events"].to<JsonArray>();
+
+    // Add the newest events to the array
+    getEvents(0, limit, [this, &eventsArray](const BackflushEvent& event) {
+        JsonObject eventObj = eventsArray.add<JsonObject>();
         eventObj["timestamp"] = event.timestamp;
-        
+
         // Format date and time
         char dateTime[20];
-        time_t t = event.timestamp;
-        time_t localt = timeManager.gmtToLocal(t);
+        time_t localt = timeManager.gmtToLocal(event.timestamp);
         struct tm* timeinfo = localtime(&localt);
-
         strftime(dateTime, sizeof(dateTime), "%Y-%m-%d %H:%M:%S", timeinfo);
-        
         eventObj["datetime"] = String(dateTime);
-        
+
         eventObj["pressure"] = event.pressure;
+        if (!isnan(event.postPressure)) {
+            eventObj["post_pressure"] = event.postPressure;
+        }
         eventObj["duration"] = event.duration;
-        eventObj["type"] = event.type.length() > 0 ? event.type : "Auto";
-    }
-    
+        eventObj["type"] = typeName(event.type);
+    });
+    doc["count"] = count;
+
     // Serialize JSON to string
     String jsonString;
     serializeJson(doc, jsonString);
     return jsonString;
 }
 
-String BackflushLogger::getEventsAsHtml() {
-    String html = "<table class='events-table'>\n";
-    html += "  <tr>\n";
-    html += "    <th>Date</th>\n";
-    html += "    <th>Time</th>\n";
-    html += "    <th>Pressure (bar)</th>\n";
-    html += "    <th>Duration (sec)</th>\n";
-    html += "    <th>Type</th>\n";
-    html += "  </tr>\n";
-    
-    // Sort events by timestamp (newest first)
-    std::vector<BackflushEvent> sortedEvents = events;
-    std::sort(sortedEvents.begin(), sortedEvents.end(), 
-              [](const BackflushEvent& a, const BackflushEvent& b) {
-                  return a.timestamp > b.timestamp;
-              });
-    
-    for (const BackflushEvent& event : sortedEvents) {
-        time_t t = timeManager.gmtToLocal(event.timestamp);
-        
-        struct tm* timeinfo = localtime(&t);
-        
-        char date[11];
-        sprintf(date, "%04d-%02d-%02d", 
-                timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday);
-        
-        char time[9];
-        sprintf(time, "%02d:%02d:%02d", 
-                timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
-        
-        html += "  <tr>\n";
-        html += "    <td>" + String(date) + "</td>\n";
-        html += "    <td>" + String(time) + "</td>\n";
-        html += "    <td>" + String(event.pressure, 1) + "</td>\n";
-        html += "    <td>" + String(event.duration) + "</td>\n";
-        html += "    <td>" + (event.type.length() > 0 ? event.type : "Auto") + "</td>\n";
-        html += "  </tr>\n";
+// Pressure with one decimal. Records hold encodePressure() values, never negative.
+static void formatTenths(char* buffer, size_t size, float value) {
+    long tenths = lroundf(value * 10);
+    snprintf(buffer, size, "%ld.%ld", tenths / 10, tenths % 10);
+}
+
+void BackflushLogger::writeEventsHtml(size_t skip, size_t limit, ChunkCallback sink) {
+    if (count == 0) {
+        static const char empty[] = "<p>No backflush events recorded yet.</p>\n";
+        sink(empty, sizeof(empty) - 1);
+        return;
     }
-    
-    html += "</table>\n";
-    
-    if (events.empty()) {
-        html = "<p>No backflush events recorded yet.</p>";
+
+    char chunk[HTML_CHUNK_SIZE];
+    size_t used = snprintf(chunk, sizeof(chunk),
+        "<table class='events-table'>\n"
+        "  <tr><th>Date</th><th>Time</th><th>Pressure (bar)</th><th>After (bar)</th><th>Recovery (sec)</th><th>Duration (sec)</th><th>Type</th></tr>\n");
+
+    // Rows are read newest first straight from the ring and formatted into the
+    // chunk, which is handed on whenever the next row would not fit
+    getEvents(skip, limit, [this, &chunk, &used, &sink](const BackflushEvent& event) {
+        time_t t = timeManager.gmtToLocal(event.timestamp);
+        int year, month, day;
+        TimeManager::civilFromDays(t / 86400, year, month, day);
+        uint32_t seconds = t % 86400;
+
+        char pressure[12];
+        char after[12] = "-";
+        char recovery[8] = "-";
+        formatTenths(pressure, sizeof(pressure), event.pressure);
+        if (!isnan(event.postPressure)) {
+            formatTenths(after, sizeof(after), event.postPressure);
+            snprintf(recovery, sizeof(recovery), "%ld", lroundf(event.recoveryTau));
+        }
+
+        char row[160];
+        int length = snprintf(row, sizeof(row),
+            "  <tr><td>%04d-%02d-%02d</td><td>%02u:%02u:%02u</td><td>%s</td><td>%s</td><td>%s</td><td>%u</td><td>%s</td></tr>\n",
+            year, month, day, seconds / 3600, seconds / 60 % 60, seconds % 60,
+            pressure, after, recovery, event.duration, typeName(event.type));
+        length = min(length, (int)sizeof(row) - 1);
+
+        if (used + length > sizeof(chunk)) {
+            sink(chunk, used);
+            used = 0;
+        }
+        memcpy(chunk + used, row, length);
+        used += length;
+    });
+
+    static const char tableEnd[] = "</table>\n";
+    if (used + sizeof(tableEnd) - 1 > sizeof(chunk)) {
+        sink(chunk, used);
+        used = 0;
     }
-    
-    return html;
+    memcpy(chunk + used, tableEnd, sizeof(tableEnd) - 1);
+    used += sizeof(tableEnd) - 1;
+    sink(chunk, used);
 }
 
 bool BackflushLogger::clearEvents() {
-    // Clear events
-    events.clear();
-    
-    // Delete file
+    // Delete file and start an empty ring
     if (LittleFS.exists(LOG_FILE)) {
         if (!LittleFS.remove(LOG_FILE)) {
             Serial.println("Failed to delete backflush log file");
             return false;
         }
     }
-    
-    return true;
-}
 
-void BackflushLogger::trimOldEvents(size_t maxEvents) {
-    if (events.size() <= maxEvents) {
-        return;
-    }
-    
-    // Calculate how many events to remove
-    size_t entriesToRemove = events.size() - maxEvents;
-    
-    // Remove oldest events
-    events.erase(events.begin(), events.begin() + entriesToRemove);
-    
-    Serial.print("Trimmed ");
-    Serial.print(entriesToRemove);
-    Serial.println(" old backflush events");
+    return createLog();
 }
 
-bool BackflushLogger::checkSpaceAndTrim() {
-    // Check if filesystem space is low
-    if (checkFileSystemSpace()) {
-        Serial.println("Low space detected, trimming backflush logs");
-        
-        // If we have events, trim them
-        if (!events.empty()) {
-            // Keep only half of the events
-            size_t keepEvents = events.size() / 2;
-            if (keepEvents < 10) {
-                keepEvents = 10; // Keep at least 10 events
-            }
-            trimOldEvents(keepEvents);
-            saveEvents();
-        }
-        
-        return true;
-    }
-    
-    return false;
+BackflushType BackflushLogger::parseType(const String& name) {
+    if (name == "Manual") return BACKFLUSH_MANUAL;
+    if (name == "Scheduled") return BACKFLUSH_SCHEDULED;
+    if (name == "Predictive") return BACKFLUSH_PREDICTIVE;
+    if (name == "Skipped") return BACKFLUSH_SKIPPED;
+    return BACKFLUSH_AUTO;
 }
 
-bool BackflushLogger::checkFileSystemSpace() {
-    FSInfo fs_info;
-    if (!LittleFS.info(fs_info)) {
-        Serial.println("Failed to get filesystem info");
-        return false;
+const char* BackflushLogger::typeName(BackflushType type) {
+    switch (type) {
+        case BACKFLUSH_AUTO:       return "Auto";
+        case BACKFLUSH_MANUAL:     return "Manual";
+        case BACKFLUSH_SCHEDULED:  return "Scheduled";
+        case BACKFLUSH_PREDICTIVE: return "Predictive";
+        case BACKFLUSH_SKIPPED:    return "Skipped";
     }
-    
-    // Calculate available space in KB
-    size_t freeSpace = fs_info.totalBytes - fs_info.usedBytes;
-    size_t freeSpaceKB = freeSpace / 1024;
-    
-    Serial.print("LittleFS: ");
-    Serial.print(fs_info.usedBytes / 1024);
-    Serial.print("KB used, ");
-    Serial.print(freeSpaceKB);
-    Serial.print("KB free, ");
-    Serial.print(fs_info.totalBytes / 1024);
-    Serial.println("KB total");
-    
-    // Return true if free space is less than 10% of total
-    return (freeSpace < (fs_info.totalBytes / 10));
+    return "Auto";
 }
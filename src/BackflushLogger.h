@@ -4,51 +4,129 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
-#include <vector>
+#include <functional>
 #include "TimeManager.h"
+#include "PressureRecord.h"
+#include "BackflushAnalyzer.h"
+
+// What started a backflush
+enum BackflushType : uint8_t {
+    BACKFLUSH_AUTO = 0,       // Pressure reached the threshold
+    BACKFLUSH_MANUAL = 1,
+    BACKFLUSH_SCHEDULED = 2,
+    BACKFLUSH_PREDICTIVE = 3,
+    BACKFLUSH_SKIPPED = 4     // Scheduled run skipped, a condition was not met (duration 0)
+};
+
+// BackflushRecord::flags bits
+static const uint8_t BACKFLUSH_FLAG_COMPLETED = 0x01;     // duration is the actual one
+static const uint8_t BACKFLUSH_FLAG_RECOVERY = 0x02;      // postPressure and recoveryTau are valid
+
+// One backflush in the on-flash ring, all fields little-endian
+struct __attribute__((packed)) BackflushRecord {
+    uint32_t timestamp;      // GMT seconds since epoch
+    uint16_t pressure;       // Trigger pressure, bar * PRESSURE_SCALE
+    uint16_t postPressure;   // Recovered pressure after the flush, bar * PRESSURE_SCALE
+    uint16_t duration;       // Seconds
+    uint8_t type;            // BackflushType
+    uint8_t flags;           // BACKFLUSH_FLAG_* bits
+    uint16_t recoveryTau;    // Time constant of the recovery, tenths of a second
+    uint16_t sequence;       // Write order, wrapping; orders the ring even if the clock stepped back
+};
+
+struct __attribute__((packed)) BackflushFileHeader {
+    uint32_t magic;          // "PFBF"
+    uint16_t version;
+    uint16_t headerSize;     // sizeof(BackflushFileHeader)
+    uint16_t recordSize;     // sizeof(BackflushRecord)
+    uint16_t capacity;       // Number of record slots before the ring wraps
+    uint32_t reserved;
+};
+
+static_assert(sizeof(BackflushRecord) == 16, "BackflushRecord must be 16 bytes");
+static_assert(sizeof(BackflushFileHeader) == 16, "BackflushFileHeader must be 16 bytes");
 
 // Structure to hold backflush event data
 struct BackflushEvent {
     time_t timestamp;
     float pressure;
+    float postPressure;      // Recovered pressure, NAN until measured
+    float recoveryTau;       // Seconds, NAN until measured
     unsigned int duration;
-    String type;  // "Auto" or "Manual"
+    BackflushType type;
 };
 
+typedef std::function<void(const BackflushEvent&)> BackflushEventCallback;
+typedef std::function<void(const char* data, size_t length)> ChunkCallback;
+
+// Backflush history in a fixed-size ring file of binary records. Only the ring
+// position is kept in RAM; events are read from flash when they are displayed.
 class BackflushLogger {
 private:
     static const char* LOG_FILE;
-    static const size_t MAX_EVENTS = 20; // Maximum number of events to store
-    
+    static const char* LEGACY_LOG_FILE; // JSON log written by older firmware
+    static const uint32_t LOG_FILE_MAGIC = 0x46424650; // "PFBF"
+    static const uint16_t LOG_FILE_VERSION = 1;
+    static const size_t MAX_EVENTS = 2048; // 32 KB of records
+    static const size_t HTML_CHUNK_SIZE = 512; // Stack buffer for the log table, about three rows
+
     TimeManager& timeManager;
-    std::vector<BackflushEvent> events;
+    size_t oldestSlot;   // Slot of the oldest record
+    size_t count;        // Records in the ring
+    uint16_t nextSequence;
     bool initialized;
-    
-    bool loadEvents();
-    bool saveEvents();
-    void trimOldEvents(size_t maxEvents);
-    
+
+    // Most recent event, completed after it has finished
+    BackflushRecord lastRecord;
+    size_t lastSlot;
+    BackflushAnalyzer analyzer; // Follows the pressure after the last flush
+
+    bool openLog();
+    bool createLog();
+    bool migrateLegacyLog();
+    bool readRecord(File& file, size_t slot, BackflushRecord& record);
+    bool writeRecord(size_t slot, const BackflushRecord& record);
+    size_t appendRecord(BackflushRecord& record);
+    static BackflushEvent toEvent(const BackflushRecord& record);
+
 public:
     BackflushLogger(TimeManager& tm);
-    
+
     void begin();
-    void logEvent(float pressure, unsigned int duration, const String& type = "Auto");
+    void logEvent(float pressure, unsigned int duration, BackflushType type = BACKFLUSH_AUTO);
+
+    // Record the actual duration of the last event once it has finished, and
+    // follow the live pressure (fed to update()) until it has recovered
+    void endEvent(unsigned int actualDuration);
+    void update(float currentPressure);
+    bool isAnalyzing() const { return analyzer.isActive(); }
+    
+    // Record a scheduled run that was skipped; the last backflush stays the one
+    // followed by the analyzer
+    void logSkipped(float pressure);
     
+    // Pressure the filter recovered to after the last backflush, false if not measured
+    bool getLastRecoveredPressure(float& pressure) const;
+
+    // Events newest first, skipping the newest `skip`; returns how many were passed on
+    size_t getEvents(size_t skip, size_t limit, BackflushEventCallback callback);
+
     // Get events for web display
-    String getEventsAsJson();
-    String getEventsAsHtml();
+    String getEventsAsJson(size_t limit = 50);
     
+    // Log table of `limit` events newest first, starting `skip` events back, passed
+    // to the sink in chunks of at most HTML_CHUNK_SIZE bytes
+    void writeEventsHtml(size_t skip, size_t limit, ChunkCallback sink);
+
     // Clear all events
     bool clearEvents();
-    
+
     // Get event count
-    size_t getEventCount() const { return events.size(); }
-    
-    // Check available space
-    bool checkSpaceAndTrim();
-    
-    // Static method to check space on filesystem
-    static bool checkFileSystemSpace();
+    size_t getEventCount() const { return count; }
+
+    // Parse/format backflush type names ("Auto", "Manual", "Scheduled", "Predictive", "Skipped")
+    static BackflushType parseType(const String& name);
+    static const char* typeName(BackflushType type);
 };
 
 #endif // BACKFLUSHLOGGER_H
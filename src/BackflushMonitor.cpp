@@ -0,0 +1,75 @@
+#include "BackflushMonitor.h"
+
+BackflushMonitor::BackflushMonitor()
+    : active(false), reason(RUNNING), haveSample(false), lastSeconds(0), level(0), trend(0), peak(0), metSince(-1) {
+    criteria.minSeconds = 0;
+    criteria.maxSeconds = 0;
+    criteria.maxSlope = 0;
+    criteria.minDropPercent = 0;
+    criteria.holdSeconds = 0;
+}
+
+void BackflushMonitor::begin(const BackflushCriteria& flushCriteria) {
+    criteria = flushCriteria;
+    active = true;
+    reason = RUNNING;
+    haveSample = false;
+    trend = 0;
+    peak = 0;
+    metSince = -1;
+}
+
+bool BackflushMonitor::update(float seconds, float pressure) {
+    if (!active) {
+        return false;
+    }
+
+    // Holt's double exponential smoothing, with the gains scaled by the sample interval
+    if (!haveSample) {
+        level = pressure;
+        haveSample = true;
+    } else if (seconds > lastSeconds) {
+        float dt = seconds - lastSeconds;
+        float alpha = 1.0f - expf(-dt / LEVEL_SMOOTHING);
+        float beta = 1.0f - expf(-dt / TREND_SMOOTHING);
+        float previous = level;
+        level = alpha * pressure + (1.0f - alpha) * (level + trend * dt);
+        trend = beta * (level - previous) / dt + (1.0f - beta) * trend;
+    }
+    lastSeconds = seconds;
+    if (level > peak) {
+        peak = level;
+    }
+
+    if (seconds >= criteria.maxSeconds) {
+        reason = MAX_DURATION;
+        active = false;
+        return true;
+    }
+
+    // Settled: flat enough and far enough below the peak
+    bool met = fabsf(getSlopePerMinute()) <= criteria.maxSlope && getDropPercent() >= criteria.minDropPercent;
+    if (!met) {
+        metSince = -1;
+        return false;
+    }
+    if (metSince < 0) {
+        metSince = seconds;
+    }
+
+    if (seconds >= criteria.minSeconds && seconds - metSince >= criteria.holdSeconds) {
+        reason = RECOVERED;
+        active = false;
+        return true;
+    }
+    return false;
+}
+
+const char* BackflushMonitor::stopReasonName(StopReason reason) {
+    switch (reason) {
+        case RUNNING:      return "running";
+        case RECOVERED:    return "recovered";
+        case MAX_DURATION: return "max_duration";
+    }
+    return "unknown";
+}
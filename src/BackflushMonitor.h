@@ -0,0 +1,61 @@
+#ifndef BACKFLUSHMONITOR_H
+#define BACKFLUSHMONITOR_H
+
+// Closed-loop backflush duration: follows the pressure while the flush runs and
+// decides when the filter bed has cleared, within min/max bounds.
+// Depends only on the C++ standard library so recorded traces can be replayed on
+// the host (see tools/backflush-replay).
+
+#include <stdint.h>
+#include <math.h>
+
+struct BackflushCriteria {
+    uint16_t minSeconds;     // Never stop earlier
+    uint16_t maxSeconds;     // Always stop by then
+    float maxSlope;          // Pressure counts as settled below this rate of change (bar/min)
+    float minDropPercent;    // ...once it has fallen this far below its peak during the flush
+    uint16_t holdSeconds;    // Criteria must hold this long before stopping
+};
+
+class BackflushMonitor {
+public:
+    enum StopReason {
+        RUNNING,
+        RECOVERED,           // Pressure and slope met the criteria
+        MAX_DURATION
+    };
+
+private:
+    static constexpr float LEVEL_SMOOTHING = 3.0f;  // Time constant of the level (seconds)
+    static constexpr float TREND_SMOOTHING = 10.0f; // Time constant of the slope (seconds)
+
+    BackflushCriteria criteria;
+    bool active;
+    StopReason reason;
+    bool haveSample;
+    float lastSeconds;
+    float level;             // Smoothed pressure (bar)
+    float trend;             // Smoothed slope (bar/s)
+    float peak;              // Highest smoothed pressure so far
+    float metSince;          // Seconds when the criteria were first met, < 0 if not met
+
+public:
+    BackflushMonitor();
+
+    void begin(const BackflushCriteria& flushCriteria);
+    void cancel() { active = false; reason = RUNNING; }
+    bool isActive() const { return active; }
+
+    // Feed a sample taken `seconds` after the flush started; returns true once
+    // the flush should stop
+    bool update(float seconds, float pressure);
+
+    StopReason getStopReason() const { return reason; }
+    float getLevel() const { return level; }
+    float getSlopePerMinute() const { return trend * 60.0f; }
+    float getDropPercent() const { return peak > 0 ? (peak - level) / peak * 100.0f : 0; }
+
+    static const char* stopReasonName(StopReason reason);
+};
+
+#endif // BACKFLUSHMONITOR_H
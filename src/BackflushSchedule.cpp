@@ -0,0 +1,286 @@
+#include "BackflushSchedule.h"
+#include "CivilDate.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Every day that exists in the calendar (even February 29th) occurs within this many days
+static const int MAX_SEARCH_DAYS = 8 * 366;
+
+static const uint64_t ALL_MINUTES = (1ULL << 60) - 1;
+static const uint32_t ALL_HOURS = (1UL << 24) - 1;
+static const uint32_t ALL_MONTH_DAYS = 0xFFFFFFFEUL;
+static const uint16_t ALL_MONTHS = 0x1FFE;
+static const uint8_t ALL_WEEK_DAYS = 0x7F;
+
+// Lowest set bit at or above `from`, -1 if there is none
+static int firstBit(uint64_t bits, int from) {
+    if (from >= 64) {
+        return -1;
+    }
+    bits &= ~0ULL << from;
+    return bits ? __builtin_ctzll(bits) : -1;
+}
+
+static int lowestBit(uint64_t bits) {
+    return bits ? __builtin_ctzll(bits) : 0;
+}
+
+void compileSchedule(BackflushSchedule& schedule) {
+    CronMask& mask = schedule.mask;
+    mask.minutes = 1ULL << schedule.minute;
+    mask.hours = 1UL << schedule.hour;
+    mask.months = ALL_MONTHS;
+    mask.monthDays = ALL_MONTH_DAYS;
+    mask.weekDays = ALL_WEEK_DAYS;
+    mask.dayOr = false;
+
+    switch (schedule.type) {
+        case ScheduleType::WEEKLY:
+            mask.weekDays = schedule.daysActive & ALL_WEEK_DAYS;
+            break;
+        case ScheduleType::MONTHLY:
+            mask.monthDays = (schedule.daysActive << 1) & ALL_MONTH_DAYS;
+            break;
+        default:
+            break;
+    }
+}
+
+void decompileSchedule(BackflushSchedule& schedule) {
+    const CronMask& mask = schedule.mask;
+    schedule.minute = lowestBit(mask.minutes);
+    schedule.hour = lowestBit(mask.hours);
+
+    switch (schedule.type) {
+        case ScheduleType::WEEKLY:
+            schedule.daysActive = mask.weekDays;
+            break;
+        case ScheduleType::MONTHLY:
+            schedule.daysActive = mask.monthDays >> 1;
+            break;
+        default:
+            schedule.daysActive = 0;
+            break;
+    }
+}
+
+// Parse one comma separated field into bits min..max; false if it is invalid
+static bool parseCronField(const char* field, const char* end, int min, int max, uint64_t& bits) {
+    bits = 0;
+    const char* p = field;
+    while (p < end) {
+        int from, to, step = 1;
+        char* next;
+        if (*p == '*') {
+            from = min;
+            to = max;
+            p++;
+        } else {
+            from = strtol(p, &next, 10);
+            if (next == p) {
+                return false;
+            }
+            p = next;
+            // A single value with a step runs to the end of the range, as "5/15" does in cron
+            to = (p < end && *p == '/') ? max : from;
+            if (p < end && *p == '-') {
+                p++;
+                to = strtol(p, &next, 10);
+                if (next == p) {
+                    return false;
+                }
+                p = next;
+            }
+        }
+        if (p < end && *p == '/') {
+            p++;
+            step = strtol(p, &next, 10);
+            if (next == p || step < 1) {
+                return false;
+            }
+            p = next;
+        }
+        if (from < min || to > max || from > to) {
+            return false;
+        }
+        for (int value = from; value <= to; value += step) {
+            bits |= 1ULL << value;
+        }
+
+        if (p < end) {
+            // An item must follow each comma
+            if (*p != ',' || ++p == end) {
+                return false;
+            }
+        }
+    }
+    return bits != 0;
+}
+
+bool parseCronExpression(const char* expression, CronMask& mask) {
+    static const int MIN[] = {0, 0, 1, 1, 0};
+    static const int MAX[] = {59, 23, 31, 12, 7};
+
+    uint64_t fields[5];
+    bool restricted[5];
+    const char* p = expression;
+    for (int i = 0; i < 5; i++) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        const char* start = p;
+        while (*p && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        if (p == start || !parseCronField(start, p, MIN[i], MAX[i], fields[i])) {
+            return false;
+        }
+        restricted[i] = *start != '*';
+    }
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (*p) {
+        return false;
+    }
+
+    mask.minutes = fields[0];
+    mask.hours = fields[1];
+    mask.monthDays = fields[2];
+    mask.months = fields[3];
+    mask.weekDays = (fields[4] | (fields[4] >> 7)) & ALL_WEEK_DAYS; // 7 is Sunday too
+    mask.dayOr = restricted[2] && restricted[4];
+    return true;
+}
+
+// Format bits min..max as a cron field; `all` allows * for a full range
+static int formatCronField(uint64_t bits, int min, int max, bool all, char* buffer, size_t size) {
+    uint64_t full = ((max >= 63 ? ~0ULL : (1ULL << (max + 1)) - 1) >> min) << min;
+    if (all && (bits & full) == full) {
+        return snprintf(buffer, size, "*");
+    }
+
+    int length = 0;
+    for (int value = firstBit(bits, min); value >= 0 && value <= max; ) {
+        int last = value;
+        while (last < max && (bits & (1ULL << (last + 1)))) {
+            last++;
+        }
+        if (length > 0 && (size_t)length < size) {
+            length += snprintf(buffer + length, size - length, ",");
+        }
+        if ((size_t)length < size) {
+            if (last > value + 1) {
+                length += snprintf(buffer + length, size - length, "%d-%d", value, last);
+            } else if (last == value + 1) {
+                length += snprintf(buffer + length, size - length, "%d,%d", value, last);
+            } else {
+                length += snprintf(buffer + length, size - length, "%d", value);
+            }
+        }
+        value = firstBit(bits, last + 1);
+    }
+    return length;
+}
+
+void formatCronExpression(const CronMask& mask, char* buffer, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    buffer[0] = '\0';
+
+    // A full day field is only written as * if that does not change its meaning
+    int length = 0;
+    const uint64_t bits[] = {mask.minutes, mask.hours, mask.monthDays, mask.months, mask.weekDays};
+    static const int MIN[] = {0, 0, 1, 1, 0};
+    static const int MAX[] = {59, 23, 31, 12, 6};
+    for (int i = 0; i < 5 && (size_t)length < size; i++) {
+        if (i > 0) {
+            length += snprintf(buffer + length, size - length, " ");
+        }
+        if ((size_t)length < size) {
+            bool all = !(mask.dayOr && (i == 2 || i == 4));
+            length += formatCronField(bits[i], MIN[i], MAX[i], all, buffer + length, size - length);
+        }
+    }
+}
+
+// First minute of the day at or after `fromMinute` that the mask allows, -1 if none
+static int firstMinuteOfDay(const CronMask& mask, int fromMinute) {
+    int fromHour = fromMinute / 60;
+    for (int hour = firstBit(mask.hours, fromHour); hour >= 0 && hour < 24; hour = firstBit(mask.hours, hour + 1)) {
+        int m = firstBit(mask.minutes, hour == fromHour ? fromMinute % 60 : 0);
+        if (m >= 0 && m < 60) {
+            return hour * 60 + m;
+        }
+    }
+    return -1;
+}
+
+static bool dayMatches(const CronMask& mask, int monthDay, int weekday) {
+    bool monthDayMatches = (mask.monthDays & (1UL << monthDay)) != 0;
+    bool weekDayMatches = (mask.weekDays & (1 << weekday)) != 0;
+    return mask.dayOr ? (monthDayMatches || weekDayMatches) : (monthDayMatches && weekDayMatches);
+}
+
+time_t nextScheduleTime(const BackflushSchedule& schedule, time_t after) {
+    const CronMask& mask = schedule.mask;
+    if (!schedule.enabled || !(mask.minutes & ALL_MINUTES) || !(mask.hours & ALL_HOURS) ||
+        !(mask.months & ALL_MONTHS) || !(mask.monthDays & ALL_MONTH_DAYS) || !(mask.weekDays & ALL_WEEK_DAYS)) {
+        return 0;
+    }
+
+    // Fire times are on whole minutes, strictly after `after`
+    int32_t day = (int32_t)(after / 86400);
+    int fromMinute = (int)(after % 86400) / 60 + 1;
+
+    // Walk the calendar forward without converting every day, skipping whole months
+    int year, month, monthDay;
+    civilFromDays(day, year, month, monthDay);
+    int weekday = weekdayFromDays(day);
+    int monthLength = daysInMonth(year, month);
+    for (int i = 0; i < MAX_SEARCH_DAYS; ) {
+        if (mask.months & (1 << month)) {
+            if (dayMatches(mask, monthDay, weekday)) {
+                int minuteOfDay = firstMinuteOfDay(mask, fromMinute);
+                if (minuteOfDay >= 0) {
+                    return (time_t)day * 86400 + minuteOfDay * 60;
+                }
+            }
+            day++;
+            i++;
+            weekday = (weekday + 1) % 7;
+            monthDay++;
+        } else {
+            int skip = monthLength - monthDay + 1;
+            day += skip;
+            i += skip;
+            weekday = (weekday + skip) % 7;
+            monthDay = monthLength + 1;
+        }
+        fromMinute = 0;
+
+        if (monthDay > monthLength) {
+            monthDay = 1;
+            if (++month > 12) {
+                month = 1;
+                year++;
+            }
+            monthLength = daysInMonth(year, month);
+        }
+    }
+    return 0;
+}
+
+const char* unmetCondition(const ScheduleConditions& conditions, const FilterState& filter) {
+    if (conditions.minPressure > 0 && filter.pressure < conditions.minPressure) {
+        return "pressure";
+    }
+    if (conditions.minRise > 0 && filter.rise < conditions.minRise) {
+        return "rise";
+    }
+    if (conditions.minClogRate > 0 && filter.clogRate < conditions.minClogRate) {
+        return "clog_rate";
+    }
+    return nullptr;
+}
@@ -0,0 +1,97 @@
+#ifndef BACKFLUSHSCHEDULE_H
+#define BACKFLUSHSCHEDULE_H
+
+// Backflush schedule definition and its fire time calculation.
+// Depends only on the C++ standard library so it can be compiled on the host
+// (see tools/scheduler-bench).
+//
+// Every schedule is compiled into a CronMask with one bit per allowed minute,
+// hour, day of month, month and day of week, so matching and the search for
+// the next fire time are bit operations.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// Schedule types
+enum class ScheduleType : uint8_t {
+    DAILY,    // Every day at specific time
+    WEEKLY,   // Specific days of week at specific time
+    MONTHLY,  // Specific day of month at specific time
+    CRON      // Cron expression
+};
+
+// Compiled schedule fields, one bit per allowed value
+struct CronMask {
+    uint64_t minutes;            // Bits 0-59
+    uint32_t hours;              // Bits 0-23
+    uint32_t monthDays;          // Bits 1-31
+    uint16_t months;             // Bits 1-12
+    uint8_t weekDays;            // Bits 0-6, 0 = Sunday
+    bool dayOr;                  // Both day fields restricted: either one matching is enough (as in cron)
+
+    CronMask() : minutes(0), hours(0), monthDays(0), months(0), weekDays(0), dayOr(false) {}
+};
+
+// Optional conditions checked when a schedule fires, 0 = no condition
+struct ScheduleConditions {
+    float minPressure;           // Only if the pressure is at least this (bar)
+    float minRise;               // Only if it has risen this much since the last backflush (bar)
+    float minClogRate;           // Only if it is rising at least this fast (bar/day)
+
+    ScheduleConditions() : minPressure(0), minRise(0), minClogRate(0) {}
+};
+
+// Filter state the conditions are checked against, NAN where it is not known
+struct FilterState {
+    float pressure;              // Smoothed pressure (bar)
+    float rise;                  // Rise since the pressure recovered after the last backflush (bar)
+    float clogRate;              // Clogging rate since the last backflush (bar/day)
+};
+
+// Structure to hold schedule data
+struct BackflushSchedule {
+    bool enabled;                // Whether this schedule is active
+    ScheduleType type;           // Type of schedule (daily, weekly, monthly, cron)
+    uint8_t hour;                // Hour (0-23)
+    uint8_t minute;              // Minute (0-59)
+    uint32_t daysActive;         // Bitmap for days (weekly: bit 0=Sunday, monthly: bit 0=day 1 to bit 30=day 31)
+    uint16_t duration;           // Duration in seconds
+    CronMask mask;               // Compiled fields, used for matching
+    ScheduleConditions conditions;
+
+    // Constructor with defaults
+    BackflushSchedule() :
+        enabled(false),
+        type(ScheduleType::DAILY),
+        hour(0),
+        minute(0),
+        daysActive(0),
+        duration(30) {}
+};
+
+// Compile the hour, minute and days of a daily, weekly or monthly schedule into its mask
+void compileSchedule(BackflushSchedule& schedule);
+
+// Recover the hour, minute and days of a daily, weekly or monthly schedule from its mask
+void decompileSchedule(BackflushSchedule& schedule);
+
+// Parse a cron expression ("minute hour day-of-month month day-of-week") into a mask.
+// Fields take *, numbers, ranges (a-b), steps (*/n, a-b/n, and a/n from a to the
+// end of the range) and lists (a,b); day of week is 0-7 with both 0 and 7 meaning
+// Sunday. Returns false if it is invalid.
+bool parseCronExpression(const char* expression, CronMask& mask);
+
+// Format a mask as a cron expression
+void formatCronExpression(const CronMask& mask, char* buffer, size_t size);
+
+// Name of the first condition the filter state does not meet, nullptr if all are
+// met. A condition on a value that is not known is met, so missing data never
+// skips a backflush.
+const char* unmetCondition(const ScheduleConditions& conditions, const FilterState& filter);
+
+// First time strictly after `after` at which the schedule fires, 0 if it never
+// does (disabled, or no matching day). Times are local seconds since the epoch.
+time_t nextScheduleTime(const BackflushSchedule& schedule, time_t after);
+
+#endif // BACKFLUSHSCHEDULE_H
@@ -1,11 +1,21 @@
 #include "BackflushScheduler.h"
+#include "PressureRecord.h"
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <queue>
 
-const char* BackflushScheduler::SCHEDULE_FILE = "/schedules.json";
+const char* BackflushScheduler::SCHEDULE_FILE = "/schedules.bin";
+const char* BackflushScheduler::LEGACY_SCHEDULE_FILE = "/schedules.json";
+
+// Limit on the missed occurrences counted after a long outage
+static const unsigned int MAX_CATCH_UP_COUNT = 1000;
 
 BackflushScheduler::BackflushScheduler(TimeManager& tm)
-    : timeManager(tm), initialized(false), lastCheckTime(0) {
+    : timeManager(tm), initialized(false), lastCheckTime(0),
+      catchUpPolicy(CatchUpPolicy::FIRE_ONCE), catchUpWindowMinutes(60),
+      earliestTime(0), earliestDuration(0), nextTimesFrom(0), nextTimesValid(false),
+      quietStartHour(22), quietEndHour(6), predictiveWindowHours(0),
+      predictiveTime(0), predictiveDuration(0) {
 }
 
 void BackflushScheduler::begin() {
@@ -15,6 +25,8 @@ void BackflushScheduler::begin() {
         return;
     }
     
+    initialized = true;
+    
     // Load existing schedules
     if (loadSchedules()) {
         Serial.print("Loaded ");
@@ -23,28 +35,86 @@ void BackflushScheduler::begin() {
     } else {
         Serial.println("No schedules found or error loading schedules");
     }
-    
-    initialized = true;
 }
 
 bool BackflushScheduler::loadSchedules() {
-    // Check if schedule file exists
+    schedules.clear();
+    runStates.clear();
+    nextTimesValid = false;
+    
+    // Move the JSON schedules of older firmware into the schedule file
     if (!LittleFS.exists(SCHEDULE_FILE)) {
+        if (LittleFS.exists(LEGACY_SCHEDULE_FILE) && migrateLegacySchedules()) {
+            LittleFS.remove(LEGACY_SCHEDULE_FILE);
+            return true;
+        }
         Serial.println("Schedule file does not exist");
         return false;
     }
     
-    // Open file for reading
     File file = LittleFS.open(SCHEDULE_FILE, "r");
     if (!file) {
         Serial.println("Failed to open schedule file for reading");
         return false;
     }
     
-    // Allocate JsonDocument
-    JsonDocument doc;
+    BackflushScheduleFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != SCHEDULE_FILE_MAGIC || header.headerSize < sizeof(BackflushScheduleFileHeader) ||
+        header.recordSize < sizeof(BackflushScheduleRecord)) {
+        file.close();
+        Serial.println("Invalid schedule file");
+        return false;
+    }
+    
+    for (size_t i = 0; i < header.count; i++) {
+        if (schedules.size() >= MAX_SCHEDULES) {
+            Serial.println("Maximum number of schedules reached, ignoring additional schedules");
+            break;
+        }
+        
+        BackflushScheduleRecord record;
+        if (!file.seek(header.headerSize + i * header.recordSize, SeekSet) ||
+            file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+            break;
+        }
+        
+        BackflushSchedule schedule;
+        schedule.enabled = (record.flags & SCHEDULE_FLAG_ENABLED) != 0;
+        schedule.type = record.type <= (uint8_t)ScheduleType::CRON ? (ScheduleType)record.type : ScheduleType::DAILY;
+        schedule.duration = record.duration;
+        schedule.mask.minutes = record.minutes;
+        schedule.mask.hours = record.hours;
+        schedule.mask.monthDays = record.monthDays;
+        schedule.mask.months = record.months;
+        schedule.mask.weekDays = record.weekDays;
+        schedule.mask.dayOr = (record.flags & SCHEDULE_FLAG_DAY_OR) != 0;
+        schedule.conditions.minPressure = decodePressure(record.minPressure);
+        schedule.conditions.minRise = decodePressure(record.minRise);
+        schedule.conditions.minClogRate = record.minClogRate / 10000.0f;
+        decompileSchedule(schedule);
+        
+        ScheduleRunState state;
+        state.lastFired = record.lastFired;
+        state.missed = record.missed;
+        state.caughtUp = record.caughtUp;
+        state.skipped = record.skipped;
+        
+        schedules.push_back(schedule);
+        runStates.push_back(state);
+    }
+    file.close();
     
-    // Deserialize the JSON document
+    return true;
+}
+
+bool BackflushScheduler::migrateLegacySchedules() {
+    File file = LittleFS.open(LEGACY_SCHEDULE_FILE, "r");
+    if (!file) {
+        return false;
+    }
+    
+    JsonDocument doc;
     DeserializationError error = deserializeJson(doc, file);
     file.close();
     
@@ -54,14 +124,9 @@ bool BackflushScheduler::loadSchedules() {
         return false;
     }
     
-    // Clear existing schedules
-    schedules.clear();
-    
-    // Read schedules array
     JsonArray schedulesArray = doc["schedules"].as<JsonArray>();
     for (JsonObject scheduleObj : schedulesArray) {
         if (schedules.size() >= MAX_SCHEDULES) {
-            Serial.println("Maximum number of schedules reached, ignoring additional schedules");
             break;
         }
         
@@ -70,9 +135,7 @@ bool BackflushScheduler::loadSchedules() {
         
         // Parse schedule type
         String typeStr = scheduleObj["type"].as<String>();
-        if (typeStr == "daily") {
-            schedule.type = ScheduleType::DAILY;
-        } else if (typeStr == "weekly") {
+        if (typeStr == "weekly") {
             schedule.type = ScheduleType::WEEKLY;
         } else if (typeStr == "monthly") {
             schedule.type = ScheduleType::MONTHLY;
@@ -84,11 +147,40 @@ bool BackflushScheduler::loadSchedules() {
         schedule.minute = scheduleObj["minute"] | 0;
         schedule.daysActive = scheduleObj["daysActive"] | 0;
         schedule.duration = scheduleObj["duration"] | 30;
+        compileSchedule(schedule);
+        
+        ScheduleRunState state;
+        state.lastFired = scheduleObj["lastFired"] | (uint32_t)0;
+        state.missed = scheduleObj["missed"] | 0;
+        state.caughtUp = scheduleObj["caughtUp"] | 0;
         
         schedules.push_back(schedule);
+        runStates.push_back(state);
     }
     
-    return true;
+    Serial.print("Migrated ");
+    Serial.print(schedules.size());
+    Serial.println(" backflush schedules");
+    return saveSchedules();
+}
+
+void BackflushScheduler::toRecord(const BackflushSchedule& schedule, const ScheduleRunState& state, BackflushScheduleRecord& record) {
+    memset(&record, 0, sizeof(record));
+    record.minutes = schedule.mask.minutes;
+    record.hours = schedule.mask.hours;
+    record.monthDays = schedule.mask.monthDays;
+    record.months = schedule.mask.months;
+    record.weekDays = schedule.mask.weekDays;
+    record.type = (uint8_t)schedule.type;
+    record.flags = (schedule.enabled ? SCHEDULE_FLAG_ENABLED : 0) | (schedule.mask.dayOr ? SCHEDULE_FLAG_DAY_OR : 0);
+    record.duration = schedule.duration;
+    record.lastFired = (uint32_t)state.lastFired;
+    record.missed = state.missed;
+    record.caughtUp = state.caughtUp;
+    record.minPressure = encodePressure(schedule.conditions.minPressure);
+    record.minRise = encodePressure(schedule.conditions.minRise);
+    record.minClogRate = (uint16_t)constrain(lroundf(schedule.conditions.minClogRate * 10000), 0L, 0xFFFFL);
+    record.skipped = state.skipped;
 }
 
 bool BackflushScheduler::saveSchedules() {
@@ -97,50 +189,51 @@ bool BackflushScheduler::saveSchedules() {
         return false;
     }
     
-    // Create JSON document
-    JsonDocument doc;
-    JsonArray schedulesArray = doc["schedules"].to<JsonArray>();
-    
-    // Add each schedule to the array
-    for (const BackflushSchedule& schedule : schedules) {
-        JsonObject scheduleObj = schedulesArray.add<JsonObject>();
-        scheduleObj["enabled"] = schedule.enabled;
-        
-        // Convert schedule type to string
-        switch (schedule.type) {
-            case ScheduleType::DAILY:
-                scheduleObj["type"] = "daily";
-                break;
-            case ScheduleType::WEEKLY:
-                scheduleObj["type"] = "weekly";
-                break;
-            case ScheduleType::MONTHLY:
-                scheduleObj["type"] = "monthly";
-                break;
-        }
-        
-        scheduleObj["hour"] = schedule.hour;
-        scheduleObj["minute"] = schedule.minute;
-        scheduleObj["daysActive"] = schedule.daysActive;
-        scheduleObj["duration"] = schedule.duration;
-    }
-    
-    // Open file for writing
     File file = LittleFS.open(SCHEDULE_FILE, "w");
     if (!file) {
         Serial.println("Failed to open schedule file for writing");
         return false;
     }
     
-    // Serialize JSON to file
-    if (serializeJson(doc, file) == 0) {
+    BackflushScheduleFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SCHEDULE_FILE_MAGIC;
+    header.version = SCHEDULE_FILE_VERSION;
+    header.headerSize = sizeof(BackflushScheduleFileHeader);
+    header.recordSize = sizeof(BackflushScheduleRecord);
+    header.count = schedules.size();
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    
+    for (size_t i = 0; ok && i < schedules.size(); i++) {
+        BackflushScheduleRecord record;
+        toRecord(schedules[i], runStates[i], record);
+        ok = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    }
+    file.close();
+    
+    if (!ok) {
         Serial.println("Failed to write schedule file");
-        file.close();
-        return false;
+    }
+    return ok;
+}
+
+bool BackflushScheduler::saveRunState(size_t index) {
+    // Only the record of the schedule that ran changes
+    File file = LittleFS.open(SCHEDULE_FILE, "r+");
+    if (!file) {
+        return saveSchedules();
     }
     
+    BackflushScheduleRecord record;
+    toRecord(schedules[index], runStates[index], record);
+    bool ok = file.seek(sizeof(BackflushScheduleFileHeader) + index * sizeof(BackflushScheduleRecord), SeekSet) &&
+              file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
     file.close();
-    return true;
+    
+    if (!ok) {
+        Serial.println("Failed to write schedule file");
+    }
+    return ok;
 }
 
 bool BackflushScheduler::addSchedule(const BackflushSchedule& schedule) {
@@ -154,8 +247,16 @@ bool BackflushScheduler::addSchedule(const BackflushSchedule& schedule) {
         return false;
     }
     
-    // Add the new schedule
+    // Add the new schedule, due from now on
     schedules.push_back(schedule);
+    if (schedule.type == ScheduleType::CRON) {
+        decompileSchedule(schedules.back());
+    } else {
+        compileSchedule(schedules.back());
+    }
+    runStates.push_back(ScheduleRunState());
+    runStates.back().lastFired = getStartTime();
+    nextTimesValid = false;
     
     // Save the updated schedules
     return saveSchedules();
@@ -168,6 +269,13 @@ bool BackflushScheduler::updateSchedule(size_t index, const BackflushSchedule& s
     
     // Update the schedule at the specified index
     schedules[index] = schedule;
+    if (schedule.type == ScheduleType::CRON) {
+        decompileSchedule(schedules[index]);
+    } else {
+        compileSchedule(schedules[index]);
+    }
+    runStates[index].lastFired = getStartTime();
+    nextTimesValid = false;
     
     // Save the updated schedules
     return saveSchedules();
@@ -180,6 +288,8 @@ bool BackflushScheduler::deleteSchedule(size_t index) {
     
     // Remove the schedule at the specified index
     schedules.erase(schedules.begin() + index);
+    runStates.erase(runStates.begin() + index);
+    nextTimesValid = false;
     
     // Save the updated schedules
     return saveSchedules();
@@ -192,6 +302,8 @@ bool BackflushScheduler::clearSchedules() {
     
     // Clear all schedules
     schedules.clear();
+    runStates.clear();
+    nextTimesValid = false;
     
     // Save the updated schedules
     return saveSchedules();
@@ -206,228 +318,350 @@ BackflushSchedule BackflushScheduler::getSchedule(size_t index) const {
     return schedules[index];
 }
 
-bool BackflushScheduler::checkSchedules(time_t currentTime, unsigned int& scheduledDuration) {
+ScheduleRunState BackflushScheduler::getRunState(size_t index) const {
+    if (index >= runStates.size()) {
+        return ScheduleRunState();
+    }
+    
+    return runStates[index];
+}
+
+unsigned int BackflushScheduler::getMissedCount() const {
+    unsigned int total = 0;
+    for (const ScheduleRunState& state : runStates) {
+        total += state.missed;
+    }
+    return total;
+}
+
+void BackflushScheduler::setCatchUpPolicy(CatchUpPolicy policy, unsigned int windowMinutes) {
+    catchUpPolicy = policy;
+    catchUpWindowMinutes = windowMinutes;
+}
+
+time_t BackflushScheduler::getStartTime() const {
+    // Edited schedules only count occurrences from now on
+    return timeManager.isTimeInitialized() ? timeManager.getCurrentTime() : 0;
+}
+
+void BackflushScheduler::refreshNextTimes(time_t currentTime) {
+    // Continue from the last run so occurrences missed while the device was off
+    // or the loop was blocked are found. Without one, a schedule still fires if it
+    // is checked within its minute.
+    nextTimes.resize(schedules.size());
+    for (size_t i = 0; i < schedules.size(); i++) {
+        time_t from = runStates[i].lastFired != 0 ? runStates[i].lastFired : currentTime - 60;
+        nextTimes[i] = nextScheduleTime(schedules[i], from);
+    }
+    nextTimesFrom = currentTime;
+    nextTimesValid = true;
+    updateNextTime();
+}
+
+void BackflushScheduler::updateNextTime() {
+    earliestTime = 0;
+    earliestDuration = 0;
+    for (size_t i = 0; i < nextTimes.size(); i++) {
+        time_t t = nextTimes[i];
+        if (t == 0 || (earliestTime != 0 && t > earliestTime)) {
+            continue;
+        }
+        
+        // Schedules due at the same time run once with the longest duration
+        if (t != earliestTime) {
+            earliestTime = t;
+            earliestDuration = 0;
+        }
+        if (schedules[i].duration > earliestDuration) {
+            earliestDuration = schedules[i].duration;
+        }
+    }
+}
+
+bool BackflushScheduler::handleDueSchedule(size_t index, time_t currentTime, bool& catchUp) {
+    const BackflushSchedule& schedule = schedules[index];
+    ScheduleRunState& state = runStates[index];
+    
+    // Find the latest occurrence that is due, counting the ones before it
+    time_t latest = nextTimes[index];
+    unsigned int due = 1;
+    time_t next;
+    while (due < MAX_CATCH_UP_COUNT && (next = nextScheduleTime(schedule, latest)) != 0 && next <= currentTime) {
+        latest = next;
+        due++;
+    }
+    
+    state.lastFired = currentTime;
+    nextTimes[index] = nextScheduleTime(schedule, currentTime);
+    
+    // Checked within its minute, only the earlier occurrences were missed
+    catchUp = false;
+    if (currentTime - latest < 60) {
+        state.missed = min((unsigned int)UINT16_MAX, state.missed + due - 1);
+        return true;
+    }
+    
+    bool run;
+    switch (catchUpPolicy) {
+        case CatchUpPolicy::FIRE_ONCE:
+            run = true;
+            break;
+        case CatchUpPolicy::WITHIN_WINDOW:
+            run = currentTime - latest <= (time_t)catchUpWindowMinutes * 60;
+            break;
+        default:
+            run = false;
+            break;
+    }
+    state.missed = min((unsigned int)UINT16_MAX, state.missed + due);
+    catchUp = run;
+    
+    Serial.print("Schedule ");
+    Serial.print(index + 1);
+    Serial.print(" missed ");
+    Serial.print(due);
+    Serial.print(" occurrence(s), latest ");
+    Serial.print((long)(currentTime - latest) / 60);
+    Serial.println(run ? " minutes ago, catching up" : " minutes ago, skipped");
+    return run;
+}
+
+bool BackflushScheduler::checkSchedules(time_t currentTime, const FilterState& filter, unsigned int& scheduledDuration) {
     if (!initialized || schedules.empty()) {
         return false;
     }
     
-    // Apply cooldown period (5 minutes) to prevent multiple triggers
-    static time_t lastTriggerTime = 0;
-    const time_t COOLDOWN_PERIOD = 5 * 60; // 5 minutes in seconds
+    // Recompute after a change, or if the clock went back past the last computation
+    if (!nextTimesValid || currentTime < nextTimesFrom) {
+        refreshNextTimes(currentTime);
+    }
     
-    // If we've triggered recently, don't trigger again
-    if (lastTriggerTime > 0 && (currentTime - lastTriggerTime) < COOLDOWN_PERIOD) {
+    if (earliestTime == 0 || currentTime < earliestTime) {
         return false;
     }
     
-    struct tm* timeinfo = localtime(&currentTime);
-    int currentHour = timeinfo->tm_hour;
-    int currentMinute = timeinfo->tm_min;
-    int currentSecond = timeinfo->tm_sec;
-    int currentWeekday = timeinfo->tm_wday; // 0 = Sunday, 6 = Saturday
-    int currentMonthday = timeinfo->tm_mday; // 1-31
-    
+    // Handle every schedule that is due, running once with the longest duration
     bool shouldBackflush = false;
     scheduledDuration = 0;
-    
-    // Check each schedule
-    for (const BackflushSchedule& schedule : schedules) {
-        if (!schedule.enabled) {
+    for (size_t i = 0; i < nextTimes.size(); i++) {
+        if (nextTimes[i] == 0 || nextTimes[i] > currentTime) {
             continue;
         }
-        
-        bool scheduleMatches = false;
-        
-        // Check if the current time matches the schedule
-        if (currentHour == schedule.hour && currentMinute == schedule.minute && currentSecond < 60) {
-            // Time matches, now check the day based on schedule type
-            switch (schedule.type) {
-                case ScheduleType::DAILY:
-                    // Daily schedule always matches
-                    scheduleMatches = true;
-                    break;
-                    
-                case ScheduleType::WEEKLY:
-                    // Check if the current weekday is in the active days bitmap
-                    // Bit 0 = Sunday, Bit 1 = Monday, etc.
-                    scheduleMatches = (schedule.daysActive & (1 << currentWeekday)) != 0;
-                    break;
-                    
-                case ScheduleType::MONTHLY:
-                    // Check if the current day of month is in the active days bitmap
-                    // We subtract 1 because days are 1-31 but bitmap is 0-based
-                    scheduleMatches = (schedule.daysActive & (1 << (currentMonthday - 1))) != 0;
-                    break;
+        // A catch-up run counts once its conditions are met, otherwise as skipped
+        bool catchUp;
+        if (handleDueSchedule(i, currentTime, catchUp) && conditionsMet(i, filter)) {
+            if (catchUp && runStates[i].caughtUp < UINT16_MAX) {
+                runStates[i].caughtUp++;
             }
-        }
-        
-        // If this schedule matches and has a longer duration, use it
-        if (scheduleMatches) {
             shouldBackflush = true;
-            scheduledDuration = (schedule.duration > scheduledDuration) ? (unsigned int)schedule.duration : scheduledDuration;
-            
-            // Log the scheduled backflush
-            char timeStr[64];
-            strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-            Serial.print("Scheduled backflush triggered at ");
-            Serial.print(timeStr);
-            Serial.print(" with duration ");
-            Serial.print(scheduledDuration);
-            Serial.println(" seconds");
-            
-            // Update last trigger time
-            lastTriggerTime = currentTime;
+            if (schedules[i].duration > scheduledDuration) {
+                scheduledDuration = schedules[i].duration;
+            }
         }
+        
+        // Keep the run history across reboots
+        saveRunState(i);
     }
+    updateNextTime();
     
-    return shouldBackflush;
+    if (!shouldBackflush) {
+        return false;
+    }
+    
+    // Log the scheduled backflush
+    char timeStr[64];
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", gmtime(&currentTime));
+    Serial.print("Scheduled backflush triggered at ");
+    Serial.print(timeStr);
+    Serial.print(" with duration ");
+    Serial.print(scheduledDuration);
+    Serial.println(" seconds");
+    return true;
 }
 
-// Helper function to get days in a month (1-12, year with century)
-static int getDaysInMonth(int month, int year) {
-    if (month < 1 || month > 12) return 31; // Default to 31 for invalid months
+bool BackflushScheduler::conditionsMet(size_t index, const FilterState& filter) {
+    const char* condition = unmetCondition(schedules[index].conditions, filter);
+    if (condition == nullptr) {
+        return true;
+    }
     
-    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if (month == 2 && (year % 400 == 0 || (year % 100 != 0 && year % 4 == 0))) {
-        return 29; // Leap year
+    ScheduleRunState& state = runStates[index];
+    if (state.skipped < UINT16_MAX) {
+        state.skipped++;
     }
-    return daysInMonth[month - 1];
+    
+    Serial.print("Schedule ");
+    Serial.print(index + 1);
+    Serial.print(" skipped, condition not met: ");
+    Serial.println(condition);
+    if (skipCallback) {
+        skipCallback(index, condition);
+    }
+    return false;
 }
 
-bool BackflushScheduler::getNextScheduledTime(time_t& nextTime, unsigned int& duration) const {
+bool BackflushScheduler::getNextScheduledTime(time_t& nextTime, unsigned int& duration) {
     if (!initialized || schedules.empty() || !timeManager.isTimeInitialized()) {
         return false;
     }
     
     time_t currentTime = timeManager.getCurrentTime();
-    time_t earliestTime = currentTime + 86400 * 31; // Initialize to a month from now
-    bool foundSchedule = false;
-    
-    // Get current time components
-    struct tm currentTm;
-    localtime_r(&currentTime, &currentTm);
-    int currentYear = currentTm.tm_year + 1900;
-    int currentMonth = currentTm.tm_mon + 1;
-    
-    // Check each schedule
-    for (const BackflushSchedule& schedule : schedules) {
-        if (!schedule.enabled) {
-            continue;
+    if (!nextTimesValid || currentTime < nextTimesFrom) {
+        refreshNextTimes(currentTime);
+    }
+    
+    if (earliestTime == 0) {
+        return false;
+    }
+    
+    nextTime = earliestTime;
+    duration = earliestDuration;
+    return true;
+}
+
+size_t BackflushScheduler::previewSchedules(time_t from, time_t until, size_t count, ScheduleFiringCallback callback,
+                                            const BackflushSchedule* candidate, size_t candidateIndex) const {
+    // The candidate is compiled as addSchedule would, but not stored
+    BackflushSchedule compiled;
+    size_t total = schedules.size();
+    if (candidate) {
+        compiled = *candidate;
+        if (compiled.type == ScheduleType::CRON) {
+            decompileSchedule(compiled);
+        } else {
+            compileSchedule(compiled);
         }
-        
-        time_t scheduleTime = 0;
-        
-        switch (schedule.type) {
-            case ScheduleType::DAILY: {
-                // For daily, just find the next occurrence of the scheduled time
-                struct tm nextTm = currentTm;
-                nextTm.tm_hour = schedule.hour;
-                nextTm.tm_min = schedule.minute;
-                nextTm.tm_sec = 0;
-                
-                time_t nextOccurrence = mktime(&nextTm);
-                if (nextOccurrence <= currentTime) {
-                    nextOccurrence += 86400; // Add one day
-                }
-                scheduleTime = nextOccurrence;
-                break;
-            }
-                
-            case ScheduleType::WEEKLY: {
-                // Find the next day of the week that matches
-                struct tm nextTm = currentTm;
-                nextTm.tm_hour = schedule.hour;
-                nextTm.tm_min = schedule.minute;
-                nextTm.tm_sec = 0;
-                
-                // Start checking from current day
-                time_t baseTime = mktime(&nextTm);
-                if (baseTime <= currentTime) {
-                    // If time has passed today, start from tomorrow
-                    nextTm.tm_mday++;
-                    baseTime = mktime(&nextTm);
-                }
-                
-                // Check up to 7 days forward
-                for (int i = 0; i < 7; i++) {
-                    struct tm checkTm;
-                    localtime_r(&baseTime, &checkTm);
-                    int checkWeekday = checkTm.tm_wday; // 0 = Sunday
-                    
-                    if (schedule.daysActive & (1 << checkWeekday)) {
-                        // Found a matching day
-                        scheduleTime = baseTime;
-                        break;
-                    }
-                    
-                    // Move to next day
-                    baseTime += 86400;
-                }
-                break;
+        if (candidateIndex >= total) {
+            candidateIndex = total++;
+        }
+    }
+    auto scheduleAt = [&](size_t index) -> const BackflushSchedule& {
+        return (candidate && index == candidateIndex) ? compiled : schedules[index];
+    };
+    
+    // Min-heap of the next fire time of each schedule, so each step only advances
+    // the schedules that were due
+    typedef std::pair<time_t, size_t> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    for (size_t i = 0; i < total && i < MAX_SCHEDULES; i++) {
+        time_t t = nextScheduleTime(scheduleAt(i), from);
+        if (t != 0 && t <= until) {
+            heap.push(Entry(t, i));
+        }
+    }
+    
+    size_t passed = 0;
+    while (!heap.empty() && passed < count) {
+        // Schedules due at the same time run once with the longest duration
+        ScheduleFiring firing;
+        firing.time = heap.top().first;
+        firing.duration = 0;
+        firing.schedules = 0;
+        while (!heap.empty() && heap.top().first == firing.time) {
+            size_t index = heap.top().second;
+            heap.pop();
+            const BackflushSchedule& schedule = scheduleAt(index);
+            firing.schedules |= 1UL << index;
+            if (schedule.duration > firing.duration) {
+                firing.duration = schedule.duration;
             }
-                
-            case ScheduleType::MONTHLY: {
-                // Find the next day of the month that matches
-                struct tm nextTm = currentTm;
-                nextTm.tm_hour = schedule.hour;
-                nextTm.tm_min = schedule.minute;
-                nextTm.tm_sec = 0;
-                
-                // Check up to 12 months ahead
-                for (int monthOffset = 0; monthOffset < 12; monthOffset++) {
-                    int checkYear = currentYear + (currentMonth + monthOffset - 1) / 12;
-                    int checkMonth = ((currentMonth - 1 + monthOffset) % 12) + 1;
-                    int daysInMonth = getDaysInMonth(checkMonth, checkYear);
-                    
-                    // Check each day in the month
-                    for (int day = 1; day <= daysInMonth; day++) {
-                        // Skip days before current day if checking current month
-                        if (monthOffset == 0 && day < currentTm.tm_mday) {
-                            continue;
-                        }
-                        
-                        // Check if this day is in the active days bitmap
-                        if (schedule.daysActive & (1 << (day - 1))) {
-                            // Found a matching day
-                            struct tm matchTm = nextTm;
-                            matchTm.tm_year = checkYear - 1900;
-                            matchTm.tm_mon = checkMonth - 1;
-                            matchTm.tm_mday = day;
-                            
-                            time_t matchTime = mktime(&matchTm);
-                            
-                            // Skip if this time is in the past
-                            if (matchTime <= currentTime) {
-                                continue;
-                            }
-                            
-                            scheduleTime = matchTime;
-                            break;
-                        }
-                    }
-                    
-                    if (scheduleTime != 0) {
-                        break; // Found a match
-                    }
-                }
-                break;
+            
+            time_t t = nextScheduleTime(schedule, firing.time);
+            if (t != 0 && t <= until) {
+                heap.push(Entry(t, index));
             }
         }
         
-        // If we found a valid time and it's earlier than our current earliest
-        if (scheduleTime > 0 && scheduleTime < earliestTime) {
-            earliestTime = scheduleTime;
-            duration = schedule.duration;
-            foundSchedule = true;
-        }
+        callback(firing);
+        passed++;
+    }
+    return passed;
+}
+
+void BackflushScheduler::setQuietHours(uint8_t startHour, uint8_t endHour) {
+    quietStartHour = startHour % 24;
+    quietEndHour = endHour % 24;
+}
+
+void BackflushScheduler::setPredictiveWindow(unsigned int hours) {
+    predictiveWindowHours = hours;
+    if (hours == 0) {
+        cancelPredictiveBackflush();
+    }
+}
+
+time_t BackflushScheduler::getNextQuietTime(time_t from) const {
+    // Equal start and end means no quiet hours are configured, any time is allowed
+    if (quietStartHour == quietEndHour) {
+        return from;
     }
     
-    if (foundSchedule) {
-        nextTime = earliestTime;
-        return true;
+    time_t dayStart = from - (from % 86400);
+    int secondOfDay = from % 86400;
+    int startSecond = quietStartHour * 3600;
+    int endSecond = quietEndHour * 3600;
+    
+    // The quiet period may wrap around midnight (e.g. 22:00 - 06:00)
+    bool inQuietHours = (startSecond < endSecond)
+        ? (secondOfDay >= startSecond && secondOfDay < endSecond)
+        : (secondOfDay >= startSecond || secondOfDay < endSecond);
+    if (inQuietHours) {
+        return from;
     }
     
-    return false;
+    // Otherwise the next quiet period starts later today or tomorrow
+    time_t next = dayStart + startSecond;
+    if (next <= from) {
+        next += 86400;
+    }
+    return next;
+}
+
+void BackflushScheduler::setPredictiveBackflush(time_t when, unsigned int duration) {
+    // Keep an already planned backflush if it is not later than the new one
+    if (predictiveTime != 0 && predictiveTime <= when) {
+        return;
+    }
+    
+    predictiveTime = when;
+    predictiveDuration = duration;
+    
+    char timeStr[20];
+    struct tm* timeinfo = gmtime(&when);
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M", timeinfo);
+    Serial.print("Predictive backflush planned for ");
+    Serial.println(timeStr);
+}
+
+void BackflushScheduler::cancelPredictiveBackflush() {
+    if (predictiveTime != 0) {
+        Serial.println("Predictive backflush cancelled");
+    }
+    predictiveTime = 0;
+}
+
+bool BackflushScheduler::getPredictiveBackflush(time_t& when, unsigned int& duration) const {
+    if (predictiveTime == 0) {
+        return false;
+    }
+    
+    when = predictiveTime;
+    duration = predictiveDuration;
+    return true;
+}
+
+bool BackflushScheduler::checkPredictiveBackflush(time_t currentTime, unsigned int& duration) {
+    if (!initialized || predictiveTime == 0 || currentTime < predictiveTime) {
+        return false;
+    }
+    
+    duration = predictiveDuration;
+    predictiveTime = 0;
+    
+    Serial.print("Predictive backflush triggered with duration ");
+    Serial.print(duration);
+    Serial.println(" seconds");
+    return true;
 }
 
 String BackflushScheduler::getSchedulesAsJson() const {
@@ -453,12 +687,28 @@ String BackflushScheduler::getSchedulesAsJson() const {
             case ScheduleType::MONTHLY:
                 scheduleObj["type"] = "monthly";
                 break;
+            case ScheduleType::CRON:
+                scheduleObj["type"] = "cron";
+                break;
         }
         
+        char expression[200];
+        formatCronExpression(schedule.mask, expression, sizeof(expression));
         scheduleObj["hour"] = schedule.hour;
         scheduleObj["minute"] = schedule.minute;
         scheduleObj["daysActive"] = schedule.daysActive;
+        scheduleObj["expression"] = expression;
         scheduleObj["duration"] = schedule.duration;
+        scheduleObj["lastFired"] = (uint32_t)runStates[i].lastFired;
+        scheduleObj["missed"] = runStates[i].missed;
+        scheduleObj["caughtUp"] = runStates[i].caughtUp;
+        scheduleObj["skipped"] = runStates[i].skipped;
+        scheduleObj["minPressure"] = schedule.conditions.minPressure;
+        scheduleObj["minRise"] = schedule.conditions.minRise;
+        scheduleObj["minClogRate"] = schedule.conditions.minClogRate;
+        if (i < nextTimes.size() && nextTimesValid) {
+            scheduleObj["nextTime"] = (uint32_t)nextTimes[i];
+        }
     }
     
     String jsonString;
@@ -3,56 +3,132 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <functional>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include "TimeManager.h"
+#include "BackflushSchedule.h"
 
 // Maximum number of schedules allowed
-#define MAX_SCHEDULES 3
+#define MAX_SCHEDULES 32
 
-// Schedule types
-enum class ScheduleType {
-    DAILY,    // Every day at specific time
-    WEEKLY,   // Specific days of week at specific time
-    MONTHLY   // Specific day of month at specific time
+// What to do with schedule occurrences that were not checked in their minute
+// (reboot, clock step, long blocking request)
+enum class CatchUpPolicy : uint8_t {
+    FIRE_ONCE = 0,      // Run once for all missed occurrences
+    SKIP = 1,           // Wait for the next occurrence
+    WITHIN_WINDOW = 2   // Run once if the latest occurrence is recent enough
 };
 
-// Structure to hold schedule data
-struct BackflushSchedule {
-    bool enabled;                // Whether this schedule is active
-    ScheduleType type;           // Type of schedule (daily, weekly, monthly)
-    uint8_t hour;                // Hour (0-23)
-    uint8_t minute;              // Minute (0-59)
-    uint16_t daysActive;         // Bitmap for days (weekly: bit 0=Sunday, monthly: day 1-31)
-    uint16_t duration;           // Duration in seconds
-    
-    // Constructor with defaults
-    BackflushSchedule() : 
-        enabled(false),
-        type(ScheduleType::DAILY),
-        hour(0),
-        minute(0),
-        daysActive(0),
-        duration(30) {}
+// Per-schedule run history, saved with the schedules
+struct ScheduleRunState {
+    time_t lastFired;            // Last time the schedule was due and handled (local time), 0 if never
+    uint16_t missed;             // Occurrences that did not run on time
+    uint16_t caughtUp;           // Late runs made for missed occurrences
+    uint16_t skipped;            // Occurrences skipped because a condition was not met
+    
+    ScheduleRunState() : lastFired(0), missed(0), caughtUp(0), skipped(0) {}
+};
+
+// BackflushScheduleRecord::flags bits
+static const uint8_t SCHEDULE_FLAG_ENABLED = 0x01;
+static const uint8_t SCHEDULE_FLAG_DAY_OR = 0x02;      // CronMask::dayOr
+
+// One schedule in the schedule file, all fields little-endian
+struct __attribute__((packed)) BackflushScheduleRecord {
+    uint64_t minutes;        // CronMask bits
+    uint32_t hours;
+    uint32_t monthDays;
+    uint16_t months;
+    uint8_t weekDays;
+    uint8_t type;            // ScheduleType
+    uint8_t flags;           // SCHEDULE_FLAG_* bits
+    uint8_t reserved1;       // Reserved, 0
+    uint16_t duration;       // Seconds
+    uint32_t lastFired;      // ScheduleRunState
+    uint16_t missed;
+    uint16_t caughtUp;
+    uint16_t minPressure;    // ScheduleConditions, bar * PRESSURE_SCALE
+    uint16_t minRise;        // bar * PRESSURE_SCALE
+    uint16_t minClogRate;    // Tenths of a millibar per day
+    uint16_t skipped;        // ScheduleRunState
+};
+
+struct __attribute__((packed)) BackflushScheduleFileHeader {
+    uint32_t magic;          // "PFSC"
+    uint16_t version;
+    uint16_t headerSize;     // sizeof(BackflushScheduleFileHeader)
+    uint16_t recordSize;     // sizeof(BackflushScheduleRecord)
+    uint16_t count;          // Number of records following the header
+    uint32_t reserved;
 };
 
+static_assert(sizeof(BackflushScheduleRecord) == 40, "BackflushScheduleRecord must be 40 bytes");
+static_assert(sizeof(BackflushScheduleFileHeader) == 16, "BackflushScheduleFileHeader must be 16 bytes");
+
+// Upcoming run of one or more schedules due at the same time
+struct ScheduleFiring {
+    time_t time;                 // Local time
+    unsigned int duration;       // Longest duration of the schedules due
+    uint32_t schedules;          // Bit per schedule index
+};
+
+static_assert(MAX_SCHEDULES <= 32, "ScheduleFiring::schedules has a bit per schedule");
+
+typedef std::function<void(const ScheduleFiring&)> ScheduleFiringCallback;
+
+// Called with the schedule index and the unmet condition when a run is skipped
+typedef std::function<void(size_t, const char*)> ScheduleSkipCallback;
+
 class BackflushScheduler {
 private:
     static const char* SCHEDULE_FILE;
+    static const char* LEGACY_SCHEDULE_FILE; // JSON schedules written by older firmware
+    static const uint32_t SCHEDULE_FILE_MAGIC = 0x43534650; // "PFSC"
+    static const uint16_t SCHEDULE_FILE_VERSION = 1;
     TimeManager& timeManager;
     std::vector<BackflushSchedule> schedules;
     bool initialized;
     unsigned long lastCheckTime;
+    std::vector<ScheduleRunState> runStates;    // Parallel to schedules
+    CatchUpPolicy catchUpPolicy;
+    unsigned int catchUpWindowMinutes;
+    ScheduleSkipCallback skipCallback;
+    
+    // Next fire time of each schedule (local time, 0 = never), recomputed only
+    // when a schedule fires or the schedules or the clock change
+    std::vector<time_t> nextTimes;
+    time_t earliestTime;            // Earliest of nextTimes, 0 if none
+    unsigned int earliestDuration;  // Longest duration of the schedules due at nextTime
+    time_t nextTimesFrom;           // Time the fire times were computed from
+    bool nextTimesValid;
+    
+    // Predictive backflush, pre-scheduled from the pressure trend
+    uint8_t quietStartHour;         // Local hour the quiet period starts
+    uint8_t quietEndHour;           // Local hour the quiet period ends
+    unsigned int predictiveWindowHours; // 0 = predictive backflush disabled
+    time_t predictiveTime;          // Pending predictive backflush (local time), 0 if none
+    unsigned int predictiveDuration;
     
     bool loadSchedules();
+    bool migrateLegacySchedules();
     bool saveSchedules();
+    bool saveRunState(size_t index);
+    static void toRecord(const BackflushSchedule& schedule, const ScheduleRunState& state, BackflushScheduleRecord& record);
+    void refreshNextTimes(time_t currentTime);
+    void updateNextTime();
+    time_t getStartTime() const;
+    // Whether a due schedule runs now; catchUp is set for a late run for missed occurrences
+    bool handleDueSchedule(size_t index, time_t currentTime, bool& catchUp);
+    bool conditionsMet(size_t index, const FilterState& filter);
     
 public:
     BackflushScheduler(TimeManager& tm);
     
     void begin();
     
-    // Schedule management
+    // Schedule management; daily, weekly and monthly schedules are compiled here,
+    // cron schedules must come with their mask (see parseCronExpression)
     bool addSchedule(const BackflushSchedule& schedule);
     bool updateSchedule(size_t index, const BackflushSchedule& schedule);
     bool deleteSchedule(size_t index);
@@ -63,11 +139,45 @@ public:
     BackflushSchedule getSchedule(size_t index) const;
     std::vector<BackflushSchedule> getAllSchedules() const { return schedules; }
     
-    // Schedule checking
-    bool checkSchedules(time_t currentTime, unsigned int& scheduledDuration);
+    // Schedule checking, a single comparison unless a schedule is due. Due
+    // schedules whose conditions the filter state does not meet are skipped.
+    bool checkSchedules(time_t currentTime, const FilterState& filter, unsigned int& scheduledDuration);
+    void setSkipCallback(ScheduleSkipCallback callback) { skipCallback = callback; }
+    
+    // Get next scheduled backflush time (local time) from the cache
+    bool getNextScheduledTime(time_t& nextTime, unsigned int& duration);
+    
+    // Up to `count` runs after `from` and no later than `until` (local time), in
+    // order; returns how many were passed to the callback. An unsaved candidate
+    // replaces the schedule at candidateIndex, or is added when that is past the end.
+    size_t previewSchedules(time_t from, time_t until, size_t count, ScheduleFiringCallback callback,
+                            const BackflushSchedule* candidate = nullptr, size_t candidateIndex = 0) const;
+    
+    // Missed schedule handling
+    void setCatchUpPolicy(CatchUpPolicy policy, unsigned int windowMinutes);
+    CatchUpPolicy getCatchUpPolicy() const { return catchUpPolicy; }
+    unsigned int getCatchUpWindow() const { return catchUpWindowMinutes; }
+    ScheduleRunState getRunState(size_t index) const;
+    unsigned int getMissedCount() const;
+    
+    // Recompute the next fire times on the next check, e.g. after a clock step
+    void invalidateNextTimes() { nextTimesValid = false; }
+    
+    // Predictive backflush configuration
+    void setQuietHours(uint8_t startHour, uint8_t endHour);
+    uint8_t getQuietStartHour() const { return quietStartHour; }
+    uint8_t getQuietEndHour() const { return quietEndHour; }
+    void setPredictiveWindow(unsigned int hours);
+    unsigned int getPredictiveWindowHours() const { return predictiveWindowHours; }
+    
+    // Earliest time at or after 'from' that falls inside the quiet hours (local time)
+    time_t getNextQuietTime(time_t from) const;
     
-    // Get next scheduled backflush time
-    bool getNextScheduledTime(time_t& nextTime, unsigned int& duration) const;
+    // Pending predictive backflush (local time)
+    void setPredictiveBackflush(time_t when, unsigned int duration);
+    void cancelPredictiveBackflush();
+    bool getPredictiveBackflush(time_t& when, unsigned int& duration) const;
+    bool checkPredictiveBackflush(time_t currentTime, unsigned int& duration);
     
     // Convert schedule to JSON for web display
     String getSchedulesAsJson() const;
@@ -0,0 +1,122 @@
+#include "ChangeDetector.h"
+
+#include <algorithm>
+
+ChangeDetector::ChangeDetector() : stepThreshold(0.3f), riseThreshold(0.3f), pumpOnThreshold(0.2f) {
+    reset();
+}
+
+void ChangeDetector::configure(float stepThreshold, float riseThreshold) {
+    if (stepThreshold == this->stepThreshold && riseThreshold == this->riseThreshold) {
+        return;
+    }
+    this->stepThreshold = stepThreshold;
+    this->riseThreshold = riseThreshold;
+    reset();
+}
+
+void ChangeDetector::reset() {
+    started = false;
+    pumpRunning = false;
+    settling = false;
+    restartLevel(0);
+    restartReference();
+}
+
+void ChangeDetector::restartLevel(float pressure) {
+    levelMean = pressure;
+    levelCount = 1;
+    upSum = upMin = 0;
+    downSum = downMax = 0;
+}
+
+void ChangeDetector::restartReference() {
+    reference = 0;
+    referenceCount = 0;
+    riseSum = 0;
+    riseReported = false;
+}
+
+ChangeDetector::Event ChangeDetector::update(float pressure) {
+    if (!started) {
+        started = true;
+        pumpRunning = pressure >= pumpOnThreshold;
+        restartLevel(pressure);
+        return NONE;
+    }
+
+    // Page-Hinkley: cumulative deviation from the running mean, less a drift allowance of
+    // half a step, alarming once it moves a full step's worth of area from its extreme
+    levelCount++;
+    levelMean += (pressure - levelMean) / levelCount;
+    float allowance = stepThreshold / 2;
+    float alarm = stepThreshold * 5;
+
+    upSum += pressure - levelMean - allowance;
+    upMin = std::min(upMin, upSum);
+    downSum += pressure - levelMean + allowance;
+    downMax = std::max(downMax, downSum);
+
+    if (upSum - upMin > alarm || downMax - downSum > alarm) {
+        restartLevel(pressure);
+        settling = true;
+        return NONE;
+    }
+
+    // Classify the new level once it has settled
+    if (settling) {
+        if (levelCount < SETTLE_SAMPLES) {
+            return NONE;
+        }
+        settling = false;
+
+        // Between the off and on level the pump keeps its state
+        bool running = pumpRunning ? levelMean >= pumpOnThreshold / 2 : levelMean >= pumpOnThreshold;
+        if (running != pumpRunning) {
+            pumpRunning = running;
+            restartReference();
+            return running ? PUMP_STARTED : PUMP_STOPPED;
+        }
+
+        // A jump while running, e.g. a closed valve or accumulated clogging
+        if (running && hasReference() && !riseReported && levelMean - reference >= riseThreshold) {
+            riseReported = true;
+            return ABNORMAL_RISE;
+        }
+
+        // After a drop (e.g. a backflush) the new level becomes the reference
+        if (levelMean < reference) {
+            restartReference();
+        }
+        return NONE;
+    }
+
+    if (!pumpRunning) {
+        return NONE;
+    }
+
+    // Establish the reference level once the pressure has settled
+    if (referenceCount < REFERENCE_SAMPLES) {
+        referenceCount++;
+        reference += (pressure - reference) / referenceCount;
+        return NONE;
+    }
+
+    // CUSUM of the rise above the reference, less half the rise threshold
+    riseSum = std::max(0.0f, riseSum + pressure - reference - riseThreshold / 2);
+    if (!riseReported && riseSum > riseThreshold / 2 * RISE_WINDOW) {
+        riseReported = true;
+        return ABNORMAL_RISE;
+    }
+
+    return NONE;
+}
+
+const char* ChangeDetector::eventName(Event event) {
+    switch (event) {
+        case PUMP_STARTED:  return "Pump started";
+        case PUMP_STOPPED:  return "Pump stopped";
+        case ABNORMAL_RISE: return "Abnormal pressure rise";
+        default:            return "None";
+    }
+}
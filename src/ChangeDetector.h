@@ -0,0 +1,75 @@
+#ifndef CHANGEDETECTOR_H
+#define CHANGEDETECTOR_H
+
+#include <stdint.h>
+
+// Incremental change-point detection on the smoothed pressure stream.
+// A two-sided Page-Hinkley test picks up level steps (pump start/stop), and a
+// one-sided CUSUM against the level after the pump started flags a sustained rise.
+// Each sample is O(1) with a handful of floats of state; tools/change-detector-test
+// feeds it synthetic step and drift traces.
+//
+// The reported pump state is PumpRuntime's, which classifies every reading by
+// level. The detector only decides pump start/stop at the steps it finds, but
+// classifies the settled level with the same thresholds, so its events agree
+// with PumpRuntime once a step has settled.
+class ChangeDetector {
+public:
+    enum Event {
+        NONE,
+        PUMP_STARTED,
+        PUMP_STOPPED,
+        ABNORMAL_RISE
+    };
+
+private:
+    static const uint32_t SETTLE_SAMPLES = 10;     // Samples averaged to classify the level after a step
+    static const uint32_t REFERENCE_SAMPLES = 60;  // Samples averaged for the reference level
+    static constexpr float RISE_WINDOW = 600.0f;   // Samples at half the rise threshold before alarming
+
+    float stepThreshold;   // bar
+    float riseThreshold;   // bar
+    float pumpOnThreshold; // bar, running at or above it, stopped below half of it
+    bool started;
+    bool pumpRunning;
+    bool settling;         // A step was detected, waiting for the new level
+
+    // Page-Hinkley state, relative to the running mean since the last step
+    float levelMean;
+    uint32_t levelCount;
+    float upSum, upMin;
+    float downSum, downMax;
+
+    // CUSUM state for the sustained rise
+    float reference;
+    uint32_t referenceCount;
+    float riseSum;
+    bool riseReported;
+
+    void restartLevel(float pressure);
+    void restartReference();
+
+public:
+    ChangeDetector();
+
+    // Minimum step size for pump start/stop, and sustained rise that counts as abnormal (bar)
+    // Starts over only if either changed
+    void configure(float stepThreshold, float riseThreshold);
+
+    // Level at which the pump counts as running, as for PumpRuntime; keeps the state
+    void setPumpOnThreshold(float bar) { pumpOnThreshold = bar; }
+
+    // Feed one sample; returns the event detected at this sample, if any
+    Event update(float pressure);
+
+    // Start over, e.g. after a backflush disturbed the pressure
+    void reset();
+
+    bool isPumpRunning() const { return pumpRunning; }
+    bool hasReference() const { return referenceCount >= REFERENCE_SAMPLES; }
+    float getReferenceLevel() const { return reference; }
+
+    static const char* eventName(Event event);
+};
+
+#endif // CHANGEDETECTOR_H
@@ -0,0 +1,38 @@
+#ifndef CIVILDATE_H
+#define CIVILDATE_H
+
+// Calendar arithmetic on day numbers (days since 1970-01-01) without mktime,
+// gmtime or localtime. Depends only on the C++ standard library.
+
+#include <stdint.h>
+
+// Calendar date of a day number, proleptic Gregorian calendar
+inline void civilFromDays(int32_t days, int& year, int& month, int& day) {
+    // 400-year eras starting on March 1st
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t dayOfEra = days - era * 146097;
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint32_t monthIndex = (5 * dayOfYear + 2) / 153; // 0 = March
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+// Day of the week of a day number, 0 = Sunday
+inline int weekdayFromDays(int32_t days) {
+    // 1970-01-01 was a Thursday
+    return (days % 7 + 11) % 7;
+}
+
+// Days in a month (1-12)
+inline int daysInMonth(int year, int month) {
+    static const uint8_t DAYS[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && (year % 400 == 0 || (year % 100 != 0 && year % 4 == 0))) {
+        return 29;
+    }
+    return DAYS[month - 1];
+}
+
+#endif // CIVILDATE_H
@@ -0,0 +1,144 @@
+#include "ClogRateEstimator.h"
+
+// Minimum number of samples before a slope is reported
+static const uint32_t MIN_SAMPLES = 3;
+
+// Minimum spread of the sample times (days^2 * n) before a slope is reported,
+// roughly one hour of data
+static const double MIN_TIME_VARIANCE = 1.0 / 24.0 / 24.0;
+
+// Slope must exceed this many standard errors before a threshold crossing is forecast
+static const float FORECAST_MIN_SIGNIFICANCE = 2.0f;
+
+ClogRateEstimator::ClogRateEstimator() {
+    reset(0);
+}
+
+void ClogRateEstimator::reset(time_t newOrigin) {
+    origin = newOrigin;
+    count = 0;
+    sumT = 0;
+    sumP = 0;
+    sumTP = 0;
+    sumTT = 0;
+    sumPP = 0;
+}
+
+void ClogRateEstimator::addSample(time_t timestamp, float pressure) {
+    double t = toDays(timestamp);
+    double p = pressure;
+
+    count++;
+    sumT += t;
+    sumP += p;
+    sumTP += t * p;
+    sumTT += t * t;
+    sumPP += p * p;
+}
+
+void ClogRateEstimator::removeSample(time_t timestamp, float pressure) {
+    if (count == 0) {
+        return;
+    }
+
+    // Start from clean sums once the window is empty so rounding errors don't accumulate
+    if (--count == 0) {
+        reset(origin);
+        return;
+    }
+
+    double t = toDays(timestamp);
+    double p = pressure;
+
+    sumT -= t;
+    sumP -= p;
+    sumTP -= t * p;
+    sumTT -= t * t;
+    sumPP -= p * p;
+}
+
+bool ClogRateEstimator::getSlope(float& barPerDay, float& stdError) const {
+    if (count < MIN_SAMPLES) {
+        return false;
+    }
+
+    double n = count;
+    double sxx = sumTT - sumT * sumT / n;
+    double sxy = sumTP - sumT * sumP / n;
+    double syy = sumPP - sumP * sumP / n;
+
+    if (sxx * n < MIN_TIME_VARIANCE) {
+        return false;
+    }
+
+    double slope = sxy / sxx;
+
+    // Residual sum of squares, clamped against rounding below zero
+    double sse = syy - slope * sxy;
+    if (sse < 0) {
+        sse = 0;
+    }
+
+    barPerDay = (float)slope;
+    stdError = (float)sqrt(sse / (n - 2) / sxx);
+    return true;
+}
+
+float ClogRateEstimator::getRSquared() const {
+    if (count < MIN_SAMPLES) {
+        return 0;
+    }
+
+    double n = count;
+    double sxx = sumTT - sumT * sumT / n;
+    double sxy = sumTP - sumT * sumP / n;
+    double syy = sumPP - sumP * sumP / n;
+
+    if (sxx <= 0 || syy <= 0) {
+        return 0;
+    }
+
+    double r2 = (sxy * sxy) / (sxx * syy);
+    return (float)constrain(r2, 0.0, 1.0);
+}
+
+bool ClogRateEstimator::predictAt(time_t timestamp, float& pressure) const {
+    float slope, stdError;
+    if (!getSlope(slope, stdError)) {
+        return false;
+    }
+
+    double n = count;
+    double meanT = sumT / n;
+    double meanP = sumP / n;
+
+    pressure = (float)(meanP + slope * (toDays(timestamp) - meanT));
+    return true;
+}
+
+bool ClogRateEstimator::forecastCrossing(float threshold, time_t from, time_t& eta) const {
+    float slope, stdError;
+    if (!getSlope(slope, stdError) || slope <= 0 || slope < FORECAST_MIN_SIGNIFICANCE * stdError) {
+        return false;
+    }
+
+    float predicted;
+    if (!predictAt(from, predicted)) {
+        return false;
+    }
+
+    // Already at or above the threshold according to the trend
+    if (predicted >= threshold) {
+        eta = from;
+        return true;
+    }
+
+    // Ignore crossings too far out to be meaningful
+    float days = (threshold - predicted) / slope;
+    if (days > 365.0f) {
+        return false;
+    }
+
+    eta = from + (time_t)(days * 86400.0f);
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef CLOGRATEESTIMATOR_H
+#define CLOGRATEESTIMATOR_H
+
+#include <Arduino.h>
+
+// Incremental least-squares fit of pressure against time.
+// Keeps only the running sums, so adding or removing a sample is O(1)
+// and the current slope is available without rescanning the history.
+class ClogRateEstimator {
+private:
+    time_t origin;      // t = 0 of the fit (GMT seconds), keeps the sums well conditioned
+    uint32_t count;
+    double sumT;        // t is measured in days since origin
+    double sumP;
+    double sumTP;
+    double sumTT;
+    double sumPP;
+
+    double toDays(time_t timestamp) const { return (double)(timestamp - origin) / 86400.0; }
+
+public:
+    ClogRateEstimator();
+
+    // Drop all samples and restart the fit at the given time
+    void reset(time_t newOrigin);
+
+    void addSample(time_t timestamp, float pressure);
+    void removeSample(time_t timestamp, float pressure);
+
+    size_t getSampleCount() const { return count; }
+    time_t getOrigin() const { return origin; }
+
+    // Slope in bar/day and its standard error; false if there is not enough data yet
+    bool getSlope(float& barPerDay, float& stdError) const;
+
+    // Coefficient of determination of the fit (0..1)
+    float getRSquared() const;
+
+    // Pressure predicted by the fitted line at the given time
+    bool predictAt(time_t timestamp, float& pressure) const;
+
+    // Time at which the fitted line reaches the threshold, starting from the given time.
+    // Only reported when the pressure is rising significantly faster than the fit's uncertainty.
+    bool forecastCrossing(float threshold, time_t from, time_t& eta) const;
+};
+
+#endif // CLOGRATEESTIMATOR_H
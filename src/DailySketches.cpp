@@ -0,0 +1,105 @@
+#include "DailySketches.h"
+
+const char* DailySketches::SKETCH_FILE = "/sketches.bin";
+
+DailySketches::DailySketches() : dirty(false) {
+    for (size_t i = 0; i < DAYS; i++) {
+        days[i].day = 0;
+    }
+}
+
+void DailySketches::add(uint32_t day, float value) {
+    DaySketch& slot = days[day % DAYS];
+    if (slot.day != day) {
+        // Reuse the slot of the day that fell out of the window
+        slot.day = day;
+        slot.sketch.clear();
+    }
+    slot.sketch.add(value);
+    dirty = true;
+}
+
+const QuantileSketch* DailySketches::getDay(uint32_t day) const {
+    const DaySketch& slot = days[day % DAYS];
+    return slot.day == day ? &slot.sketch : nullptr;
+}
+
+QuantileSketch DailySketches::merge(uint32_t fromDay, uint32_t toDay) const {
+    QuantileSketch result;
+    for (size_t i = 0; i < DAYS; i++) {
+        if (days[i].day != 0 && days[i].day >= fromDay && days[i].day <= toDay) {
+            result.merge(days[i].sketch);
+        }
+    }
+    return result;
+}
+
+bool DailySketches::load() {
+    if (!LittleFS.exists(SKETCH_FILE)) {
+        return false;
+    }
+
+    File file = LittleFS.open(SKETCH_FILE, "r");
+    if (!file) {
+        Serial.println("Failed to open sketch file for reading");
+        return false;
+    }
+
+    // The file is a raw image of the slots, only valid for the same layout
+    uint32_t header[2];
+    bool ok = file.read((uint8_t*)header, sizeof(header)) == sizeof(header) &&
+              header[0] == SKETCH_FILE_MAGIC && header[1] == sizeof(days) &&
+              file.read((uint8_t*)days, sizeof(days)) == sizeof(days);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Invalid sketch file, starting new pressure distributions");
+        for (size_t i = 0; i < DAYS; i++) {
+            days[i].day = 0;
+            days[i].sketch.clear();
+        }
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+bool DailySketches::save() {
+    if (!dirty) {
+        return true;
+    }
+
+    File file = LittleFS.open(SKETCH_FILE, "w");
+    if (!file) {
+        Serial.println("Failed to open sketch file for writing");
+        return false;
+    }
+
+    uint32_t header[2] = { SKETCH_FILE_MAGIC, sizeof(days) };
+    bool ok = file.write((const uint8_t*)header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)days, sizeof(days)) == sizeof(days);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Failed to write sketch file");
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+bool DailySketches::clear() {
+    for (size_t i = 0; i < DAYS; i++) {
+        days[i].day = 0;
+        days[i].sketch.clear();
+    }
+    dirty = false;
+
+    if (LittleFS.exists(SKETCH_FILE) && !LittleFS.remove(SKETCH_FILE)) {
+        Serial.println("Failed to delete sketch file");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef DAILYSKETCHES_H
+#define DAILYSKETCHES_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "QuantileSketch.h"
+
+// One quantile sketch of the pressure per (local) day for the last DAYS days,
+// persisted so the distributions survive a reboot.
+class DailySketches {
+public:
+    static const size_t DAYS = 8;
+
+private:
+    static const char* SKETCH_FILE;
+    static const uint32_t SKETCH_FILE_MAGIC = 0x53514650; // "PFQS"
+
+    struct DaySketch {
+        uint32_t day;            // Days since epoch, 0 = unused
+        QuantileSketch sketch;
+    };
+    DaySketch days[DAYS];        // Indexed by day % DAYS
+    bool dirty;
+
+public:
+    DailySketches();
+
+    // Add a sample to the given day, starting a fresh sketch when the day changes
+    void add(uint32_t day, float value);
+
+    // Sketch for a single day, or nullptr if it is not held
+    const QuantileSketch* getDay(uint32_t day) const;
+
+    // Merge of all held days in [fromDay, toDay]
+    QuantileSketch merge(uint32_t fromDay, uint32_t toDay) const;
+
+    bool load();
+    bool save(); // Only writes if anything changed
+    bool clear();
+};
+
+#endif // DAILYSKETCHES_H
@@ -1,5 +1,7 @@
 #include "Display.h"
 #include "WebServer.h"
+#include "PressureLogger.h"
+#include "Profiler.h"
 
 Display::Display(Adafruit_SSD1306& oled, float& pressure, float& threshold, 
                  unsigned int& duration, bool& active, unsigned long& startTime, TimeManager* tm)
@@ -13,10 +15,11 @@ Display::Display(Adafruit_SSD1306& oled, float& pressure, float& threshold,
       timeManager(tm),
       webServer(nullptr),
       scheduler(nullptr),
+      pressureLogger(nullptr),
       lastOtaFlashTime(0),
       lastDisplayToggleTime(0),
       showOtaText(false),
-      showThreshold(true) {
+      footerPage(0) {
 }
 
 bool Display::init() {
@@ -123,6 +126,7 @@ void Display::showResetMessage() {
 
 void Display::updateDisplay() {
   if (!displayAvailable) return;
+  PROFILE_STAGE(PROFILE_DISPLAY);
   
   display.clearDisplay();
   
@@ -198,12 +202,16 @@ void Display::updateDisplay() {
     display.print(F("bar"));
   }
   
-  // Handle display toggling between threshold and next scheduled backflush
+  // Handle display toggling between threshold, next scheduled backflush and clogging rate
   if (millis() - lastDisplayToggleTime >= 5000) { // Toggle every 5 seconds
-    showThreshold = !showThreshold;
+    footerPage = (footerPage + 1) % 3;
     lastDisplayToggleTime = millis();
   }
   
+  // Only show the clogging rate once there is enough data for an estimate
+  float clogRate = 0, clogRateError = 0;
+  bool haveClogRate = pressureLogger && pressureLogger->getClogRate().getSlope(clogRate, clogRateError);
+  
   // Display backflush status at bottom left
   display.setTextSize(1);
   display.setCursor(0, 56);
@@ -216,11 +224,17 @@ void Display::updateDisplay() {
     display.print(F("/"));
     display.print(backflushDuration);
     display.print(F("s"));
-  } else if (showThreshold) {
+  } else if (footerPage == 0 || (footerPage == 2 && !haveClogRate)) {
     // Show threshold
     display.print(F("Threshold: "));
     display.print(backflushThreshold, 1);
     display.print(F(" bar"));
+  } else if (footerPage == 2) {
+    // Show clogging rate since the last backflush
+    display.print(F("Clog: "));
+    if (clogRate >= 0) display.print(F("+"));
+    display.print(clogRate, 3);
+    display.print(F(" bar/d"));
   } else if (scheduler) {
     // Show next scheduled backflush time
     time_t nextTime;
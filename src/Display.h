@@ -10,6 +10,7 @@
 // Forward declarations
 class WebServer;
 class BackflushScheduler;
+class PressureLogger;
 
 class Display {
 private:
@@ -23,10 +24,11 @@ private:
     TimeManager* timeManager;
     WebServer* webServer;
     BackflushScheduler* scheduler;
+    PressureLogger* pressureLogger;
     unsigned long lastOtaFlashTime;
     unsigned long lastDisplayToggleTime;
     bool showOtaText;
-    bool showThreshold;
+    uint8_t footerPage; // 0 = threshold, 1 = next scheduled backflush, 2 = clogging rate
 
 public:
     Display(Adafruit_SSD1306& oled, float& pressure, float& threshold, 
@@ -40,6 +42,7 @@ public:
     void setTimeManager(TimeManager* tm) { timeManager = tm; }
     void setWebServer(WebServer* ws) { webServer = ws; }
     void setScheduler(BackflushScheduler* sched) { scheduler = sched; }
+    void setPressureLogger(PressureLogger* logger) { pressureLogger = logger; }
     void showResetMessage();
     void updateDisplay();
     void showFirmwareUpdateProgress(int percentage);
@@ -0,0 +1,107 @@
+#include "EventMarkerLog.h"
+#include <algorithm>
+
+const char* EventMarkerLog::MARKER_FILE = "/markers.bin";
+
+static bool markerBefore(const EventMarker& marker, time_t t) {
+    return marker.timestamp < (uint32_t)t;
+}
+
+bool EventMarkerLog::load() {
+    if (!LittleFS.exists(MARKER_FILE)) {
+        return false;
+    }
+
+    File file = LittleFS.open(MARKER_FILE, "r");
+    if (!file) {
+        Serial.println("Failed to open marker file for reading");
+        return false;
+    }
+
+    PressureFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || !isValidMarkerFileHeader(header)) {
+        Serial.println("Invalid marker file header");
+        file.close();
+        return false;
+    }
+    file.seek(header.headerSize, SeekSet);
+
+    markers.clear();
+    markers.reserve(min((size_t)header.recordCount, (size_t)MAX_MARKERS));
+
+    for (uint32_t i = 0; i < header.recordCount; i++) {
+        EventMarker marker;
+        if (file.read((uint8_t*)&marker, sizeof(marker)) != sizeof(marker)) {
+            Serial.println("Marker file truncated");
+            break;
+        }
+        if (header.recordSize > sizeof(marker)) {
+            file.seek(header.recordSize - sizeof(marker), SeekCur);
+        }
+        markers.push_back(marker);
+    }
+
+    file.close();
+
+    if (markers.size() > MAX_MARKERS) {
+        markers.erase(markers.begin(), markers.end() - MAX_MARKERS);
+    }
+    return true;
+}
+
+bool EventMarkerLog::save() {
+    File file = LittleFS.open(MARKER_FILE, "w");
+    if (!file) {
+        Serial.println("Failed to open marker file for writing");
+        return false;
+    }
+
+    PressureFileHeader header;
+    initMarkerFileHeader(header, markers.size());
+    size_t bytes = markers.size() * sizeof(EventMarker);
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              (bytes == 0 || file.write((const uint8_t*)markers.data(), bytes) == bytes);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Failed to write marker file");
+    }
+    return ok;
+}
+
+void EventMarkerLog::add(const EventMarker& marker) {
+    if (markers.size() >= MAX_MARKERS) {
+        markers.erase(markers.begin());
+    }
+
+    // Markers almost always arrive in order; backdated ones are inserted after equal timestamps
+    auto it = std::upper_bound(markers.begin(), markers.end(), marker.timestamp,
+                               [](uint32_t t, const EventMarker& m) { return t < m.timestamp; });
+    markers.insert(it, marker);
+}
+
+size_t EventMarkerLog::getMarkers(time_t from, time_t to, MarkerCallback callback) const {
+    size_t count = 0;
+    auto it = std::lower_bound(markers.begin(), markers.end(), from, markerBefore);
+    for (; it != markers.end() && it->timestamp < (uint32_t)to; ++it) {
+        callback(*it);
+        count++;
+    }
+    return count;
+}
+
+size_t EventMarkerLog::pruneBefore(time_t cutoff) {
+    auto it = std::lower_bound(markers.begin(), markers.end(), cutoff, markerBefore);
+    size_t removed = it - markers.begin();
+    markers.erase(markers.begin(), it);
+    return removed;
+}
+
+bool EventMarkerLog::clear() {
+    markers.clear();
+    if (LittleFS.exists(MARKER_FILE) && !LittleFS.remove(MARKER_FILE)) {
+        Serial.println("Failed to delete marker file");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef EVENTMARKERLOG_H
+#define EVENTMARKERLOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <vector>
+#include <functional>
+#include "PressureRecord.h"
+
+typedef std::function<void(const EventMarker&)> MarkerCallback;
+
+// Typed events (backflush, reboot, time step, settings change) alongside the pressure series.
+// Markers are kept in chronological order so a time range is found by binary search.
+class EventMarkerLog {
+private:
+    static const char* MARKER_FILE;
+    static const size_t MAX_MARKERS = 256; // 3kb
+
+    std::vector<EventMarker> markers;
+
+public:
+    bool load();
+    bool save();
+
+    // Insert a marker, keeping chronological order; the oldest marker is dropped when full
+    void add(const EventMarker& marker);
+
+    // Pass markers in [from, to) to the callback in chronological order; returns how many
+    size_t getMarkers(time_t from, time_t to, MarkerCallback callback) const;
+
+    // Drop markers older than the cutoff; returns how many were removed
+    size_t pruneBefore(time_t cutoff);
+
+    bool clear();
+    size_t getCount() const { return markers.size(); }
+};
+
+#endif // EVENTMARKERLOG_H
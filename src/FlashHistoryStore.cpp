@@ -0,0 +1,302 @@
+#include "FlashHistoryStore.h"
+#include <algorithm>
+#include <stddef.h>
+
+const char* FlashHistoryStore::HISTORY_DIR = "/history";
+
+String FlashHistoryStore::segmentPath(uint32_t sequence) const {
+    char path[32];
+    snprintf(path, sizeof(path), "%s/%08u.bin", HISTORY_DIR, (unsigned)sequence);
+    return String(path);
+}
+
+bool FlashHistoryStore::begin() {
+    segments.clear();
+
+    Dir dir = LittleFS.openDir(HISTORY_DIR);
+    while (dir.next()) {
+        uint32_t sequence = strtoul(dir.fileName().c_str(), nullptr, 10);
+        Segment segment;
+        if (scanSegment(sequence, segment)) {
+            segments.push_back(segment);
+        } else {
+            Serial.print("Removing invalid history segment ");
+            Serial.println(dir.fileName());
+            LittleFS.remove(segmentPath(sequence));
+        }
+    }
+
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.sequence < b.sequence; });
+
+    Serial.print("Pressure history on flash: ");
+    Serial.print(getRecordCount());
+    Serial.print(" readings in ");
+    Serial.print(segments.size());
+    Serial.println(" segments");
+    return true;
+}
+
+bool FlashHistoryStore::scanSegment(uint32_t sequence, Segment& segment) const {
+    File file = LittleFS.open(segmentPath(sequence), "r");
+    if (!file) {
+        return false;
+    }
+
+    PressureFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        !isValidPressureFileHeader(header) || header.headerSize != sizeof(PressureFileHeader) ||
+        header.recordSize != sizeof(PressureRecord) || header.pressureScale != PRESSURE_SCALE) {
+        file.close();
+        return false;
+    }
+
+    // The file size is authoritative; the header count may lag after an interrupted append
+    segment.sequence = sequence;
+    segment.count = (file.size() - header.headerSize) / sizeof(PressureRecord);
+    if (segment.count == 0) {
+        file.close();
+        return false;
+    }
+
+    PressureRecord record;
+    file.seek(header.headerSize, SeekSet);
+    file.read((uint8_t*)&record, sizeof(record));
+    segment.firstTimestamp = record.timestamp;
+    file.seek(header.headerSize + (segment.count - 1) * sizeof(PressureRecord), SeekSet);
+    file.read((uint8_t*)&record, sizeof(record));
+    segment.lastTimestamp = record.timestamp;
+
+    file.close();
+    return true;
+}
+
+bool FlashHistoryStore::append(const PressureRecord* records, size_t count) {
+    while (count > 0) {
+        // Start a new segment when there is none or the newest one is full
+        if (segments.empty() || segments.back().count >= SEGMENT_RECORDS) {
+            Segment segment;
+            segment.sequence = segments.empty() ? 0 : segments.back().sequence + 1;
+            segment.firstTimestamp = records[0].timestamp;
+            segment.lastTimestamp = records[0].timestamp;
+            segment.count = 0;
+
+            File file = LittleFS.open(segmentPath(segment.sequence), "w");
+            if (!file) {
+                Serial.println("Failed to create history segment");
+                return false;
+            }
+            PressureFileHeader header;
+            initPressureFileHeader(header, 0);
+            bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+            file.close();
+            if (!ok) {
+                Serial.println("Failed to write history segment header");
+                return false;
+            }
+
+            segments.push_back(segment);
+            if (segments.size() > MAX_SEGMENTS) {
+                removeSegment(0);
+            }
+        }
+
+        Segment& segment = segments.back();
+        size_t batch = min(count, (size_t)(SEGMENT_RECORDS - segment.count));
+
+        File file = LittleFS.open(segmentPath(segment.sequence), "r+");
+        if (!file) {
+            Serial.println("Failed to open history segment for appending");
+            return false;
+        }
+
+        size_t bytes = batch * sizeof(PressureRecord);
+        file.seek(0, SeekEnd);
+        bool ok = file.write((const uint8_t*)records, bytes) == bytes;
+        if (ok) {
+            // Keep the header count in step so each segment is a valid history file
+            uint32_t newCount = segment.count + batch;
+            file.seek(offsetof(PressureFileHeader, recordCount), SeekSet);
+            file.write((const uint8_t*)&newCount, sizeof(newCount));
+        }
+        file.close();
+
+        if (!ok) {
+            Serial.println("Failed to append to history segment");
+            return false;
+        }
+
+        segment.count += batch;
+        segment.lastTimestamp = records[batch - 1].timestamp;
+        records += batch;
+        count -= batch;
+    }
+
+    return true;
+}
+
+uint32_t FlashHistoryStore::findFirstRecord(File& file, const Segment& segment, time_t timestamp) const {
+    if ((time_t)segment.firstTimestamp >= timestamp) {
+        return 0;
+    }
+
+    // Binary search for the last block starting before the timestamp
+    uint32_t low = 0;
+    uint32_t high = (segment.count + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+    while (high - low > 1) {
+        uint32_t mid = (low + high) / 2;
+        PressureRecord record;
+        file.seek(sizeof(PressureFileHeader) + mid * BLOCK_RECORDS * sizeof(PressureRecord), SeekSet);
+        file.read((uint8_t*)&record, sizeof(record));
+        if ((time_t)record.timestamp < timestamp) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low * BLOCK_RECORDS;
+}
+
+size_t FlashHistoryStore::query(time_t from, time_t to, RecordCallback callback) const {
+    size_t visited = 0;
+    PressureRecord block[BLOCK_RECORDS];
+
+    for (const Segment& segment : segments) {
+        if ((time_t)segment.lastTimestamp < from) {
+            continue;
+        }
+        if ((time_t)segment.firstTimestamp >= to) {
+            break;
+        }
+
+        File file = LittleFS.open(segmentPath(segment.sequence), "r");
+        if (!file) {
+            continue;
+        }
+
+        uint32_t index = findFirstRecord(file, segment, from);
+        file.seek(sizeof(PressureFileHeader) + index * sizeof(PressureRecord), SeekSet);
+
+        // Stream whole blocks until the end of the range
+        while (index < segment.count) {
+            size_t wanted = min((size_t)BLOCK_RECORDS, (size_t)(segment.count - index));
+            size_t got = file.read((uint8_t*)block, wanted * sizeof(PressureRecord)) / sizeof(PressureRecord);
+            if (got == 0) {
+                break;
+            }
+            index += got;
+
+            for (size_t i = 0; i < got; i++) {
+                if ((time_t)block[i].timestamp < from) {
+                    continue;
+                }
+                if ((time_t)block[i].timestamp >= to) {
+                    file.close();
+                    return visited;
+                }
+                visited++;
+                if (!callback(block[i])) {
+                    file.close();
+                    return visited;
+                }
+            }
+        }
+
+        file.close();
+    }
+
+    return visited;
+}
+
+bool FlashHistoryStore::removeSegment(size_t index) {
+    if (index >= segments.size()) {
+        return false;
+    }
+    bool ok = LittleFS.remove(segmentPath(segments[index].sequence));
+    segments.erase(segments.begin() + index);
+    return ok;
+}
+
+size_t FlashHistoryStore::pruneBefore(time_t cutoff) {
+    size_t removed = 0;
+    // Keep the newest segment so appends always have somewhere to go
+    while (segments.size() > 1 && (time_t)segments.front().lastTimestamp < cutoff) {
+        removed += segments.front().count;
+        removeSegment(0);
+    }
+    return removed;
+}
+
+bool FlashHistoryStore::dropOldestSegment() {
+    if (segments.size() <= 1) {
+        return false;
+    }
+    return removeSegment(0);
+}
+
+bool FlashHistoryStore::clear() {
+    bool ok = true;
+    while (!segments.empty()) {
+        ok = removeSegment(0) && ok;
+    }
+    return ok;
+}
+
+uint32_t FlashHistoryStore::getRecordCount() const {
+    uint32_t count = 0;
+    for (const Segment& segment : segments) {
+        count += segment.count;
+    }
+    return count;
+}
+
+size_t FlashHistoryStore::getExportSize() const {
+    return sizeof(PressureFileHeader) + getRecordCount() * sizeof(PressureRecord);
+}
+
+size_t FlashHistoryStore::readExport(size_t offset, uint8_t* buffer, size_t length) const {
+    size_t copied = 0;
+
+    // Synthetic header covering all segments
+    if (offset < sizeof(PressureFileHeader)) {
+        PressureFileHeader header;
+        initPressureFileHeader(header, getRecordCount());
+        size_t bytes = min(length, sizeof(header) - offset);
+        memcpy(buffer, (const uint8_t*)&header + offset, bytes);
+        copied += bytes;
+        offset += bytes;
+    }
+
+    // Records, read from whichever segments cover the requested bytes
+    size_t segmentStart = sizeof(PressureFileHeader);
+    for (const Segment& segment : segments) {
+        if (copied >= length) {
+            break;
+        }
+
+        size_t segmentBytes = segment.count * sizeof(PressureRecord);
+        if (offset >= segmentStart + segmentBytes) {
+            segmentStart += segmentBytes;
+            continue;
+        }
+
+        File file = LittleFS.open(segmentPath(segment.sequence), "r");
+        if (!file) {
+            break;
+        }
+        size_t within = offset - segmentStart;
+        size_t bytes = min(length - copied, segmentBytes - within);
+        file.seek(sizeof(PressureFileHeader) + within, SeekSet);
+        size_t got = file.read(buffer + copied, bytes);
+        file.close();
+
+        copied += got;
+        offset += got;
+        if (got < bytes) {
+            break;
+        }
+        segmentStart += segmentBytes;
+    }
+
+    return copied;
+}
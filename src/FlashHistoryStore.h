@@ -0,0 +1,71 @@
+#ifndef FLASHHISTORYSTORE_H
+#define FLASHHISTORYSTORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <vector>
+#include <functional>
+#include "PressureRecord.h"
+
+// Return false from the callback to stop a query early
+typedef std::function<bool(const PressureRecord&)> RecordCallback;
+
+// Cold tier of the pressure history: append-only segment files on flash.
+// Each segment is a PressureFileHeader followed by up to SEGMENT_BLOCKS blocks of
+// BLOCK_RECORDS chronological records. Only a small per-segment index is kept in RAM;
+// a range query binary searches the block start timestamps of the segments it overlaps
+// and reads just the blocks it needs.
+class FlashHistoryStore {
+public:
+    static const uint32_t BLOCK_RECORDS = 64;   // 512 bytes, the unit of flash reads
+    static const uint32_t SEGMENT_BLOCKS = 32;  // 16kb per segment file
+    static const uint32_t SEGMENT_RECORDS = BLOCK_RECORDS * SEGMENT_BLOCKS;
+    static const size_t MAX_SEGMENTS = 48;      // Oldest segment is dropped beyond this
+
+private:
+    static const char* HISTORY_DIR;
+
+    struct Segment {
+        uint32_t sequence;        // File name, increasing with age
+        uint32_t firstTimestamp;
+        uint32_t lastTimestamp;
+        uint32_t count;
+    };
+    std::vector<Segment> segments; // Oldest first
+
+    String segmentPath(uint32_t sequence) const;
+    bool scanSegment(uint32_t sequence, Segment& segment) const;
+    uint32_t findFirstRecord(File& file, const Segment& segment, time_t timestamp) const;
+    bool removeSegment(size_t index);
+
+public:
+    // Build the segment index from the files on flash
+    bool begin();
+
+    // Append chronological records, starting new segments as they fill up
+    bool append(const PressureRecord* records, size_t count);
+
+    // Pass records with from <= timestamp < to to the callback in chronological order.
+    // Returns the number of records visited.
+    size_t query(time_t from, time_t to, RecordCallback callback) const;
+
+    // Delete segments that only contain records older than the cutoff; returns records removed
+    size_t pruneBefore(time_t cutoff);
+
+    // Delete the oldest segment to free space
+    bool dropOldestSegment();
+
+    bool clear();
+
+    uint32_t getRecordCount() const;
+    size_t getSegmentCount() const { return segments.size(); }
+    time_t getFirstTimestamp() const { return segments.empty() ? 0 : segments.front().firstTimestamp; }
+    time_t getLastTimestamp() const { return segments.empty() ? 0 : segments.back().lastTimestamp; }
+
+    // The whole store viewed as a single history file (header plus all records),
+    // used for the bulk export
+    size_t getExportSize() const;
+    size_t readExport(size_t offset, uint8_t* buffer, size_t length) const;
+};
+
+#endif // FLASHHISTORYSTORE_H
@@ -0,0 +1,60 @@
+#include "PowerManager.h"
+
+PowerManager::PowerManager()
+    : maxMode(SLEEP_LIGHT), mode(SLEEP_MODEM), lastRequest(0), requestSeen(false),
+      windowStart(0), activeMicros(0), totalMicros(0), activePercent(-1) {
+}
+
+void PowerManager::noteWebRequest(uint32_t now) {
+    lastRequest = now;
+    requestSeen = true;
+}
+
+bool PowerManager::isWebActive(uint32_t now) const {
+    return requestSeen && now - lastRequest < WEB_ACTIVE_WINDOW;
+}
+
+PowerManager::SleepMode PowerManager::selectMode(uint32_t now, bool backflushActive, bool updating) {
+    SleepMode wanted;
+    if (updating) {
+        wanted = SLEEP_NONE;
+    } else if (backflushActive || isWebActive(now)) {
+        wanted = SLEEP_MODEM;
+    } else {
+        wanted = SLEEP_LIGHT;
+    }
+
+    mode = wanted < maxMode ? wanted : maxMode;
+    return mode;
+}
+
+void PowerManager::recordCycle(uint32_t now, uint32_t activeUs, uint32_t cycleUs) {
+    activeMicros += activeUs;
+    totalMicros += cycleUs;
+
+    if (now - windowStart >= MEASURE_WINDOW) {
+        if (totalMicros > 0) {
+            activePercent = 100.0f * activeMicros / totalMicros;
+        }
+        windowStart = now;
+        activeMicros = 0;
+        totalMicros = 0;
+    }
+}
+
+float PowerManager::getActivePercent() const {
+    // The current measurement until the first one is complete
+    if (activePercent >= 0) {
+        return activePercent;
+    }
+    return totalMicros > 0 ? 100.0f * activeMicros / totalMicros : 100.0f;
+}
+
+const char* PowerManager::modeName(SleepMode mode) {
+    switch (mode) {
+        case SLEEP_NONE:  return "none";
+        case SLEEP_MODEM: return "modem";
+        case SLEEP_LIGHT: return "light";
+    }
+    return "none";
+}
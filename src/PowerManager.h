@@ -0,0 +1,61 @@
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+// Chooses the WiFi sleep mode between the tasks of the main loop and measures
+// how much of the time the CPU is busy, as a proxy for the average current.
+//
+// The loop idles in delay() until the next task is due. In light sleep the SDK
+// suspends the CPU during that delay; the timer ending it (the next task, such
+// as the pressure reading) wakes it, and the station stays associated and
+// wakes on the DTIM beacons that announce incoming TCP. Light sleep adds up to
+// a beacon interval to the response time, so it is only used once no web
+// request has arrived for a while and no backflush is running. During an OTA
+// update the radio does not sleep at all. The WiFi calls are left to the
+// caller, which applies getMode() when it changes.
+
+#include <stdint.h>
+
+class PowerManager {
+public:
+    enum SleepMode : uint8_t {
+        SLEEP_NONE = 0,
+        SLEEP_MODEM = 1,     // Radio off between beacons, CPU running
+        SLEEP_LIGHT = 2      // Radio and CPU suspended while the loop idles
+    };
+
+    static const uint32_t WEB_ACTIVE_WINDOW = 10000;  // ms after a request a client counts as active
+    static const uint32_t MEASURE_WINDOW = 60000;     // ms the active time is averaged over
+
+private:
+    SleepMode maxMode;           // Deepest mode allowed
+    SleepMode mode;              // Selected mode
+    uint32_t lastRequest;        // millis() of the last web request
+    bool requestSeen;
+    uint32_t windowStart;        // millis() the current measurement started
+    uint64_t activeMicros;       // Running tasks in the current measurement
+    uint64_t totalMicros;        // Running and idling in the current measurement
+    float activePercent;         // Of the last full measurement, negative before one
+
+public:
+    PowerManager();
+
+    void setMaxMode(SleepMode deepest) { maxMode = deepest; }
+    SleepMode getMaxMode() const { return maxMode; }
+
+    void noteWebRequest(uint32_t now);
+    bool isWebActive(uint32_t now) const;
+
+    // Mode for the current state; the caller applies it when it changes
+    SleepMode selectMode(uint32_t now, bool backflushActive, bool updating);
+    SleepMode getMode() const { return mode; }
+
+    // Time one loop cycle spent running tasks, and the whole cycle including the idle time
+    void recordCycle(uint32_t now, uint32_t activeUs, uint32_t cycleUs);
+
+    // Share of the time spent running tasks (percent)
+    float getActivePercent() const;
+
+    static const char* modeName(SleepMode mode);
+};
+
+#endif // POWERMANAGER_H
@@ -1,9 +1,34 @@
 #include "PressureLogger.h"
+#include "Profiler.h"
+#include <algorithm>
 
-const char* PressureLogger::LOG_FILE = "/pressure_history.json";
+const char* PressureLogger::LEGACY_BINARY_FILE = "/pressure_history.bin";
+const char* PressureLogger::LEGACY_LOG_FILE = "/pressure_history.json";
  
+static PressureRecord toRecord(const PressureReading& reading) {
+    PressureRecord record;
+    record.timestamp = (uint32_t)reading.timestamp;
+    record.pressure = encodePressure(reading.pressure);
+    record.flags = reading.flags;
+    record.reserved = 0;
+    return record;
+}
+
+static PressureReading fromRecord(const PressureRecord& record) {
+    PressureReading reading;
+    reading.timestamp = record.timestamp;
+    reading.pressure = decodePressure(record.pressure);
+    reading.flags = record.flags;
+    return reading;
+}
+
+// Readings taken while the pump was stopped say nothing about the filter
+static bool inClogFit(const PressureReading& reading) {
+    return !(reading.flags & PRESSURE_FLAG_PUMP_OFF);
+}
+
 PressureLogger::PressureLogger(TimeManager& tm, Settings& settings) 
-    : timeManager(tm), settings(&settings), initialized(false), lastRecordedPressure(0), lastSaveTime(0) {
+    : timeManager(tm), settings(&settings), unsavedCount(0), initialized(false), maxReadings(MIN_READINGS), lastCapacityCheck(0), lastRecordedPressure(0), lastSaveTime(0), clogWindowStart(0), pendingMarkerCount(0) {
 }
 
 void PressureLogger::begin() {
@@ -13,39 +38,125 @@ void PressureLogger::begin() {
         return;
     }
     
-    // Load existing readings
-    if (loadReadings()) {
+    history.begin();
+    updateCapacity();
+    pumpRuntime.setOnThreshold(settings->getPumpOnThreshold());
+    
+    // Move a history written by older firmware into the flash tier, otherwise
+    // load the recent readings from it
+    bool migrateLegacy = false;
+    if (history.getRecordCount() == 0 && (loadReadings() || loadLegacyReadings())) {
+        Serial.println("Migrating pressure readings to the segmented history store");
+        unsavedCount = readings.size();
+        migrateLegacy = true;
+    } else {
+        loadHotTier();
+    }
+    
+    // Readings taken after the last flash write are still in RTC memory after a soft reset
+    recoverRtcReadings();
+    
+    // Loaded first, as the clogging rate fit starts at the last backflush
+    markerLog.load();
+    
+    if (!readings.empty()) {
         Serial.println("Pressure readings loaded successfully");
         Serial.print("Number of readings: ");
         Serial.println(readings.size());
         
-        // If we have readings, set the last recorded pressure
-        if (!readings.empty()) {
-            lastRecordedPressure = readings.back().pressure;
-        }
+        // Continue from the last recorded pressure
+        lastRecordedPressure = readings.back().pressure;
+        
+        // Fit the readings since the last backflush within the window, as before the reboot
+        time_t latest = readings.back().timestamp;
+        time_t since = latest - CLOG_RATE_WINDOW;
+        markerLog.getMarkers(since, latest + 1, [&since](const EventMarker& marker) {
+            if (marker.type == MARKER_BACKFLUSH_END && (time_t)marker.timestamp > since) {
+                since = marker.timestamp;
+            }
+        });
+        rebuildClogRate(since);
     } else {
-        Serial.println("No pressure readings found or error loading readings");
-        readings.clear();
+        Serial.println("No pressure readings found");
     }
     
+    dailySketches.load();
+    pumpRuntime.load();
+    
     initialized = true;
     
+    // Write migrated and recovered readings to the flash tier, and drop the old files
+    if (unsavedCount > 0 && saveReadings() && migrateLegacy) {
+        LittleFS.remove(LEGACY_BINARY_FILE);
+        LittleFS.remove(LEGACY_LOG_FILE);
+    }
+    
     // Check space and trim if needed
     checkSpaceAndTrim();
 }
 
 bool PressureLogger::loadReadings() {
     // Check if file exists
-    if (!LittleFS.exists(LOG_FILE)) {
+    if (!LittleFS.exists(LEGACY_BINARY_FILE)) {
         return false;
     }
     
-    File file = LittleFS.open(LOG_FILE, "r");
+    File file = LittleFS.open(LEGACY_BINARY_FILE, "r");
     if (!file) {
         Serial.println("Failed to open pressure log file for reading");
         return false;
     }
     
+    // Validate header
+    PressureFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || !isValidPressureFileHeader(header)) {
+        Serial.println("Invalid pressure log file header");
+        file.close();
+        return false;
+    }
+    file.seek(header.headerSize, SeekSet);
+    
+    // Clear existing readings
+    readings.clear();
+    readings.reserve(min((size_t)header.recordCount, maxReadings));
+    
+    // Read records one at a time, skipping any fields added by newer versions
+    for (uint32_t i = 0; i < header.recordCount; i++) {
+        PressureRecord record;
+        if (file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+            Serial.println("Pressure log file truncated");
+            break;
+        }
+        if (header.recordSize > sizeof(record)) {
+            file.seek(header.recordSize - sizeof(record), SeekCur);
+        }
+        
+        PressureReading reading;
+        reading.timestamp = record.timestamp;
+        reading.pressure = decodePressure(record.pressure, header.pressureScale);
+        reading.flags = record.flags;
+        readings.push_back(reading);
+    }
+    
+    file.close();
+    
+    // Keep only the newest readings if the file holds more than we keep in memory
+    trimOldReadings(maxReadings);
+    return true;
+}
+
+bool PressureLogger::loadLegacyReadings() {
+    // Check if file exists
+    if (!LittleFS.exists(LEGACY_LOG_FILE)) {
+        return false;
+    }
+    
+    File file = LittleFS.open(LEGACY_LOG_FILE, "r");
+    if (!file) {
+        Serial.println("Failed to open legacy pressure log file for reading");
+        return false;
+    }
+    
     // Parse JSON
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, file);
@@ -66,44 +177,76 @@ bool PressureLogger::loadReadings() {
         PressureReading reading;
         reading.timestamp = readingObj["time"].as<time_t>();
         reading.pressure = readingObj["pressure"].as<float>();
+        reading.flags = 0;
         readings.push_back(reading);
     }
     
     return true;
 }
 
-bool PressureLogger::saveReadings() {
-    // Check if initialized
-    if (!initialized) {
-        return false;
+void PressureLogger::loadHotTier() {
+    readings.clear();
+    if (history.getRecordCount() == 0) {
+        return;
     }
     
-    // Create JSON document
-    JsonDocument doc;
-    JsonArray readingsArray = doc["readings"].to<JsonArray>();
+    time_t newest = history.getLastTimestamp();
+    history.query(newest - HOT_TIER_WINDOW, newest + 1, [this](const PressureRecord& record) {
+        readings.push_back(fromRecord(record));
+        return true;
+    });
+    trimOldReadings(maxReadings);
+}
+
+void PressureLogger::recoverRtcReadings() {
+    if (!rtcBuffer.recover() || rtcBuffer.getCount() == 0) {
+        return;
+    }
     
-    // Add readings to JSON
-    for (const PressureReading& reading : readings) {
-        JsonObject readingObj = readingsArray.add<JsonObject>();
-        readingObj["time"] = reading.timestamp;
-        readingObj["pressure"] = reading.pressure;
+    // Skip anything that reached flash before the reset
+    time_t lastSaved = readings.empty() ? history.getLastTimestamp() : readings.back().timestamp;
+    size_t recovered = 0;
+    for (size_t i = 0; i < rtcBuffer.getCount(); i++) {
+        PressureReading reading = fromRecord(rtcBuffer.get(i));
+        if (reading.timestamp <= lastSaved) {
+            continue;
+        }
+        readings.push_back(reading);
+        unsavedCount++;
+        recovered++;
     }
     
-    // Open file for writing
-    File file = LittleFS.open(LOG_FILE, "w");
-    if (!file) {
-        Serial.println("Failed to open pressure log file for writing");
+    Serial.print("Recovered ");
+    Serial.print(recovered);
+    Serial.println(" unsaved pressure readings from RTC memory");
+}
+
+bool PressureLogger::saveReadings() {
+    // Check if initialized
+    if (!initialized) {
         return false;
     }
     
-    // Write JSON to file
-    if (serializeJson(doc, file) == 0) {
-        Serial.println("Failed to write pressure log to file");
-        file.close();
-        return false;
+    // Append the readings added since the last save to the flash tier, a buffer at a time
+    PressureRecord buffer[32];
+    while (unsavedCount > 0) {
+        size_t start = readings.size() - unsavedCount;
+        size_t batch = min(unsavedCount, (size_t)32);
+        for (size_t i = 0; i < batch; i++) {
+            buffer[i] = toRecord(readings[start + i]);
+        }
+        
+        if (!history.append(buffer, batch)) {
+            Serial.println("Failed to write pressure readings to flash");
+            return false;
+        }
+        unsavedCount -= batch;
     }
     
-    file.close();
+    // Everything is on flash now
+    rtcBuffer.clear();
+    dailySketches.save();
+    pumpRuntime.save();
     lastSaveTime = millis();
     return true;
 }
@@ -118,6 +261,13 @@ void PressureLogger::addReading(float pressure, bool force) {
     time_t currentGMTTime = timeManager.getCurrentGMTTime();
     static time_t lastRecordedTime = 0;
     
+    // Every sample goes into the day's distribution and the pump runtime, whether it is logged or not
+    bool pumpOn = true;
+    if (currentGMTTime >= 1609459200) {
+        dailySketches.add(getLocalDay(currentGMTTime), pressure);
+        pumpOn = pumpRuntime.update(timeManager.gmtToLocal(currentGMTTime), pressure);
+    }
+    
     // Only record if pressure has changed significantly or it's the first reading
     if (readings.empty() 
         || abs(pressure - lastRecordedPressure) >= settings->getPressureChangeThreshold()
@@ -132,16 +282,11 @@ void PressureLogger::addReading(float pressure, bool force) {
         PressureReading reading;
         reading.timestamp = currentGMTTime; // Store in GMT
         reading.pressure = pressure;
+        reading.flags = (force ? PRESSURE_FLAG_FORCED : 0) | (pumpOn ? 0 : PRESSURE_FLAG_PUMP_OFF);
         
-        readings.push_back(reading);
-        lastRecordedPressure = pressure;
+        storeReading(reading);
         lastRecordedTime = currentGMTTime;
         
-        // Trim old readings if we exceed maximum
-        if (readings.size() > MAX_READINGS) {
-            trimOldReadings(MAX_READINGS);
-        }
-        
         // Save immediately if this is the first reading or save interval has passed
         unsigned long currentMillis = millis();
         if (readings.size() == 1 || currentMillis - lastSaveTime >= saveInterval) {
@@ -157,18 +302,43 @@ void PressureLogger::addReadingWithTimestamp(const PressureReading& reading) {
     }
     
     // Add the reading with the provided timestamp
+    storeReading(reading);
+    
+    // Save readings periodically in the update() function
+}
+
+void PressureLogger::storeReading(const PressureReading& reading) {
+    // Flush before the RTC copy would start overwriting unsaved readings
+    if (rtcBuffer.isFull()) {
+        saveReadings();
+    }
+    
     readings.push_back(reading);
+    unsavedCount++;
+    rtcBuffer.append(toRecord(reading));
     lastRecordedPressure = reading.pressure;
+    updateClogRate(reading);
     
-    // Trim old readings if we exceed maximum
-    if (readings.size() > MAX_READINGS) {
-        trimOldReadings(MAX_READINGS);
+    // Keep only the recent window in RAM, and never more than the maximum
+    trimHotTier();
+    if (readings.size() > maxReadings) {
+        trimOldReadings(maxReadings);
     }
-    
-    // Save readings periodically in the update() function
 }
 
 void PressureLogger::update() {
+    PROFILE_STAGE(PROFILE_HISTORY);
+    
+    // Timestamp markers raised before the clock was set
+    if (pendingMarkerCount > 0) {
+        flushPendingMarkers();
+    }
+    
+    // Follow the free heap as web clients come and go
+    if (initialized && millis() - lastCapacityCheck >= capacityCheckInterval) {
+        updateCapacity();
+    }
+    
     // Check if we need to save readings
     if (initialized && !readings.empty()) {
         unsigned long currentTime = millis();
@@ -213,11 +383,24 @@ void PressureLogger::pruneOldData() {
     
     // Remove old readings
     if (removeCount > 0) {
-        readings.erase(readings.begin(), readings.begin() + removeCount);
+        eraseOldestReadings(removeCount);
         Serial.print("Pruned ");
         Serial.print(removeCount);
         Serial.println(" old readings based on retention period");
     }
+    
+    // Drop flash segments that are entirely past the retention period
+    size_t removedFromFlash = history.pruneBefore(cutoffTime);
+    if (removedFromFlash > 0) {
+        Serial.print("Pruned ");
+        Serial.print(removedFromFlash);
+        Serial.println(" old readings from flash");
+    }
+    
+    // Markers follow the same retention period
+    if (markerLog.pruneBefore(cutoffTime) > 0) {
+        markerLog.save();
+    }
 }
 
 String PressureLogger::getReadingsAsJson() {
@@ -248,6 +431,9 @@ String PressureLogger::getPaginatedReadingsAsJson(int page, int limit, int& tota
         JsonObject readingObj = readingsArray.add<JsonObject>();
         readingObj["time"] = reading.timestamp;
         readingObj["pressure"] = reading.pressure;
+        if (reading.flags & PRESSURE_FLAG_FORCED) {
+            readingObj["forced"] = true;
+        }
     }
     
     // Add pagination info
@@ -263,14 +449,18 @@ String PressureLogger::getPaginatedReadingsAsJson(int page, int limit, int& tota
 bool PressureLogger::clearReadings() {
     // Clear readings
     readings.clear();
+    unsavedCount = 0;
+    rtcBuffer.clear();
+    dailySketches.clear();
+    pumpRuntime.clear();
     lastRecordedPressure = 0;
+    clogRate.reset(clogWindowStart);
+    markerLog.clear();
     
-    // Delete file
-    if (LittleFS.exists(LOG_FILE)) {
-        if (!LittleFS.remove(LOG_FILE)) {
-            Serial.println("Failed to delete pressure log file");
-            return false;
-        }
+    // Delete the flash tier
+    if (!history.clear()) {
+        Serial.println("Failed to delete pressure history files");
+        return false;
     }
     
     return true;
@@ -284,28 +474,235 @@ void PressureLogger::trimOldReadings(size_t maxEntries) {
     // Calculate how many entries to remove
     size_t entriesToRemove = readings.size() - maxEntries;
     
+    // Write out readings that are about to leave RAM before they reach flash
+    if (entriesToRemove > readings.size() - unsavedCount) {
+        saveReadings();
+    }
+    
     // Remove oldest entries
-    readings.erase(readings.begin(), readings.begin() + entriesToRemove);
+    eraseOldestReadings(entriesToRemove);
     
     Serial.print("Trimmed ");
     Serial.print(entriesToRemove);
     Serial.println(" old pressure readings");
 }
 
+void PressureLogger::eraseOldestReadings(size_t count) {
+    count = min(count, readings.size());
+    
+    // Take the erased readings out of the clogging rate fit as well
+    for (size_t i = 0; i < count; i++) {
+        if (readings[i].timestamp >= clogWindowStart && inClogFit(readings[i])) {
+            clogRate.removeSample(readings[i].timestamp, readings[i].pressure);
+        }
+    }
+    
+    readings.erase(readings.begin(), readings.begin() + count);
+    unsavedCount = min(unsavedCount, readings.size());
+}
+
+void PressureLogger::updateCapacity() {
+    lastCapacityCheck = millis();
+    
+    // The readings may use the heap beyond the reserve, including what they already hold
+    size_t reserve = settings ? settings->getHeapReserve() : 16384;
+    size_t held = readings.capacity() * sizeof(PressureReading);
+    size_t freeHeap = ESP.getFreeHeap();
+    size_t budget = freeHeap >= reserve ? held + (freeHeap - reserve) : held - min(held, reserve - freeHeap);
+    
+    // The vector is a single allocation, so it is also limited by the largest free block
+    size_t contiguous = max((size_t)ESP.getMaxFreeBlockSize(), held);
+    size_t target = constrain(min(budget, contiguous) / sizeof(PressureReading), MIN_READINGS, MAX_READINGS_LIMIT);
+    
+    // Ignore changes under 10% so the vector isn't reallocated back and forth
+    if (target * 10 > maxReadings * 9 && target * 10 < maxReadings * 11) {
+        return;
+    }
+    
+    Serial.print("Pressure history capacity: ");
+    Serial.print(maxReadings);
+    Serial.print(" -> ");
+    Serial.print(target);
+    Serial.print(" readings (");
+    Serial.print(freeHeap);
+    Serial.println(" bytes free)");
+    
+    if (target < maxReadings) {
+        // Shrink: drop the oldest readings (saving any unsaved ones first) and release the memory
+        maxReadings = target;
+        trimOldReadings(maxReadings);
+        if (ESP.getMaxFreeBlockSize() >= maxReadings * sizeof(PressureReading)) {
+            readings.shrink_to_fit();
+        }
+    } else {
+        // Grow: claim the memory now so later readings don't reallocate
+        maxReadings = target;
+        readings.reserve(maxReadings);
+    }
+}
+
+void PressureLogger::trimHotTier() {
+    if (readings.empty()) {
+        return;
+    }
+    
+    // Older readings are served from flash; unsaved ones stay until they are written
+    time_t cutoff = readings.back().timestamp - HOT_TIER_WINDOW;
+    size_t saved = readings.size() - unsavedCount;
+    size_t expired = 0;
+    while (expired < saved && readings[expired].timestamp < cutoff) {
+        expired++;
+    }
+    
+    if (expired > 0) {
+        eraseOldestReadings(expired);
+    }
+}
+
+size_t PressureLogger::queryReadings(time_t from, time_t to, ReadingCallback callback) const {
+    size_t count = 0;
+    
+    // RAM holds every reading from its oldest one onwards, so only older ranges go to flash
+    time_t hotStart = readings.empty() ? to : readings.front().timestamp;
+    if (from < hotStart) {
+        count += history.query(from, min(to, hotStart), [&](const PressureRecord& record) {
+            callback(fromRecord(record));
+            return true;
+        });
+    }
+    
+    if (to > hotStart) {
+        auto it = std::lower_bound(readings.begin(), readings.end(), max(from, hotStart),
+                                   [](const PressureReading& r, time_t t) { return r.timestamp < t; });
+        for (; it != readings.end() && it->timestamp < to; ++it) {
+            callback(*it);
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+void PressureLogger::updateClogRate(const PressureReading& reading) {
+    if (reading.timestamp < clogWindowStart) {
+        return;
+    }
+    
+    // Slide the window forward, removing readings that fell out of it.
+    // Readings are in chronological order, so only the expired ones are visited.
+    time_t cutoff = reading.timestamp - CLOG_RATE_WINDOW;
+    if (clogWindowStart < cutoff) {
+        auto it = std::lower_bound(readings.begin(), readings.end(), clogWindowStart,
+                                   [](const PressureReading& r, time_t t) { return r.timestamp < t; });
+        for (; it != readings.end() && it->timestamp < cutoff; ++it) {
+            if (inClogFit(*it)) {
+                clogRate.removeSample(it->timestamp, it->pressure);
+            }
+        }
+        clogWindowStart = cutoff;
+    }
+    
+    if (inClogFit(reading)) {
+        clogRate.addSample(reading.timestamp, reading.pressure);
+    }
+}
+
+void PressureLogger::rebuildClogRate(time_t since) {
+    clogRate.reset(since);
+    clogWindowStart = since;
+    
+    auto it = std::lower_bound(readings.begin(), readings.end(), since,
+                               [](const PressureReading& r, time_t t) { return r.timestamp < t; });
+    for (; it != readings.end(); ++it) {
+        if (inClogFit(*it)) {
+            clogRate.addSample(it->timestamp, it->pressure);
+        }
+    }
+}
+
+bool PressureLogger::getClogRatePerPumpHour(float& barPerPumpHour) const {
+    float barPerDay, stdError;
+    if (!timeManager.isTimeInitialized() || !clogRate.getSlope(barPerDay, stdError)) {
+        return false;
+    }
+    
+    // The filter only clogs while the pump runs, so spread the daily rise over the pump hours
+    float dutyCycle;
+    if (!pumpRuntime.getDutyCycle(getLocalDay(clogWindowStart), getLocalDay(timeManager.getCurrentGMTTime()), dutyCycle) ||
+        dutyCycle < 0.01f) {
+        return false;
+    }
+    
+    barPerPumpHour = barPerDay / (24.0f * dutyCycle);
+    return true;
+}
+
+void PressureLogger::markBackflush() {
+    if (!initialized || !timeManager.isTimeInitialized()) {
+        return;
+    }
+    
+    // The filter is clean again, so the previous trend no longer applies
+    rebuildClogRate(timeManager.getCurrentGMTTime());
+}
+
+void PressureLogger::addMarker(EventMarkerType type, int32_t value) {
+    if (!initialized) {
+        return;
+    }
+    
+    // Without a valid clock, hold the marker until the time is known
+    if (!timeManager.isTimeInitialized() || timeManager.getCurrentGMTTime() < 1609459200) {
+        if (pendingMarkerCount < MAX_PENDING_MARKERS) {
+            PendingMarker& pending = pendingMarkers[pendingMarkerCount++];
+            pending.millisAt = millis();
+            pending.type = type;
+            pending.value = value;
+        }
+        return;
+    }
+    
+    flushPendingMarkers();
+    
+    EventMarker marker = {};
+    marker.timestamp = (uint32_t)timeManager.getCurrentGMTTime();
+    marker.type = type;
+    marker.value = value;
+    markerLog.add(marker);
+    markerLog.save(); // Markers are rare, so persist them straight away
+}
+
+void PressureLogger::flushPendingMarkers() {
+    if (pendingMarkerCount == 0 || !timeManager.isTimeInitialized()) {
+        return;
+    }
+    
+    time_t now = timeManager.getCurrentGMTTime();
+    if (now < 1609459200) { // Jan 1, 2021 timestamp
+        return;
+    }
+    
+    // Backdate each marker by the time elapsed since it was raised
+    unsigned long currentMillis = millis();
+    for (size_t i = 0; i < pendingMarkerCount; i++) {
+        EventMarker marker = {};
+        marker.timestamp = (uint32_t)(now - (currentMillis - pendingMarkers[i].millisAt) / 1000);
+        marker.type = pendingMarkers[i].type;
+        marker.value = pendingMarkers[i].value;
+        markerLog.add(marker);
+    }
+    pendingMarkerCount = 0;
+    markerLog.save();
+}
+
 bool PressureLogger::checkSpaceAndTrim() {
     // Check if filesystem space is low
     if (checkFileSystemSpace()) {
         Serial.println("Low space detected, trimming pressure logs");
         
-        // Trim pressure readings if they exist
-        if (!readings.empty()) {
-            // Keep only half of the readings
-            size_t keepEntries = readings.size() / 2;
-            if (keepEntries < 100) {
-                keepEntries = 100; // Keep at least 100 entries
-            }
-            trimOldReadings(keepEntries);
-            saveReadings();
+        // Drop the oldest flash segment; the readings in RAM are kept
+        if (history.dropOldestSegment()) {
+            Serial.println("Removed oldest pressure history segment");
         }
         
         return true;
@@ -314,29 +711,142 @@ bool PressureLogger::checkSpaceAndTrim() {
     return false;
 }
 
-String PressureLogger::getReadingsAsCsv() {
-    String csv = F("Timestamp,Date,Time,Pressure (bar)\r\n");
+// Running aggregate for one query bucket. Memory use is constant regardless of how
+// many readings fall into the bucket; P95 is estimated from a fixed-size histogram.
+class BucketAccumulator {
+public:
+    static const int HISTOGRAM_BINS = 128;
+    
+    BucketAccumulator(AggregateFunction function, float maxPressure)
+        : function(function), binWidth(maxPressure / HISTOGRAM_BINS) {
+        reset(0);
+    }
+    
+    void reset(time_t bucketStart) {
+        start = bucketStart;
+        count = 0;
+        sum = 0;
+        if (function == AggregateFunction::P95) {
+            memset(histogram, 0, sizeof(histogram));
+        }
+    }
     
-    for (const auto& reading : readings) {
-        // Format date and time
-        struct tm* timeinfo = gmtime(&reading.timestamp);
-        char dateStr[11];
-        char timeStr[9];
-        strftime(dateStr, sizeof(dateStr), "%Y-%m-%d", timeinfo);
-        strftime(timeStr, sizeof(timeStr), "%H:%M:%S", timeinfo);
+    void add(float pressure) {
+        if (count == 0) {
+            minValue = maxValue = first = pressure;
+        }
+        minValue = min(minValue, pressure);
+        maxValue = max(maxValue, pressure);
+        last = pressure;
+        sum += pressure;
+        count++;
+        
+        if (function == AggregateFunction::P95) {
+            int bin = constrain((int)(pressure / binWidth), 0, HISTOGRAM_BINS - 1);
+            if (histogram[bin] < UINT16_MAX) {
+                histogram[bin]++;
+            }
+        }
+    }
+    
+    bool empty() const { return count == 0; }
+    time_t getStart() const { return start; }
+    
+    AggregateBucket result() const {
+        AggregateBucket bucket;
+        bucket.start = start;
+        bucket.count = count;
         
-        // Add row to CSV
-        csv += String(reading.timestamp);
-        csv += F(",");
-        csv += dateStr;
-        csv += F(",");
-        csv += timeStr;
-        csv += F(",");
-        csv += String(reading.pressure, 2);
-        csv += F("\r\n");
-    }
-    
-    return csv;
+        switch (function) {
+            case AggregateFunction::MIN:   bucket.value = minValue; break;
+            case AggregateFunction::MAX:   bucket.value = maxValue; break;
+            case AggregateFunction::AVG:   bucket.value = (float)(sum / count); break;
+            case AggregateFunction::COUNT: bucket.value = count; break;
+            case AggregateFunction::FIRST: bucket.value = first; break;
+            case AggregateFunction::LAST:  bucket.value = last; break;
+            case AggregateFunction::P95:   bucket.value = percentile(0.95f); break;
+        }
+        return bucket;
+    }
+    
+private:
+    AggregateFunction function;
+    float binWidth;
+    time_t start;
+    uint32_t count;
+    double sum;
+    float minValue, maxValue, first, last;
+    uint16_t histogram[HISTOGRAM_BINS];
+    
+    float percentile(float fraction) const {
+        uint32_t target = (uint32_t)ceil(fraction * count);
+        uint32_t cumulative = 0;
+        for (int bin = 0; bin < HISTOGRAM_BINS; bin++) {
+            cumulative += histogram[bin];
+            if (cumulative >= target) {
+                // Use the bin centre, but never report beyond the observed range
+                return constrain((bin + 0.5f) * binWidth, minValue, maxValue);
+            }
+        }
+        return maxValue;
+    }
+};
+
+size_t PressureLogger::queryAggregate(time_t from, time_t to, uint32_t bucketSeconds,
+                                      AggregateFunction function, AggregateCallback callback) const {
+    if (bucketSeconds == 0 || from >= to) {
+        return 0;
+    }
+    
+    float maxPressure = settings ? settings->getSensorMaxPressure() : 4.0f;
+    BucketAccumulator accumulator(function, maxPressure);
+    size_t buckets = 0;
+    
+    // Readings arrive in chronological order across both tiers, so stream through once
+    queryReadings(from, to, [&](const PressureReading& reading) {
+        // Buckets are aligned to multiples of the bucket size so results are stable across queries
+        time_t bucketStart = reading.timestamp - (reading.timestamp % bucketSeconds);
+        if (accumulator.empty() || bucketStart != accumulator.getStart()) {
+            if (!accumulator.empty()) {
+                callback(accumulator.result());
+                buckets++;
+            }
+            accumulator.reset(bucketStart);
+        }
+        accumulator.add(reading.pressure);
+    });
+    
+    if (!accumulator.empty()) {
+        callback(accumulator.result());
+        buckets++;
+    }
+    
+    return buckets;
+}
+
+bool PressureLogger::parseAggregateFunction(const String& name, AggregateFunction& function) {
+    if (name == "min") function = AggregateFunction::MIN;
+    else if (name == "max") function = AggregateFunction::MAX;
+    else if (name == "avg") function = AggregateFunction::AVG;
+    else if (name == "count") function = AggregateFunction::COUNT;
+    else if (name == "first") function = AggregateFunction::FIRST;
+    else if (name == "last") function = AggregateFunction::LAST;
+    else if (name == "p95") function = AggregateFunction::P95;
+    else return false;
+    return true;
+}
+
+const char* PressureLogger::aggregateFunctionName(AggregateFunction function) {
+    switch (function) {
+        case AggregateFunction::MIN:   return "min";
+        case AggregateFunction::MAX:   return "max";
+        case AggregateFunction::AVG:   return "avg";
+        case AggregateFunction::COUNT: return "count";
+        case AggregateFunction::FIRST: return "first";
+        case AggregateFunction::LAST:  return "last";
+        case AggregateFunction::P95:   return "p95";
+    }
+    return "avg";
 }
 
 bool PressureLogger::checkFileSystemSpace() {
@@ -5,30 +5,99 @@
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <vector>
+#include <functional>
 #include "TimeManager.h"
 #include "Settings.h"
+#include "ClogRateEstimator.h"
+#include "PressureRecord.h"
+#include "EventMarkerLog.h"
+#include "FlashHistoryStore.h"
+#include "RtcReadingBuffer.h"
+#include "DailySketches.h"
+#include "PumpRuntime.h"
 
 // Structure to hold pressure reading with timestamp
 struct PressureReading {
     time_t timestamp;
     float pressure;
+    uint8_t flags; // PRESSURE_FLAG_* bits
 };
 
+// Aggregate functions supported by range queries
+enum class AggregateFunction {
+    MIN,
+    MAX,
+    AVG,
+    COUNT,
+    FIRST,
+    LAST,
+    P95
+};
+
+// One aggregated time bucket of a range query
+struct AggregateBucket {
+    time_t start;     // Bucket start (GMT), aligned to a multiple of the bucket size
+    float value;      // Aggregated pressure (or number of readings for COUNT)
+    uint32_t count;   // Number of readings in the bucket
+};
+
+typedef std::function<void(const AggregateBucket&)> AggregateCallback;
+typedef std::function<void(const PressureReading&)> ReadingCallback;
+
+// Pressure history in two tiers: the most recent readings in RAM (hot) and
+// everything written so far in segment files on flash (cold).
 class PressureLogger {
 private:
-    static const char* LOG_FILE;
-    static const size_t MAX_READINGS = 500; // about 8kb
+    static const char* LEGACY_BINARY_FILE; // Single-file binary history written by older firmware
+    static const char* LEGACY_LOG_FILE;    // JSON history written by older firmware
+    static const size_t MIN_READINGS = 100;        // Kept even when memory is short
+    static const size_t MAX_READINGS_LIMIT = 4000; // about 64kb
+    static const time_t HOT_TIER_WINDOW = 3 * 24 * 60 * 60; // Readings kept in RAM, covers CLOG_RATE_WINDOW
     
     TimeManager& timeManager;
     Settings* settings; // Reference to settings for data retention period
-    std::vector<PressureReading> readings;
+    std::vector<PressureReading> readings; // Hot tier, chronological
+    FlashHistoryStore history;             // Cold tier
+    size_t unsavedCount;                   // Newest readings not yet appended to flash
+    RtcReadingBuffer rtcBuffer;            // Copy of the unsaved readings that survives a reset
+    DailySketches dailySketches;           // Per-day pressure distribution of every sample
+    PumpRuntime pumpRuntime;               // Pump on/off state and runtime per day, from every sample
     bool initialized;
+    size_t maxReadings; // Hot tier capacity, sized from the free heap
+    unsigned long lastCapacityCheck;
+    const unsigned long capacityCheckInterval = 60000; // Resize at most once a minute
     float lastRecordedPressure;
     unsigned long lastSaveTime;
-    const unsigned long saveInterval = 300000; // Save to file every 5 minutes
+    const unsigned long saveInterval = 1800000; // Save to flash every 30 minutes, unsaved readings are kept in RTC memory
+    
+    // Clogging rate over the readings since the last backflush, while the pump was running
+    static const time_t CLOG_RATE_WINDOW = 3 * 24 * 60 * 60; // Only fit the last 3 days
+    ClogRateEstimator clogRate;
+    time_t clogWindowStart; // Oldest reading timestamp still included in clogRate
+    
+    // Event markers, plus markers raised before the clock was set (timestamped once it is)
+    struct PendingMarker {
+        unsigned long millisAt;
+        uint8_t type;
+        int32_t value;
+    };
+    static const size_t MAX_PENDING_MARKERS = 4;
+    EventMarkerLog markerLog;
+    PendingMarker pendingMarkers[MAX_PENDING_MARKERS];
+    size_t pendingMarkerCount;
     
     bool loadReadings();
+    bool loadLegacyReadings();
+    void loadHotTier();
+    void recoverRtcReadings();
+    void storeReading(const PressureReading& reading);
+    void trimHotTier();
     void trimOldReadings(size_t maxEntries);
+    void updateCapacity();
+    void eraseOldestReadings(size_t count);
+    void updateClogRate(const PressureReading& reading);
+    void rebuildClogRate(time_t since);
+    void flushPendingMarkers();
     
 public:
     PressureLogger(TimeManager& tm, Settings& settings);
@@ -39,7 +108,11 @@ public:
     bool saveReadings(); // Made public for forced saves
     void update(); // Call this regularly to check if we need to save
     
-    // Get readings for web display
+    // Readings with from <= timestamp < to (GMT) from both tiers, in chronological order.
+    // Ranges within the hot tier never touch flash. Returns the number of readings.
+    size_t queryReadings(time_t from, time_t to, ReadingCallback callback) const;
+    
+    // Get recent (hot tier) readings for web display
     String getReadingsAsJson();
     
     // Get paginated readings for web display
@@ -51,7 +124,7 @@ public:
     // Check available space
     bool checkSpaceAndTrim();
     
-    // Get all readings as a vector
+    // Get the hot tier readings as a vector
     std::vector<PressureReading> getAllReadings() const {
         return readings; // Return a copy of the readings vector
     }
@@ -69,11 +142,22 @@ public:
         return result;
     }
     
-    // Get readings as CSV
-    String getReadingsAsCsv();
+    // Aggregate readings in [from, to) into buckets of bucketSeconds in a single pass.
+    // Non-empty buckets are passed to the callback in chronological order.
+    // Returns the number of buckets produced.
+    size_t queryAggregate(time_t from, time_t to, uint32_t bucketSeconds,
+                          AggregateFunction function, AggregateCallback callback) const;
     
-    // Get number of readings
+    // Parse/format aggregate function names ("min", "max", "avg", "count", "first", "last", "p95")
+    static bool parseAggregateFunction(const String& name, AggregateFunction& function);
+    static const char* aggregateFunctionName(AggregateFunction function);
+    
+    // Get number of readings in RAM, and in both tiers together
     size_t getReadingCount() { return readings.size(); }
+    size_t getTotalReadingCount() const { return history.getRecordCount() + unsavedCount; }
+    
+    // Number of readings the RAM tier may currently hold
+    size_t getCapacity() const { return maxReadings; }
     
     // Set settings reference (used when settings are updated)
     void setSettings(Settings& settings) { this->settings = &settings; }
@@ -81,6 +165,35 @@ public:
     // Prune data older than retention period
     void pruneOldData();
     
+    // Restart the clogging rate fit, called when a backflush completes
+    void markBackflush();
+    
+    // Clogging rate estimate over the readings since the last backflush
+    const ClogRateEstimator& getClogRate() const { return clogRate; }
+    
+    // Clogging rate per hour of pump runtime, from the fitted rate and the
+    // duty cycle over the days of the fit window
+    bool getClogRatePerPumpHour(float& barPerPumpHour) const;
+    
+    // Pump state and runtime per local day
+    const PumpRuntime& getPumpRuntime() const { return pumpRuntime; }
+    void setPumpOnThreshold(float bar) { pumpRuntime.setOnThreshold(bar); }
+    
+    // Record an event marker at the current time
+    void addMarker(EventMarkerType type, int32_t value = 0);
+    
+    // Markers in [from, to) (GMT) in chronological order; returns how many
+    size_t getMarkers(time_t from, time_t to, MarkerCallback callback) const {
+        return markerLog.getMarkers(from, to, callback);
+    }
+    
+    // Pressure distribution per local day (days since epoch), fed with every sample
+    const DailySketches& getDailySketches() const { return dailySketches; }
+    uint32_t getLocalDay(time_t gmtTime) const { return timeManager.gmtToLocal(gmtTime) / 86400; }
+    
+    // Flash tier, streamed as a single history file by the bulk export
+    const FlashHistoryStore& getHistoryStore() const { return history; }
+    
     // Static method to check space on filesystem
     static bool checkFileSystemSpace();
 };
@@ -0,0 +1,120 @@
+#ifndef PRESSURERECORD_H
+#define PRESSURERECORD_H
+
+// Compact binary pressure history format, shared by the firmware and host tools.
+// Depends only on the C++ standard library so it can be compiled on the host.
+//
+// A history file (and the /api/pressure/export.bin stream) is a PressureFileHeader
+// followed by recordCount PressureRecord entries. All fields are little-endian.
+// Readers must use headerSize and recordSize to skip fields they do not know.
+//
+// Event markers use the same header layout with MARKER_FILE_MAGIC, followed by
+// recordCount EventMarker entries in chronological order.
+
+#include <stdint.h>
+#include <math.h>
+
+static const uint32_t PRESSURE_FILE_MAGIC = 0x52504650;  // "PFPR"
+static const uint16_t PRESSURE_FILE_VERSION = 1;
+static const uint16_t PRESSURE_SCALE = 1000;             // Record units per bar (millibar)
+static const uint32_t MARKER_FILE_MAGIC = 0x4D454650;    // "PFEM"
+
+// PressureRecord::flags bits
+static const uint8_t PRESSURE_FLAG_FORCED = 0x01;        // Logged regardless of the change threshold
+static const uint8_t PRESSURE_FLAG_PUMP_OFF = 0x02;      // Pump was inferred to be stopped
+
+// EventMarker::type values
+enum EventMarkerType : uint8_t {
+    MARKER_BACKFLUSH_START = 1,  // value: trigger pressure (mbar)
+    MARKER_BACKFLUSH_END = 2,    // value: duration (seconds)
+    MARKER_REBOOT = 3,           // value: reset reason
+    MARKER_TIME_SYNC = 4,        // value: clock step (seconds), 0 for the first sync after boot
+    MARKER_SETTINGS_CHANGE = 5,  // value: 0
+    MARKER_PUMP_START = 6,       // value: pressure (mbar)
+    MARKER_PUMP_STOP = 7,        // value: pressure (mbar)
+    MARKER_ABNORMAL_RISE = 8     // value: pressure (mbar)
+};
+
+struct __attribute__((packed)) PressureFileHeader {
+    uint32_t magic;          // PRESSURE_FILE_MAGIC
+    uint16_t version;        // PRESSURE_FILE_VERSION
+    uint16_t headerSize;     // sizeof(PressureFileHeader)
+    uint16_t recordSize;     // sizeof(PressureRecord)
+    uint16_t pressureScale;  // PressureRecord::pressure units per bar
+    uint32_t recordCount;    // Number of records following the header
+};
+
+struct __attribute__((packed)) PressureRecord {
+    uint32_t timestamp;      // GMT seconds since epoch
+    uint16_t pressure;       // bar * pressureScale
+    uint8_t flags;           // PRESSURE_FLAG_* bits
+    uint8_t reserved;        // Reserved, 0
+};
+
+struct __attribute__((packed)) EventMarker {
+    uint32_t timestamp;      // GMT seconds since epoch
+    uint8_t type;            // EventMarkerType
+    uint8_t reserved1;       // Reserved, 0
+    uint16_t reserved2;      // Reserved, 0
+    int32_t value;           // Type specific, see EventMarkerType
+};
+
+static_assert(sizeof(PressureFileHeader) == 16, "PressureFileHeader must be 16 bytes");
+static_assert(sizeof(PressureRecord) == 8, "PressureRecord must be 8 bytes");
+static_assert(sizeof(EventMarker) == 12, "EventMarker must be 12 bytes");
+
+inline void initPressureFileHeader(PressureFileHeader& header, uint32_t recordCount) {
+    header.magic = PRESSURE_FILE_MAGIC;
+    header.version = PRESSURE_FILE_VERSION;
+    header.headerSize = sizeof(PressureFileHeader);
+    header.recordSize = sizeof(PressureRecord);
+    header.pressureScale = PRESSURE_SCALE;
+    header.recordCount = recordCount;
+}
+
+inline bool isValidPressureFileHeader(const PressureFileHeader& header) {
+    return header.magic == PRESSURE_FILE_MAGIC &&
+           header.headerSize >= sizeof(PressureFileHeader) &&
+           header.recordSize >= sizeof(PressureRecord) &&
+           header.pressureScale > 0;
+}
+
+inline void initMarkerFileHeader(PressureFileHeader& header, uint32_t markerCount) {
+    initPressureFileHeader(header, markerCount);
+    header.magic = MARKER_FILE_MAGIC;
+    header.recordSize = sizeof(EventMarker);
+}
+
+inline bool isValidMarkerFileHeader(const PressureFileHeader& header) {
+    return header.magic == MARKER_FILE_MAGIC &&
+           header.headerSize >= sizeof(PressureFileHeader) &&
+           header.recordSize >= sizeof(EventMarker);
+}
+
+inline const char* eventMarkerTypeName(uint8_t type) {
+    switch (type) {
+        case MARKER_BACKFLUSH_START: return "backflush_start";
+        case MARKER_BACKFLUSH_END:   return "backflush_end";
+        case MARKER_REBOOT:          return "reboot";
+        case MARKER_TIME_SYNC:       return "time_sync";
+        case MARKER_SETTINGS_CHANGE: return "settings_change";
+        case MARKER_PUMP_START:      return "pump_start";
+        case MARKER_PUMP_STOP:       return "pump_stop";
+        case MARKER_ABNORMAL_RISE:   return "abnormal_rise";
+    }
+    return "unknown";
+}
+
+// Convert between bar and record units, clamping to the representable range
+inline uint16_t encodePressure(float bar) {
+    long value = lroundf(bar * PRESSURE_SCALE);
+    if (value < 0) return 0;
+    if (value > 0xFFFF) return 0xFFFF;
+    return (uint16_t)value;
+}
+
+inline float decodePressure(uint16_t value, uint16_t scale = PRESSURE_SCALE) {
+    return (float)value / scale;
+}
+
+#endif // PRESSURERECORD_H
@@ -0,0 +1,45 @@
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+Profiler::StageStats Profiler::stages[PROFILE_STAGE_COUNT];
+
+void Profiler::record(ProfileStage stage, uint32_t cycles) {
+    // The cycle counter wraps after 2^32 cycles (53 s at 80 MHz), far beyond any stage
+    uint32_t micros = cycles / ESP.getCpuFreqMHz();
+    StageStats& stats = stages[stage];
+    if (stats.count == 0 || micros < stats.minMicros) {
+        stats.minMicros = micros;
+    }
+    if (micros > stats.maxMicros) {
+        stats.maxMicros = micros;
+    }
+    stats.count++;
+    stats.totalMicros += micros;
+
+    size_t bucket = micros > 1 ? 31 - __builtin_clz(micros) : 0;
+    if (bucket >= HISTOGRAM_BUCKETS) {
+        bucket = HISTOGRAM_BUCKETS - 1;
+    }
+    stats.histogram[bucket]++;
+}
+
+void Profiler::reset() {
+    memset(stages, 0, sizeof(stages));
+}
+
+const char* Profiler::stageName(ProfileStage stage) {
+    switch (stage) {
+        case PROFILE_TIME_UPDATE:   return "time_update";
+        case PROFILE_WEB:           return "web";
+        case PROFILE_READ_PRESSURE: return "read_pressure";
+        case PROFILE_DISPLAY:       return "display";
+        case PROFILE_HISTORY:       return "history";
+        case PROFILE_SETTINGS:      return "settings";
+        case PROFILE_BACKFLUSH:     return "backflush";
+        case PROFILE_STAGE_COUNT:   break;
+    }
+    return "unknown";
+}
+
+#endif // ENABLE_PROFILER
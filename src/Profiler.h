@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Per-stage timing of the main loop from the CPU cycle counter, served at
+// /debug/profile. Only compiled in with -D ENABLE_PROFILER; otherwise
+// PROFILE_STAGE expands to nothing and no memory is used.
+//
+// Each stage keeps its count, min/avg/max and a histogram with a bucket per
+// power of two microseconds, in fixed memory.
+
+#ifdef ENABLE_PROFILER
+
+#include <Arduino.h>
+
+enum ProfileStage : uint8_t {
+    PROFILE_TIME_UPDATE,     // timeManager->update()
+    PROFILE_WEB,             // webServer->handleClient()
+    PROFILE_READ_PRESSURE,   // readPressure()
+    PROFILE_DISPLAY,         // displayManager->updateDisplay()
+    PROFILE_HISTORY,         // pressureLogger->update()
+    PROFILE_SETTINGS,        // Settings writes
+    PROFILE_BACKFLUSH,       // handleBackflush()
+    PROFILE_STAGE_COUNT
+};
+
+class Profiler {
+public:
+    // Bucket i counts durations of [2^i, 2^(i+1)) us, the first also shorter
+    // ones and the last also longer ones (about half a second and up)
+    static const size_t HISTOGRAM_BUCKETS = 20;
+
+    struct StageStats {
+        uint32_t count;
+        uint32_t minMicros;
+        uint32_t maxMicros;
+        uint64_t totalMicros;
+        uint32_t histogram[HISTOGRAM_BUCKETS];
+    };
+
+private:
+    static StageStats stages[PROFILE_STAGE_COUNT];
+
+public:
+    static void record(ProfileStage stage, uint32_t cycles);
+    static const StageStats& getStats(ProfileStage stage) { return stages[stage]; }
+    static void reset();
+    static const char* stageName(ProfileStage stage);
+};
+
+// Times the rest of the enclosing block
+class ProfileScope {
+private:
+    ProfileStage stage;
+    uint32_t start;
+
+public:
+    explicit ProfileScope(ProfileStage profileStage) : stage(profileStage), start(ESP.getCycleCount()) {}
+    ~ProfileScope() { Profiler::record(stage, ESP.getCycleCount() - start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_STAGE(stage) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage)
+
+#else
+
+#define PROFILE_STAGE(stage)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,143 @@
+#include "PumpRuntime.h"
+
+const char* PumpRuntime::RUNTIME_FILE = "/runtime.bin";
+
+PumpRuntime::PumpRuntime()
+    : onThreshold(0.2f), offThreshold(0.1f), pumpOn(false), lastSampleTime(0), dirty(false) {
+    memset(days, 0, sizeof(days));
+}
+
+void PumpRuntime::setOnThreshold(float bar) {
+    onThreshold = bar;
+    offThreshold = bar / 2;
+}
+
+PumpRuntime::DayRuntime& PumpRuntime::slotFor(uint32_t day) {
+    DayRuntime& slot = days[day % DAYS];
+    if (slot.day != day) {
+        // Reuse the slot of the day that fell out of the window
+        memset(&slot, 0, sizeof(slot));
+        slot.day = day;
+    }
+    return slot;
+}
+
+void PumpRuntime::account(time_t from, time_t to, bool on) {
+    // Split the interval at local midnight so each day gets its own share
+    while (from < to) {
+        uint32_t day = from / 86400;
+        time_t dayEnd = (time_t)(day + 1) * 86400;
+        time_t end = min(to, dayEnd);
+
+        DayRuntime& slot = slotFor(day);
+        slot.observedSeconds += end - from;
+        if (on) {
+            slot.onSeconds += end - from;
+        }
+        from = end;
+    }
+    dirty = true;
+}
+
+bool PumpRuntime::update(time_t localTime, float pressure) {
+    // The time since the previous sample is credited to the state at that sample
+    if (lastSampleTime != 0 && localTime > lastSampleTime && localTime - lastSampleTime <= MAX_SAMPLE_GAP) {
+        account(lastSampleTime, localTime, pumpOn);
+    }
+    lastSampleTime = localTime;
+
+    if (!pumpOn && pressure >= onThreshold) {
+        pumpOn = true;
+        slotFor(localTime / 86400).starts++;
+        dirty = true;
+    } else if (pumpOn && pressure < offThreshold) {
+        pumpOn = false;
+    }
+    return pumpOn;
+}
+
+const PumpRuntime::DayRuntime* PumpRuntime::getDay(uint32_t day) const {
+    const DayRuntime& slot = days[day % DAYS];
+    return slot.day == day ? &slot : nullptr;
+}
+
+bool PumpRuntime::getDutyCycle(uint32_t fromDay, uint32_t toDay, float& dutyCycle) const {
+    uint32_t on = 0;
+    uint32_t observed = 0;
+    for (size_t i = 0; i < DAYS; i++) {
+        if (days[i].day != 0 && days[i].day >= fromDay && days[i].day <= toDay) {
+            on += days[i].onSeconds;
+            observed += days[i].observedSeconds;
+        }
+    }
+    if (observed == 0) {
+        return false;
+    }
+    dutyCycle = (float)on / observed;
+    return true;
+}
+
+bool PumpRuntime::load() {
+    if (!LittleFS.exists(RUNTIME_FILE)) {
+        return false;
+    }
+
+    File file = LittleFS.open(RUNTIME_FILE, "r");
+    if (!file) {
+        Serial.println("Failed to open pump runtime file for reading");
+        return false;
+    }
+
+    // The file is a raw image of the slots, only valid for the same layout
+    uint32_t header[2];
+    bool ok = file.read((uint8_t*)header, sizeof(header)) == sizeof(header) &&
+              header[0] == RUNTIME_FILE_MAGIC && header[1] == sizeof(days) &&
+              file.read((uint8_t*)days, sizeof(days)) == sizeof(days);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Invalid pump runtime file, starting new counters");
+        memset(days, 0, sizeof(days));
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+bool PumpRuntime::save() {
+    if (!dirty) {
+        return true;
+    }
+
+    File file = LittleFS.open(RUNTIME_FILE, "w");
+    if (!file) {
+        Serial.println("Failed to open pump runtime file for writing");
+        return false;
+    }
+
+    uint32_t header[2] = { RUNTIME_FILE_MAGIC, sizeof(days) };
+    bool ok = file.write((const uint8_t*)header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)days, sizeof(days)) == sizeof(days);
+    file.close();
+
+    if (!ok) {
+        Serial.println("Failed to write pump runtime file");
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
+
+bool PumpRuntime::clear() {
+    memset(days, 0, sizeof(days));
+    lastSampleTime = 0;
+    dirty = false;
+
+    if (LittleFS.exists(RUNTIME_FILE) && !LittleFS.remove(RUNTIME_FILE)) {
+        Serial.println("Failed to delete pump runtime file");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef PUMPRUNTIME_H
+#define PUMPRUNTIME_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// Infers whether the circulation pump is running from the filter pressure
+// (with hysteresis) and accumulates the runtime per (local) day for the last
+// DAYS days, persisted so the counters survive a reboot.
+class PumpRuntime {
+public:
+    static const size_t DAYS = 32;
+
+    struct DayRuntime {
+        uint32_t day;             // Days since epoch, 0 = unused
+        uint32_t onSeconds;       // Time the pump was running
+        uint32_t observedSeconds; // Time covered by samples, the pump on or off
+        uint16_t starts;          // Number of off -> on transitions
+        uint16_t reserved;
+    };
+
+private:
+    static const char* RUNTIME_FILE;
+    static const uint32_t RUNTIME_FILE_MAGIC = 0x54524650; // "PFRT"
+    static const time_t MAX_SAMPLE_GAP = 300; // Longer gaps (e.g. powered off) are not counted
+
+    DayRuntime days[DAYS];        // Indexed by day % DAYS
+    float onThreshold;            // Pump is on at or above this pressure
+    float offThreshold;           // ...and off again below this one
+    bool pumpOn;
+    time_t lastSampleTime;        // Local time of the previous sample, 0 = none
+    bool dirty;
+
+    DayRuntime& slotFor(uint32_t day);
+    void account(time_t from, time_t to, bool on);
+
+public:
+    PumpRuntime();
+
+    // Pressure (bar) at which the pump counts as running; it counts as
+    // stopped again below half of it
+    void setOnThreshold(float bar);
+    float getOnThreshold() const { return onThreshold; }
+
+    // Classify a sample taken at the given local time and credit the time
+    // since the previous sample. Returns whether the pump is running.
+    bool update(time_t localTime, float pressure);
+    bool isPumpOn() const { return pumpOn; }
+
+    // Counters for a single day, or nullptr if it is not held
+    const DayRuntime* getDay(uint32_t day) const;
+
+    // Fraction of the observed time the pump was running over the held days
+    // in [fromDay, toDay]; false if none of them has been observed
+    bool getDutyCycle(uint32_t fromDay, uint32_t toDay, float& dutyCycle) const;
+
+    bool load();
+    bool save(); // Only writes if anything changed
+    bool clear();
+};
+
+#endif // PUMPRUNTIME_H
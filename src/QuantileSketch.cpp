@@ -0,0 +1,111 @@
+#include "QuantileSketch.h"
+
+static const float LOG_GAMMA = logf(QuantileSketch::GAMMA);
+
+int QuantileSketch::binIndex(float value) {
+    int index = (int)floorf(logf(value / MIN_VALUE) / LOG_GAMMA);
+    return constrain(index, 0, BINS - 1);
+}
+
+float QuantileSketch::binValue(int index) {
+    // Point of the bin with the smallest relative error to both of its edges
+    return MIN_VALUE * powf(GAMMA, index) * 2 * GAMMA / (GAMMA + 1);
+}
+
+void QuantileSketch::clear() {
+    memset(bins, 0, sizeof(bins));
+    count = 0;
+    lowCount = 0;
+    minValue = 0;
+    maxValue = 0;
+    shift = 0;
+    memset(reserved, 0, sizeof(reserved));
+}
+
+void QuantileSketch::halve() {
+    for (int i = 0; i < BINS; i++) {
+        bins[i] = (bins[i] + 1) / 2; // Round up so occupied bins stay occupied
+    }
+    shift++;
+}
+
+void QuantileSketch::add(float value) {
+    if (value < MIN_VALUE) {
+        lowCount++;
+        return;
+    }
+
+    if (count == 0) {
+        minValue = maxValue = value;
+    } else {
+        minValue = min(minValue, value);
+        maxValue = max(maxValue, value);
+    }
+    count++;
+
+    int index = binIndex(value);
+    if (bins[index] == UINT16_MAX) {
+        halve();
+    }
+
+    // At a coarser scale each value only counts with probability 2^-shift
+    if (shift == 0 || (uint32_t)random(1L << shift) == 0) {
+        bins[index]++;
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.count == 0) {
+        lowCount += other.lowCount;
+        return;
+    }
+
+    if (count == 0) {
+        minValue = other.minValue;
+        maxValue = other.maxValue;
+    } else {
+        minValue = min(minValue, other.minValue);
+        maxValue = max(maxValue, other.maxValue);
+    }
+    count += other.count;
+    lowCount += other.lowCount;
+
+    // Bring both sketches to the same scale before adding the bins
+    while (shift < other.shift) {
+        halve();
+    }
+    uint8_t otherShift = shift - other.shift;
+    for (int i = 0; i < BINS; i++) {
+        uint32_t sum = bins[i] + (other.bins[i] >> otherShift);
+        while (sum > UINT16_MAX) {
+            halve();
+            otherShift++;
+            sum = bins[i] + (other.bins[i] >> otherShift);
+        }
+        bins[i] = sum;
+    }
+}
+
+bool QuantileSketch::quantile(float q, float& value) const {
+    uint32_t total = 0;
+    for (int i = 0; i < BINS; i++) {
+        total += bins[i];
+    }
+    if (total == 0) {
+        return false;
+    }
+
+    // Rank of the wanted value, then walk the bins until it is reached
+    uint32_t rank = (uint32_t)(constrain(q, 0.0f, 1.0f) * (total - 1));
+    uint32_t cumulative = 0;
+    for (int i = 0; i < BINS; i++) {
+        cumulative += bins[i];
+        if (cumulative > rank) {
+            value = constrain(binValue(i), minValue, maxValue);
+            return true;
+        }
+    }
+
+    value = maxValue;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <Arduino.h>
+
+// Fixed-memory quantile sketch (DDSketch). Values fall into logarithmically spaced
+// bins, so any quantile is within RELATIVE_ACCURACY of the true value no matter how
+// many samples were added. Adding is O(1) and sketches can be merged by adding bins.
+class QuantileSketch {
+public:
+    static const int BINS = 128;
+    static constexpr float MIN_VALUE = 0.05f;   // Smaller values (pump off) are only counted
+    static constexpr float GAMMA = 1.04f;       // Bin i covers [MIN_VALUE * GAMMA^i, MIN_VALUE * GAMMA^(i+1))
+    static constexpr float RELATIVE_ACCURACY = (GAMMA - 1) / (GAMMA + 1); // about 2%
+
+private:
+    uint16_t bins[BINS];  // Counts, scaled down by 2^shift
+    uint32_t count;       // Values at or above MIN_VALUE
+    uint32_t lowCount;    // Values below MIN_VALUE
+    float minValue;
+    float maxValue;
+    uint8_t shift;        // Counts were halved this many times when a bin saturated
+    uint8_t reserved[3];
+
+    static int binIndex(float value);
+    static float binValue(int index);
+    void halve();
+
+public:
+    QuantileSketch() { clear(); }
+
+    void clear();
+    void add(float value);
+    void merge(const QuantileSketch& other);
+
+    // Value at quantile q (0..1) of the values at or above MIN_VALUE; false if there are none
+    bool quantile(float q, float& value) const;
+
+    // Number of values at or above MIN_VALUE, and below it
+    uint32_t getCount() const { return count; }
+    uint32_t getLowCount() const { return lowCount; }
+    float getMin() const { return minValue; }
+    float getMax() const { return maxValue; }
+};
+
+#endif // QUANTILESKETCH_H
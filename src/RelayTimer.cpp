@@ -0,0 +1,82 @@
+#include "RelayTimer.h"
+
+uint8_t RelayTimer::relayPin = 0;
+uint8_t RelayTimer::ledPin = 0;
+volatile bool RelayTimer::armed = false;
+volatile bool RelayTimer::expired = false;
+volatile uint32_t RelayTimer::remainingTicks = 0;
+volatile uint32_t RelayTimer::offMicros = 0;
+uint32_t RelayTimer::onMicros = 0;
+uint32_t RelayTimer::durationMicros = 0;
+RelayTimingStats RelayTimer::stats;
+
+void RelayTimer::begin(uint8_t relay, uint8_t led) {
+    relayPin = relay;
+    ledPin = led;
+    resetStats();
+    timer1_attachInterrupt(onTimer);
+}
+
+void IRAM_ATTR RelayTimer::onTimer() {
+    // Next chunk of a duration longer than the counter
+    if (remainingTicks > 0) {
+        uint32_t ticks = remainingTicks > MAX_TICKS ? MAX_TICKS : remainingTicks;
+        remainingTicks -= ticks;
+        timer1_write(ticks);
+        return;
+    }
+
+    timer1_disable();
+    digitalWrite(relayPin, LOW);
+    digitalWrite(ledPin, HIGH);   // LED off (inverse logic on NodeMCU)
+    offMicros = micros();
+    armed = false;
+    expired = true;
+}
+
+void RelayTimer::start(uint32_t durationMs) {
+    timer1_disable();
+    update();
+
+    uint32_t ticks = (uint64_t)durationMs * TICKS_PER_SECOND / 1000;
+    uint32_t first = ticks > MAX_TICKS ? MAX_TICKS : ticks;
+    remainingTicks = ticks - first;
+    durationMicros = durationMs * 1000;
+    expired = false;
+    armed = true;
+
+    digitalWrite(relayPin, HIGH);
+    digitalWrite(ledPin, LOW);    // LED on (inverse logic on NodeMCU)
+    onMicros = micros();
+    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_SINGLE);
+    timer1_write(first);
+}
+
+void RelayTimer::stop(bool early) {
+    noInterrupts();
+    timer1_disable();
+    bool wasOn = armed;
+    armed = false;
+    interrupts();
+
+    digitalWrite(relayPin, LOW);
+    digitalWrite(ledPin, HIGH);
+    uint32_t now = micros();
+
+    if (expired) {
+        update();
+    } else if (wasOn && early) {
+        stats.recordEarlyStop();
+    } else if (wasOn) {
+        // The loop reached the deadline before the timer, possibly by a little
+        stats.recordRun(onMicros, now, durationMicros, false);
+    }
+}
+
+void RelayTimer::update() {
+    if (!expired) {
+        return;
+    }
+    expired = false;
+    stats.recordRun(onMicros, offMicros, durationMicros, true);
+}
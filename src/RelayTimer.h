@@ -0,0 +1,55 @@
+#ifndef RELAYTIMER_H
+#define RELAYTIMER_H
+
+// Switches the backflush relay off from the timer1 interrupt when its on-time
+// has passed, so a slow request handler (a WiFi scan, a large CSV export) or a
+// flash write in loop() can no longer hold the relay on past the duration.
+// The loop still stops the backflush as before; usually it gets there first,
+// otherwise the relay is already off and stop() only disarms the timer.
+//
+// timer1 counts 23 bits at 312.5 kHz (80 MHz / 256), about 26.8 s, so longer
+// durations are armed as a chain of chunks reloaded from the interrupt.
+// Every run that ends at its deadline, whether by the timer or the loop, is
+// measured against the intended on-time into RelayTimingStats.
+
+#include <Arduino.h>
+#include "RelayTimingStats.h"
+
+class RelayTimer {
+private:
+    static const uint32_t TICKS_PER_SECOND = 312500;    // TIM_DIV256 of the 80 MHz APB clock
+    static const uint32_t MAX_TICKS = 0x7FFFFF;         // 23-bit counter
+
+    static uint8_t relayPin;
+    static uint8_t ledPin;
+    static volatile bool armed;
+    static volatile bool expired;             // Turned off by the timer, not yet measured
+    static volatile uint32_t remainingTicks;  // Still to run after the current chunk
+    static volatile uint32_t offMicros;
+    static uint32_t onMicros;
+    static uint32_t durationMicros;
+    static RelayTimingStats stats;
+
+    static void IRAM_ATTR onTimer();
+
+public:
+    // Pins of the relay (active HIGH) and the LED mirroring it (active LOW)
+    static void begin(uint8_t relay, uint8_t led);
+
+    // Relay on, off again after durationMs by the timer
+    static void start(uint32_t durationMs);
+
+    // Relay off now, if the timer has not already. early is set when the run
+    // is cut short (adaptive duration, web page) rather than at its deadline.
+    static void stop(bool early);
+
+    static bool isOn() { return armed; }
+
+    // Move a measurement taken by the interrupt into the statistics
+    static void update();
+
+    static const RelayTimingStats& getStats() { return stats; }
+    static void resetStats() { stats.reset(); }
+};
+
+#endif // RELAYTIMER_H
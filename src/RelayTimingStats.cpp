@@ -0,0 +1,38 @@
+#include "RelayTimingStats.h"
+
+#include <string.h>
+
+void RelayTimingStats::recordRun(uint32_t onMicros, uint32_t offMicros, uint32_t durationMicros, bool byTimer) {
+    // Unsigned differences stay right across a wrap of micros() (every 71 minutes)
+    int32_t errorMicros = (int32_t)(offMicros - onMicros - durationMicros);
+
+    if (count == 0 || errorMicros < minMicros) {
+        minMicros = errorMicros;
+    }
+    if (count == 0 || errorMicros > maxMicros) {
+        maxMicros = errorMicros;
+    }
+    count++;
+    if (byTimer) {
+        timerCount++;
+    }
+    totalMicros += errorMicros;
+
+    // Early offs are timer and clock rounding, counted with the smallest errors
+    uint32_t magnitude = errorMicros > 0 ? errorMicros : 0;
+    size_t bucket = magnitude > 1 ? 31 - __builtin_clz(magnitude) : 0;
+    if (bucket >= HISTOGRAM_BUCKETS) {
+        bucket = HISTOGRAM_BUCKETS - 1;
+    }
+    histogram[bucket]++;
+}
+
+void RelayTimingStats::reset() {
+    count = 0;
+    timerCount = 0;
+    earlyStops = 0;
+    minMicros = 0;
+    maxMicros = 0;
+    totalMicros = 0;
+    memset(histogram, 0, sizeof(histogram));
+}
@@ -0,0 +1,38 @@
+#ifndef RELAYTIMINGSTATS_H
+#define RELAYTIMINGSTATS_H
+
+// On-time error of the backflush relay, as measured by RelayTimer: for every
+// run that ends at its deadline the actual minus the intended on-time, kept as
+// count, min/avg/max and a histogram with a bucket per power of two
+// microseconds. Runs stopped early are only counted. Plain arithmetic on
+// micros() values, checked on the host by tools/relay-timing-test.
+
+#include <stdint.h>
+#include <stddef.h>
+
+class RelayTimingStats {
+public:
+    // Bucket i counts errors of [2^i, 2^(i+1)) us, the first also smaller
+    // ones and the last also larger ones (about 65 ms and up)
+    static const size_t HISTOGRAM_BUCKETS = 16;
+
+    uint32_t count;          // Runs ended at the deadline
+    uint32_t timerCount;     // ...of which the timer switched off
+    uint32_t earlyStops;     // Runs stopped before the deadline, not measured
+    int32_t minMicros;       // Actual minus intended on-time
+    int32_t maxMicros;
+    int64_t totalMicros;
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+
+    RelayTimingStats() { reset(); }
+
+    // A run from onMicros to offMicros (micros(), which may wrap in between)
+    // that was meant to last durationMicros
+    void recordRun(uint32_t onMicros, uint32_t offMicros, uint32_t durationMicros, bool byTimer);
+    void recordEarlyStop() { earlyStops++; }
+
+    int32_t getAverageMicros() const { return count ? (int32_t)(totalMicros / count) : 0; }
+    void reset();
+};
+
+#endif // RELAYTIMINGSTATS_H
@@ -0,0 +1,66 @@
+#include "RtcReadingBuffer.h"
+#include <stddef.h>
+
+RtcReadingBuffer::RtcReadingBuffer() {
+    memset(&image, 0, sizeof(image));
+    image.magic = MAGIC;
+}
+
+uint32_t RtcReadingBuffer::computeCrc() const {
+    // Bitwise CRC32, small enough to run on every append
+    const uint8_t* data = (const uint8_t*)&image;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < sizeof(image); i++) {
+        if (i >= offsetof(RtcImage, crc) && i < offsetof(RtcImage, crc) + sizeof(image.crc)) {
+            continue;
+        }
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+void RtcReadingBuffer::writeHeader() {
+    image.crc = computeCrc();
+    ESP.rtcUserMemoryWrite(RTC_OFFSET, (uint32_t*)&image, offsetof(RtcImage, records));
+}
+
+void RtcReadingBuffer::writeSlot(size_t slot) {
+    uint32_t blockOffset = (offsetof(RtcImage, records) + slot * sizeof(PressureRecord)) / 4;
+    ESP.rtcUserMemoryWrite(RTC_OFFSET + blockOffset, (uint32_t*)&image.records[slot], sizeof(PressureRecord));
+}
+
+bool RtcReadingBuffer::recover() {
+    if (!ESP.rtcUserMemoryRead(RTC_OFFSET, (uint32_t*)&image, sizeof(image)) ||
+        image.magic != MAGIC || image.count > CAPACITY || image.start >= CAPACITY || image.crc != computeCrc()) {
+        // Power-on garbage or a partial write; start from an empty ring
+        clear();
+        return false;
+    }
+    return true;
+}
+
+void RtcReadingBuffer::append(const PressureRecord& record) {
+    size_t slot = (image.start + image.count) % CAPACITY;
+    image.records[slot] = record;
+    if (image.count < CAPACITY) {
+        image.count++;
+    } else {
+        image.start = (image.start + 1) % CAPACITY;
+    }
+
+    // The slot goes first so the checksum only validates once the record is in place
+    writeSlot(slot);
+    writeHeader();
+}
+
+void RtcReadingBuffer::clear() {
+    image.magic = MAGIC;
+    image.start = 0;
+    image.count = 0;
+    memset(image.records, 0, sizeof(image.records));
+    image.crc = computeCrc();
+    ESP.rtcUserMemoryWrite(RTC_OFFSET, (uint32_t*)&image, sizeof(image));
+}
@@ -0,0 +1,54 @@
+#ifndef RTCREADINGBUFFER_H
+#define RTCREADINGBUFFER_H
+
+#include <Arduino.h>
+#include "PressureRecord.h"
+
+// Ring of readings not yet written to flash, mirrored into RTC user memory.
+// RTC memory survives ESP.restart(), watchdog and exception resets and OTA reboots
+// (but not power loss), so unsaved readings can be recovered on the next boot.
+class RtcReadingBuffer {
+public:
+    static const size_t CAPACITY = 46;
+
+private:
+    // The first 128 bytes of RTC user memory are used by the bootloader for OTA
+    static const uint32_t RTC_OFFSET = 32; // In 4-byte blocks
+    static const uint32_t MAGIC = 0x52425250; // "PRBR"
+
+    struct RtcImage {
+        uint32_t magic;
+        uint16_t start;    // Slot of the oldest reading
+        uint16_t count;
+        uint32_t crc;      // CRC32 of the header (crc excluded) and all slots
+        PressureRecord records[CAPACITY];
+    };
+    static_assert(sizeof(RtcImage) <= 512 - RTC_OFFSET * 4, "RtcImage must fit in RTC user memory");
+    static_assert(sizeof(RtcImage) % 4 == 0, "RtcImage must be a whole number of RTC blocks");
+
+    RtcImage image;
+
+    uint32_t computeCrc() const;
+    void writeHeader();
+    void writeSlot(size_t slot);
+
+public:
+    RtcReadingBuffer();
+
+    // Load the ring left by the previous boot; false if there is none or it is corrupt
+    bool recover();
+
+    // Add a reading, overwriting the oldest one when full
+    void append(const PressureRecord& record);
+
+    // Forget all readings, once they are safely on flash
+    void clear();
+
+    size_t getCount() const { return image.count; }
+    bool isFull() const { return image.count >= CAPACITY; }
+
+    // Reading i in chronological order (0 = oldest)
+    const PressureRecord& get(size_t i) const { return image.records[(image.start + i) % CAPACITY]; }
+};
+
+#endif // RTCREADINGBUFFER_H
@@ -47,6 +47,38 @@ void Settings::setDefaults() {
     
     // Set default pressure change threshold
     setPressureChangeThreshold(DEFAULT_PRESSURE_CHANGE_THRESHOLD);
+    
+    // Set default predictive backflush settings
+    setPredictiveWindowHours(DEFAULT_PREDICTIVE_WINDOW_HOURS);
+    setQuietHours(DEFAULT_QUIET_START_HOUR, DEFAULT_QUIET_END_HOUR);
+    
+    // Set default heap reserve
+    setHeapReserve(DEFAULT_HEAP_RESERVE);
+    
+    // Set default change detection thresholds
+    setPumpStepThreshold(DEFAULT_PUMP_STEP_THRESHOLD);
+    setRiseAlarmThreshold(DEFAULT_RISE_ALARM_THRESHOLD);
+    
+    // Set default pump on threshold
+    setPumpOnThreshold(DEFAULT_PUMP_ON_THRESHOLD);
+    
+    // Set default adaptive backflush settings
+    setAdaptiveBackflush(DEFAULT_ADAPTIVE_BACKFLUSH);
+    setAdaptiveMinDuration(DEFAULT_ADAPTIVE_MIN_DURATION);
+    setAdaptiveMaxSlope(DEFAULT_ADAPTIVE_MAX_SLOPE);
+    setAdaptiveMinDrop(DEFAULT_ADAPTIVE_MIN_DROP);
+    
+    // Set default backflush guard
+    setBackflushHysteresis(DEFAULT_BACKFLUSH_HYSTERESIS);
+    setBackflushLockout(DEFAULT_BACKFLUSH_LOCKOUT);
+    setBackflushMaxPerDay(DEFAULT_BACKFLUSH_MAX_PER_DAY);
+    
+    // Set default missed schedule handling
+    setCatchUpPolicy(DEFAULT_CATCH_UP_POLICY);
+    setCatchUpWindow(DEFAULT_CATCH_UP_WINDOW);
+    
+    // Set default power saving
+    setPowerSave(DEFAULT_POWER_SAVE);
 }
 
 void Settings::reset() {
@@ -204,4 +236,301 @@ unsigned int Settings::getPressureChangeMaxInterval() {
 void Settings::setPressureChangeMaxInterval(unsigned int interval) {
     if (!initialized) begin();
     preferences.putUInt(KEY_PRESSURE_CHANGE_MAX_INTERVAL, interval);
-}
\ No newline at end of file
+}
+
+unsigned int Settings::getPredictiveWindowHours() {
+    if (!initialized) {
+        return DEFAULT_PREDICTIVE_WINDOW_HOURS;
+    }
+    
+    return preferences.getUInt(KEY_PREDICTIVE_WINDOW, DEFAULT_PREDICTIVE_WINDOW_HOURS);
+}
+
+void Settings::setPredictiveWindowHours(unsigned int hours) {
+    if (!initialized) {
+        return;
+    }
+    
+    // Limit to 0 (disabled) up to one week ahead
+    if (hours <= 168) {
+        preferences.putUInt(KEY_PREDICTIVE_WINDOW, hours);
+    }
+}
+
+uint8_t Settings::getQuietStartHour() {
+    if (!initialized) {
+        return DEFAULT_QUIET_START_HOUR;
+    }
+    
+    return preferences.getUChar(KEY_QUIET_START, DEFAULT_QUIET_START_HOUR);
+}
+
+uint8_t Settings::getQuietEndHour() {
+    if (!initialized) {
+        return DEFAULT_QUIET_END_HOUR;
+    }
+    
+    return preferences.getUChar(KEY_QUIET_END, DEFAULT_QUIET_END_HOUR);
+}
+
+void Settings::setQuietHours(uint8_t startHour, uint8_t endHour) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (startHour <= 23 && endHour <= 23) {
+        preferences.putUChar(KEY_QUIET_START, startHour);
+        preferences.putUChar(KEY_QUIET_END, endHour);
+    }
+}
+
+unsigned int Settings::getHeapReserve() {
+    if (!initialized) {
+        return DEFAULT_HEAP_RESERVE;
+    }
+    
+    return preferences.getUInt(KEY_HEAP_RESERVE, DEFAULT_HEAP_RESERVE);
+}
+
+void Settings::setHeapReserve(unsigned int bytes) {
+    if (!initialized) {
+        return;
+    }
+    
+    // Between 4kb and 32kb
+    if (bytes >= 4096 && bytes <= 32768) {
+        preferences.putUInt(KEY_HEAP_RESERVE, bytes);
+    }
+}
+
+float Settings::getPumpStepThreshold() {
+    if (!initialized) {
+        return DEFAULT_PUMP_STEP_THRESHOLD;
+    }
+    
+    return preferences.getFloat(KEY_PUMP_STEP_THRESHOLD, DEFAULT_PUMP_STEP_THRESHOLD);
+}
+
+void Settings::setPumpStepThreshold(float threshold) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (threshold >= 0.05f && threshold <= 2.0f) {
+        preferences.putFloat(KEY_PUMP_STEP_THRESHOLD, threshold);
+    }
+}
+
+float Settings::getRiseAlarmThreshold() {
+    if (!initialized) {
+        return DEFAULT_RISE_ALARM_THRESHOLD;
+    }
+    
+    return preferences.getFloat(KEY_RISE_ALARM_THRESHOLD, DEFAULT_RISE_ALARM_THRESHOLD);
+}
+
+void Settings::setRiseAlarmThreshold(float threshold) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (threshold >= 0.05f && threshold <= 2.0f) {
+        preferences.putFloat(KEY_RISE_ALARM_THRESHOLD, threshold);
+    }
+}
+
+float Settings::getPumpOnThreshold() {
+    if (!initialized) {
+        return DEFAULT_PUMP_ON_THRESHOLD;
+    }
+    
+    return preferences.getFloat(KEY_PUMP_ON_THRESHOLD, DEFAULT_PUMP_ON_THRESHOLD);
+}
+
+void Settings::setPumpOnThreshold(float threshold) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (threshold >= 0.05f && threshold <= 2.0f) {
+        preferences.putFloat(KEY_PUMP_ON_THRESHOLD, threshold);
+    }
+}
+
+bool Settings::getAdaptiveBackflush() {
+    if (!initialized) {
+        return DEFAULT_ADAPTIVE_BACKFLUSH;
+    }
+    
+    return preferences.getBool(KEY_ADAPTIVE_BACKFLUSH, DEFAULT_ADAPTIVE_BACKFLUSH);
+}
+
+void Settings::setAdaptiveBackflush(bool enabled) {
+    if (!initialized) {
+        return;
+    }
+    
+    preferences.putBool(KEY_ADAPTIVE_BACKFLUSH, enabled);
+}
+
+unsigned int Settings::getAdaptiveMinDuration() {
+    if (!initialized) {
+        return DEFAULT_ADAPTIVE_MIN_DURATION;
+    }
+    
+    return preferences.getUInt(KEY_ADAPTIVE_MIN_DURATION, DEFAULT_ADAPTIVE_MIN_DURATION);
+}
+
+void Settings::setAdaptiveMinDuration(unsigned int seconds) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (seconds >= 3 && seconds <= 300) {
+        preferences.putUInt(KEY_ADAPTIVE_MIN_DURATION, seconds);
+    }
+}
+
+float Settings::getAdaptiveMaxSlope() {
+    if (!initialized) {
+        return DEFAULT_ADAPTIVE_MAX_SLOPE;
+    }
+    
+    return preferences.getFloat(KEY_ADAPTIVE_MAX_SLOPE, DEFAULT_ADAPTIVE_MAX_SLOPE);
+}
+
+void Settings::setAdaptiveMaxSlope(float barPerMinute) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (barPerMinute >= 0.01f && barPerMinute <= 1.0f) {
+        preferences.putFloat(KEY_ADAPTIVE_MAX_SLOPE, barPerMinute);
+    }
+}
+
+unsigned int Settings::getAdaptiveMinDrop() {
+    if (!initialized) {
+        return DEFAULT_ADAPTIVE_MIN_DROP;
+    }
+    
+    return preferences.getUInt(KEY_ADAPTIVE_MIN_DROP, DEFAULT_ADAPTIVE_MIN_DROP);
+}
+
+void Settings::setAdaptiveMinDrop(unsigned int percent) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (percent <= 90) {
+        preferences.putUInt(KEY_ADAPTIVE_MIN_DROP, percent);
+    }
+}
+
+float Settings::getBackflushHysteresis() {
+    if (!initialized) {
+        return DEFAULT_BACKFLUSH_HYSTERESIS;
+    }
+    
+    return preferences.getFloat(KEY_BACKFLUSH_HYSTERESIS, DEFAULT_BACKFLUSH_HYSTERESIS);
+}
+
+void Settings::setBackflushHysteresis(float bar) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (bar >= 0.0f && bar <= 1.0f) {
+        preferences.putFloat(KEY_BACKFLUSH_HYSTERESIS, bar);
+    }
+}
+
+unsigned int Settings::getBackflushLockout() {
+    if (!initialized) {
+        return DEFAULT_BACKFLUSH_LOCKOUT;
+    }
+    
+    return preferences.getUInt(KEY_BACKFLUSH_LOCKOUT, DEFAULT_BACKFLUSH_LOCKOUT);
+}
+
+void Settings::setBackflushLockout(unsigned int minutes) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (minutes <= 1440) {
+        preferences.putUInt(KEY_BACKFLUSH_LOCKOUT, minutes);
+    }
+}
+
+unsigned int Settings::getBackflushMaxPerDay() {
+    if (!initialized) {
+        return DEFAULT_BACKFLUSH_MAX_PER_DAY;
+    }
+    
+    return preferences.getUInt(KEY_BACKFLUSH_MAX_PER_DAY, DEFAULT_BACKFLUSH_MAX_PER_DAY);
+}
+
+void Settings::setBackflushMaxPerDay(unsigned int count) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (count <= 48) {
+        preferences.putUInt(KEY_BACKFLUSH_MAX_PER_DAY, count);
+    }
+}
+
+uint8_t Settings::getCatchUpPolicy() {
+    if (!initialized) {
+        return DEFAULT_CATCH_UP_POLICY;
+    }
+    
+    return preferences.getUChar(KEY_CATCH_UP_POLICY, DEFAULT_CATCH_UP_POLICY);
+}
+
+void Settings::setCatchUpPolicy(uint8_t policy) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (policy <= 2) {
+        preferences.putUChar(KEY_CATCH_UP_POLICY, policy);
+    }
+}
+
+unsigned int Settings::getCatchUpWindow() {
+    if (!initialized) {
+        return DEFAULT_CATCH_UP_WINDOW;
+    }
+    
+    return preferences.getUInt(KEY_CATCH_UP_WINDOW, DEFAULT_CATCH_UP_WINDOW);
+}
+
+void Settings::setCatchUpWindow(unsigned int minutes) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (minutes >= 1 && minutes <= 1440) {
+        preferences.putUInt(KEY_CATCH_UP_WINDOW, minutes);
+    }
+}
+
+uint8_t Settings::getPowerSave() {
+    if (!initialized) {
+        return DEFAULT_POWER_SAVE;
+    }
+    
+    return preferences.getUChar(KEY_POWER_SAVE, DEFAULT_POWER_SAVE);
+}
+
+void Settings::setPowerSave(uint8_t mode) {
+    if (!initialized) {
+        return;
+    }
+    
+    if (mode <= 2) {
+        preferences.putUChar(KEY_POWER_SAVE, mode);
+    }
+}
@@ -25,6 +25,23 @@ private:
     static constexpr unsigned int DEFAULT_DATA_RETENTION_DAYS = 7;
     static constexpr float DEFAULT_PRESSURE_CHANGE_THRESHOLD = 0.17f; // Default threshold for pressure change logging (bar)
     static constexpr unsigned int DEFAULT_PRESSURE_CHANGE_MAX_INTERVAL = 10; // Default max interval for pressure change logging (minutes)
+    static constexpr unsigned int DEFAULT_PREDICTIVE_WINDOW_HOURS = 0; // Predictive backflush disabled by default
+    static constexpr uint8_t DEFAULT_QUIET_START_HOUR = 22; // Quiet hours for predictive backflushes (local time)
+    static constexpr uint8_t DEFAULT_QUIET_END_HOUR = 6;
+    static constexpr unsigned int DEFAULT_HEAP_RESERVE = 16384; // Free heap kept for the web server (bytes)
+    static constexpr float DEFAULT_PUMP_STEP_THRESHOLD = 0.3f; // Pressure step detected as pump start/stop (bar)
+    static constexpr float DEFAULT_RISE_ALARM_THRESHOLD = 0.3f; // Sustained rise flagged as abnormal (bar)
+    static constexpr float DEFAULT_PUMP_ON_THRESHOLD = 0.2f; // Pressure at which the pump counts as running (bar)
+    static constexpr bool DEFAULT_ADAPTIVE_BACKFLUSH = false; // Fixed backflush duration by default
+    static constexpr unsigned int DEFAULT_ADAPTIVE_MIN_DURATION = 20; // Shortest adaptive backflush (seconds)
+    static constexpr float DEFAULT_ADAPTIVE_MAX_SLOPE = 0.1f; // Pressure counts as settled below this (bar/min)
+    static constexpr unsigned int DEFAULT_ADAPTIVE_MIN_DROP = 10; // ...once this far below its peak (percent)
+    static constexpr float DEFAULT_BACKFLUSH_HYSTERESIS = 0.2f; // Re-arm below threshold minus this (bar)
+    static constexpr unsigned int DEFAULT_BACKFLUSH_LOCKOUT = 60; // No automatic backflush this long after one (minutes)
+    static constexpr unsigned int DEFAULT_BACKFLUSH_MAX_PER_DAY = 4; // Automatic backflushes per day, 0 = unlimited
+    static constexpr uint8_t DEFAULT_CATCH_UP_POLICY = 0; // Missed schedules: 0 = fire once, 1 = skip, 2 = fire within window
+    static constexpr unsigned int DEFAULT_CATCH_UP_WINDOW = 60; // Window for policy 2 (minutes)
+    static constexpr uint8_t DEFAULT_POWER_SAVE = 2; // Deepest WiFi sleep: 0 = none, 1 = modem, 2 = light
     
     // Default calibration points (voltage, pressure)
     static const CalibrationPoint DEFAULT_CALIBRATION[NUM_CALIBRATION_POINTS];
@@ -38,6 +55,23 @@ private:
     static constexpr const char* KEY_PRESSURE_CHANGE_THRESHOLD = "pcthresh";
     static constexpr const char* KEY_PRESSURE_CHANGE_MAX_INTERVAL = "pcmaxinterval";
     static constexpr const char* KEY_CALIBRATION = "cal";
+    static constexpr const char* KEY_PREDICTIVE_WINDOW = "predwindow";
+    static constexpr const char* KEY_QUIET_START = "quietstart";
+    static constexpr const char* KEY_QUIET_END = "quietend";
+    static constexpr const char* KEY_HEAP_RESERVE = "heapreserve";
+    static constexpr const char* KEY_PUMP_STEP_THRESHOLD = "pumpstep";
+    static constexpr const char* KEY_RISE_ALARM_THRESHOLD = "risealarm";
+    static constexpr const char* KEY_PUMP_ON_THRESHOLD = "pumpon";
+    static constexpr const char* KEY_ADAPTIVE_BACKFLUSH = "bfadaptive";
+    static constexpr const char* KEY_ADAPTIVE_MIN_DURATION = "bfmindur";
+    static constexpr const char* KEY_ADAPTIVE_MAX_SLOPE = "bfslope";
+    static constexpr const char* KEY_ADAPTIVE_MIN_DROP = "bfdrop";
+    static constexpr const char* KEY_BACKFLUSH_HYSTERESIS = "bfhyst";
+    static constexpr const char* KEY_BACKFLUSH_LOCKOUT = "bflockout";
+    static constexpr const char* KEY_BACKFLUSH_MAX_PER_DAY = "bfmaxday";
+    static constexpr const char* KEY_CATCH_UP_POLICY = "catchup";
+    static constexpr const char* KEY_CATCH_UP_WINDOW = "catchupwin";
+    static constexpr const char* KEY_POWER_SAVE = "powersave";
     
     void setDefaults();
 
@@ -74,6 +108,56 @@ public:
     void setPressureChangeThreshold(float threshold);
     unsigned int getPressureChangeMaxInterval();
     void setPressureChangeMaxInterval(unsigned int interval);
+    
+    // Predictive backflush methods (window of 0 hours disables it)
+    unsigned int getPredictiveWindowHours();
+    void setPredictiveWindowHours(unsigned int hours);
+    uint8_t getQuietStartHour();
+    uint8_t getQuietEndHour();
+    void setQuietHours(uint8_t startHour, uint8_t endHour);
+    
+    // Free heap (bytes) kept for the web server when sizing the pressure history
+    unsigned int getHeapReserve();
+    void setHeapReserve(unsigned int bytes);
+    
+    // Change detection thresholds (bar)
+    float getPumpStepThreshold();
+    void setPumpStepThreshold(float threshold);
+    float getRiseAlarmThreshold();
+    void setRiseAlarmThreshold(float threshold);
+    
+    // Pump runtime accounting: pressure (bar) at which the pump counts as running
+    float getPumpOnThreshold();
+    void setPumpOnThreshold(float threshold);
+    
+    // Adaptive backflush duration: stop once the pressure has settled, the
+    // backflush duration becomes the maximum
+    bool getAdaptiveBackflush();
+    void setAdaptiveBackflush(bool enabled);
+    unsigned int getAdaptiveMinDuration();
+    void setAdaptiveMinDuration(unsigned int seconds);
+    float getAdaptiveMaxSlope();
+    void setAdaptiveMaxSlope(float barPerMinute);
+    unsigned int getAdaptiveMinDrop();
+    void setAdaptiveMinDrop(unsigned int percent);
+    
+    // Guard against repeated automatic backflushes
+    float getBackflushHysteresis();
+    void setBackflushHysteresis(float bar);
+    unsigned int getBackflushLockout();
+    void setBackflushLockout(unsigned int minutes);
+    unsigned int getBackflushMaxPerDay();
+    void setBackflushMaxPerDay(unsigned int count);
+    
+    // Missed schedule catch-up
+    uint8_t getCatchUpPolicy();
+    void setCatchUpPolicy(uint8_t policy);
+    unsigned int getCatchUpWindow();
+    void setCatchUpWindow(unsigned int minutes);
+    
+    // Deepest WiFi sleep mode used between tasks (PowerManager::SleepMode)
+    uint8_t getPowerSave();
+    void setPowerSave(uint8_t mode);
 };
 
 #endif // SETTINGS_H
@@ -0,0 +1,201 @@
+#include "TaskScheduler.h"
+#include <string.h>
+
+static_assert(TaskScheduler::MAX_TASKS <= 16, "The wheel has a 16 bit mask per slot");
+
+TaskScheduler::TaskScheduler(ClockFunction microsClock)
+    : taskCount(0), lastTick(0), clock(microsClock) {
+    memset(wheel, 0, sizeof(wheel));
+}
+
+int TaskScheduler::addTask(const char* name, uint32_t periodMs, TaskCallback callback, uint32_t now,
+                           uint8_t priority, uint32_t deadlineMs) {
+    if (taskCount >= MAX_TASKS || periodMs == 0) {
+        return -1;
+    }
+
+    size_t id = taskCount++;
+    Task& task = tasks[id];
+    task.callback = callback;
+    memset(&task.stats, 0, sizeof(task.stats));
+    task.stats.name = name;
+    task.stats.period = periodMs;
+    task.stats.deadline = deadlineMs > 0 ? deadlineMs : periodMs;
+    task.stats.priority = priority;
+    task.stats.enabled = true;
+    task.queued = false;
+    enqueue(id, now);
+    return (int)id;
+}
+
+void TaskScheduler::setPeriod(int id, uint32_t periodMs, uint32_t now) {
+    if (id < 0 || (size_t)id >= taskCount || periodMs == 0) {
+        return;
+    }
+
+    // A deadline that followed the period keeps following it
+    TaskStats& stats = tasks[id].stats;
+    if (stats.deadline == stats.period) {
+        stats.deadline = periodMs;
+    }
+    stats.period = periodMs;
+
+    if (stats.enabled) {
+        dequeue(id);
+        enqueue(id, now + periodMs);
+    }
+}
+
+void TaskScheduler::setEnabled(int id, bool enabled, uint32_t now) {
+    if (id < 0 || (size_t)id >= taskCount) {
+        return;
+    }
+
+    tasks[id].stats.enabled = enabled;
+    if (!enabled) {
+        dequeue(id);
+    } else if (!tasks[id].queued) {
+        enqueue(id, now);
+    }
+}
+
+void TaskScheduler::enqueue(size_t id, uint32_t due) {
+    tasks[id].due = due;
+    tasks[id].queued = true;
+    wheel[slotOf(due)] |= 1u << id;
+}
+
+void TaskScheduler::dequeue(size_t id) {
+    if (tasks[id].queued) {
+        wheel[slotOf(tasks[id].due)] &= ~(1u << id);
+        tasks[id].queued = false;
+    }
+}
+
+size_t TaskScheduler::run(uint32_t now) {
+    // Collect the due tasks from the slots passed since the last run. A slot can
+    // hold tasks of later revolutions, which stay where they are. After a gap of
+    // a revolution or more every slot has passed.
+    uint32_t tick = now / TICK_MS;
+    uint32_t passed = tick - lastTick;
+    size_t slots = passed >= WHEEL_SLOTS ? WHEEL_SLOTS : passed + 1;
+    uint32_t due = 0;
+    for (size_t i = 0; i < slots; i++) {
+        uint32_t bits = wheel[(tick - i) % WHEEL_SLOTS];
+        while (bits) {
+            int id = __builtin_ctz(bits);
+            bits &= bits - 1;
+            if ((int32_t)(now - tasks[id].due) >= 0) {
+                due |= 1u << id;
+            }
+        }
+    }
+    lastTick = tick;
+
+    // Highest priority first, then in the order the tasks were added
+    size_t ran = 0;
+    uint32_t startMicros = clock();
+    while (due) {
+        size_t next = __builtin_ctz(due);
+        for (uint32_t bits = due & (due - 1); bits; bits &= bits - 1) {
+            size_t id = __builtin_ctz(bits);
+            if (tasks[id].stats.priority < tasks[next].stats.priority) {
+                next = id;
+            }
+        }
+        due &= ~(1u << next);
+
+        // An earlier task may have disabled or rescheduled it
+        if (tasks[next].queued && (int32_t)(now - tasks[next].due) >= 0) {
+            runTask(next, now, startMicros);
+            ran++;
+        }
+    }
+    return ran;
+}
+
+void TaskScheduler::runTask(size_t id, uint32_t now, uint32_t startMicros) {
+    Task& task = tasks[id];
+    TaskStats& stats = task.stats;
+    uint32_t due = task.due;
+    dequeue(id);
+
+    uint32_t began = clock();
+    uint32_t lateness = (now - due) + (began - startMicros) / 1000;
+    task.callback();
+    uint32_t elapsed = clock() - began;
+
+    stats.runs++;
+    stats.lastMicros = elapsed;
+    stats.totalMicros += elapsed;
+    if (elapsed > stats.worstMicros) {
+        stats.worstMicros = elapsed;
+    }
+    if (lateness > stats.worstLateness) {
+        stats.worstLateness = lateness;
+    }
+    if (lateness + elapsed / 1000 > stats.deadline) {
+        stats.overruns++;
+    }
+
+    // Keep the phase, skipping periods that have already passed. The callback
+    // may have rescheduled or disabled the task itself.
+    if (stats.enabled && !task.queued) {
+        uint32_t missed = (now - due) / stats.period;
+        stats.skipped += missed;
+        enqueue(id, due + (missed + 1) * stats.period);
+    }
+}
+
+uint32_t TaskScheduler::getIdleTime(uint32_t now) const {
+    // The first slot holding a task of this revolution has the next one. The walk
+    // starts at the last tick run() processed, as the clock may have passed the
+    // slot of a task that became due since.
+    for (size_t i = 0; i < WHEEL_SLOTS; i++) {
+        uint32_t bits = wheel[(lastTick + i) % WHEEL_SLOTS];
+        uint32_t earliest = UINT32_MAX;
+        while (bits) {
+            int id = __builtin_ctz(bits);
+            bits &= bits - 1;
+            int32_t wait = (int32_t)(tasks[id].due - now);
+            if (wait <= 0) {
+                return 0;
+            }
+            if (tasks[id].due / TICK_MS - lastTick == i && (uint32_t)wait < earliest) {
+                earliest = wait;
+            }
+        }
+        if (earliest != UINT32_MAX) {
+            return earliest;
+        }
+    }
+
+    // Nothing within a revolution, look at every task
+    uint32_t earliest = UINT32_MAX;
+    for (size_t id = 0; id < taskCount; id++) {
+        if (!tasks[id].queued) {
+            continue;
+        }
+        int32_t wait = (int32_t)(tasks[id].due - now);
+        if (wait <= 0) {
+            return 0;
+        }
+        if ((uint32_t)wait < earliest) {
+            earliest = wait;
+        }
+    }
+    return earliest;
+}
+
+void TaskScheduler::resetStats() {
+    for (size_t id = 0; id < taskCount; id++) {
+        TaskStats& stats = tasks[id].stats;
+        stats.runs = 0;
+        stats.overruns = 0;
+        stats.skipped = 0;
+        stats.lastMicros = 0;
+        stats.worstMicros = 0;
+        stats.totalMicros = 0;
+        stats.worstLateness = 0;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+// Cooperative scheduler for the periodic work of loop().
+//
+// Each task runs every `period` milliseconds. Due times are kept in a hashed
+// timer wheel of WHEEL_SLOTS slots of TICK_MS each, with a bit per task, so a
+// run only looks at the slots that have passed since the last one and the idle
+// time until the next task is found by walking the slots ahead. Tasks due
+// together run in priority order. A run that completes later than the task's
+// deadline after it was due counts as an overrun; if it was so late that whole
+// periods passed, those are skipped rather than run back to back.
+// The clock is passed in, so tools/task-scheduler-test runs it on the host
+// through a millis() wrap.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+typedef std::function<void()> TaskCallback;
+
+// Configuration and run statistics of a task
+struct TaskStats {
+    const char* name;
+    uint32_t period;         // ms
+    uint32_t deadline;       // ms after the due time a run must have completed
+    uint8_t priority;        // Lower runs first
+    bool enabled;
+    uint32_t runs;
+    uint32_t overruns;       // Runs completed after the deadline
+    uint32_t skipped;        // Periods skipped because a run started too late
+    uint32_t lastMicros;     // Execution time of the last run
+    uint32_t worstMicros;    // Longest execution time
+    uint64_t totalMicros;    // Execution time of all runs, for the average
+    uint32_t worstLateness;  // Longest delay between the due time and the start (ms)
+};
+
+class TaskScheduler {
+public:
+    static const size_t MAX_TASKS = 16;
+    static const uint32_t TICK_MS = 10;
+    static const size_t WHEEL_SLOTS = 64;        // 640 ms per revolution
+
+    static const uint8_t PRIORITY_HIGH = 0;
+    static const uint8_t PRIORITY_NORMAL = 1;
+    static const uint8_t PRIORITY_LOW = 2;
+
+    // Microsecond clock used to time the tasks (micros() on the device)
+    typedef unsigned long (*ClockFunction)();
+
+private:
+    struct Task {
+        TaskCallback callback;
+        TaskStats stats;
+        uint32_t due;        // millis() of the next run
+        bool queued;         // In the wheel
+    };
+
+    Task tasks[MAX_TASKS];
+    size_t taskCount;
+    uint16_t wheel[WHEEL_SLOTS];  // Bit per task due in the slot, this or a later revolution
+    uint32_t lastTick;            // Last tick that was processed
+    ClockFunction clock;
+
+    static size_t slotOf(uint32_t time) { return (time / TICK_MS) % WHEEL_SLOTS; }
+    void enqueue(size_t id, uint32_t due);
+    void dequeue(size_t id);
+    void runTask(size_t id, uint32_t now, uint32_t startMicros);
+
+public:
+    explicit TaskScheduler(ClockFunction microsClock);
+
+    // Add a task first due at `now`; the deadline defaults to the period.
+    // Returns the task id, -1 if there is no room.
+    int addTask(const char* name, uint32_t periodMs, TaskCallback callback, uint32_t now,
+                uint8_t priority = PRIORITY_NORMAL, uint32_t deadlineMs = 0);
+    void setPeriod(int id, uint32_t periodMs, uint32_t now);
+    void setEnabled(int id, bool enabled, uint32_t now);
+
+    // Run the tasks that are due, returns how many ran
+    size_t run(uint32_t now);
+
+    // Milliseconds until the next task is due, 0 if one is due now
+    uint32_t getIdleTime(uint32_t now) const;
+
+    size_t getTaskCount() const { return taskCount; }
+    const TaskStats& getStats(size_t id) const { return tasks[id].stats; }
+    void resetStats();
+};
+
+#endif // TASKSCHEDULER_H
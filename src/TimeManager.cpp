@@ -1,4 +1,6 @@
 #include "TimeManager.h"
+#include "CivilDate.h"
+#include "Profiler.h"
 
 TimeManager::TimeManager() : timeInitialized(false), lastSyncTime(0) {
     ntpClient = new NTPClient(ntpUDP, "pool.ntp.org", 0); // Start with UTC, we'll adjust for timezone later
@@ -124,16 +126,26 @@ void TimeManager::begin() {
 }
 
 void TimeManager::update() {
+    PROFILE_STAGE(PROFILE_TIME_UPDATE);
     unsigned long currentMillis = millis();
     
     // Only sync if not initialized or if sync interval has passed
     if (!timeInitialized || (currentMillis - lastSyncTime >= syncInterval)) {
+        bool wasInitialized = timeInitialized;
+        time_t previousTime = ntpClient->getEpochTime();
+        
         if (ntpClient->update()) {
             // Convert NTP time to time_t
             time_t epochTime = ntpClient->getEpochTime();
             setTime(epochTime);
             
             timeInitialized = true;
+            
+            // Report the first sync and any noticeable step of the clock
+            int32_t step = wasInitialized ? (int32_t)(epochTime - previousTime) : 0;
+            if (timeSyncCallback && (!wasInitialized || abs(step) >= timeStepThreshold)) {
+                timeSyncCallback(step);
+            }
             lastSyncTime = currentMillis;
             
             Serial.println("Time synchronized with NTP server");
@@ -207,3 +219,7 @@ String TimeManager::getFormattedDateTime() const {
             timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
     return String(buffer);
 }
+
+void TimeManager::civilFromDays(int32_t days, int& year, int& month, int& day) {
+    ::civilFromDays(days, year, month, day);
+}
@@ -8,6 +8,7 @@
 #include <ESP8266HTTPClient.h>
 #include <ArduinoJson.h>
 #include <TimeLib.h>
+#include <functional>
 
 class TimeManager {
 private:
@@ -16,6 +17,8 @@ private:
     bool timeInitialized;
     unsigned long lastSyncTime;
     const unsigned long syncInterval = 3600000; // Sync every hour
+    const int32_t timeStepThreshold = 2; // Report clock corrections of at least this many seconds
+    std::function<void(int32_t)> timeSyncCallback;
     int32_t timezoneOffset = 0; // Timezone offset in seconds
     bool timezoneInitialized = false;
     
@@ -29,6 +32,9 @@ public:
     void begin();
     void update();
     bool isTimeInitialized() const { return timeInitialized; }
+    
+    // Called with the clock step (seconds) when a sync corrects the time, or 0 on the first sync
+    void setTimeSyncCallback(std::function<void(int32_t step)> callback) { timeSyncCallback = callback; }
     // GMT/UTC time methods (for storage)
     time_t getCurrentGMTTime() const;
     String formatGMTTime(time_t t) const;
@@ -47,6 +53,9 @@ public:
     time_t localToGMT(time_t localTime) const;
     int32_t getTimezoneOffset() const { return timezoneOffset; }
     bool isTimezoneInitialized() const { return timezoneInitialized; }
+    
+    // Calendar date of a day number (days since 1970-01-01), without gmtime/localtime
+    static void civilFromDays(int32_t days, int& year, int& month, int& day);
 };
 
 #endif // TIMEMANAGER_H
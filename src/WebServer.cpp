@@ -1,5 +1,7 @@
 #include "WebServer.h"
 #include "version.h"
+#include "Profiler.h"
+#include "RelayTimer.h"
 
 extern "C" {
   #include "user_interface.h"
@@ -12,6 +14,101 @@ extern "C" {
 // Pressure sensor calibration
 extern float PRESSURE_MAX;
 
+// Parse a duration such as "30s", "5m", "1h", "1d" or plain seconds, at most maxSeconds
+static bool parseDuration(const String& text, uint32_t& seconds, uint32_t maxSeconds = UINT32_MAX) {
+    if (text.length() == 0) {
+        return false;
+    }
+    
+    uint32_t multiplier = 1;
+    size_t digits = text.length();
+    switch (text.charAt(text.length() - 1)) {
+        case 's': multiplier = 1; digits--; break;
+        case 'm': multiplier = 60; digits--; break;
+        case 'h': multiplier = 3600; digits--; break;
+        case 'd': multiplier = 86400; digits--; break;
+        default: break;
+    }
+    if (digits == 0 || digits > 10) {
+        return false;
+    }
+    
+    // Only digits before the unit, so "1.5h" or "10min" are rejected rather than truncated
+    uint64_t value = 0;
+    for (size_t i = 0; i < digits; i++) {
+        char c = text.charAt(i);
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    if (value == 0 || value > maxSeconds / multiplier) {
+        return false;
+    }
+    seconds = (uint32_t)value * multiplier;
+    return true;
+}
+
+// Parse a single HTTP byte range ("bytes=start-end", "bytes=start-" or "bytes=-suffix")
+// against a resource of the given size. Returns false if the range is not satisfiable.
+static bool parseByteRange(const String& header, size_t size, size_t& start, size_t& end) {
+    if (!header.startsWith("bytes=") || size == 0) {
+        return false;
+    }
+    
+    String spec = header.substring(6);
+    int dash = spec.indexOf('-');
+    if (dash < 0 || spec.indexOf(',') >= 0) {
+        return false; // Multiple ranges are not supported
+    }
+    
+    String startStr = spec.substring(0, dash);
+    String endStr = spec.substring(dash + 1);
+    
+    if (startStr.length() == 0) {
+        // Suffix range: the last N bytes
+        long suffix = endStr.toInt();
+        if (suffix <= 0) {
+            return false;
+        }
+        start = (size_t)suffix >= size ? 0 : size - suffix;
+        end = size - 1;
+        return true;
+    }
+    
+    start = startStr.toInt();
+    end = endStr.length() > 0 ? (size_t)endStr.toInt() : size - 1;
+    if (start >= size || end < start) {
+        return false;
+    }
+    end = min(end, size - 1);
+    return true;
+}
+
+// Visit the last `days` days up to and including today, newest first. Counts
+// down an offset, as a day number counting down to the first day would wrap at 0.
+static void forEachRecentDay(uint32_t today, int days, const std::function<void(uint32_t day)>& visit) {
+    for (int i = 0; i < days && (uint32_t)i <= today; i++) {
+        visit(today - i);
+    }
+}
+
+// Summary fields of a quantile sketch as JSON members (without braces)
+static String sketchSummaryJson(const QuantileSketch& sketch) {
+    String json = "\"count\":" + String(sketch.getCount()) + ",\"below\":" + String(sketch.getLowCount());
+    const float quantiles[] = { 0.5f, 0.95f, 0.99f };
+    const char* names[] = { "p50", "p95", "p99" };
+    float value;
+    if (sketch.getCount() > 0) {
+        json += ",\"min\":" + String(sketch.getMin(), 3) + ",\"max\":" + String(sketch.getMax(), 3);
+    }
+    for (int i = 0; i < 3; i++) {
+        json += ",\"" + String(names[i]) + "\":";
+        json += sketch.quantile(quantiles[i], value) ? String(value, 3) : String("null");
+    }
+    return json;
+}
+
 // Implementation of the drawArcSegment function
 String WebServer::drawArcSegment(float cx, float cy, float radius, float startAngle, float endAngle, String color, float opacity) {
   // Calculate start and end points of the arc
@@ -55,7 +152,9 @@ WebServer::WebServer(float& pressure, int& rawADC, float& voltage, float& thresh
       otaEnabledTime(0),
       otaEnabled(false),
       pressureLogger(pressureLog),
-      display(nullptr) {
+      display(nullptr),
+      changeDetector(nullptr),
+      backflushController(nullptr), taskScheduler(nullptr), powerManager(nullptr) {
 }
 
 void WebServer::setupOTA() {
@@ -124,14 +223,46 @@ void WebServer::begin() {
     server.on("/setretention", HTTP_POST, std::bind(&WebServer::handleSetRetention, this));
     server.on("/setpressurethreshold", HTTP_POST, std::bind(&WebServer::handleSetPressureThreshold, this));
     server.on("/setpressuremaxinterval", HTTP_POST, std::bind(&WebServer::handleSetPressureMaxInterval, this));
+    server.on("/setheapreserve", HTTP_POST, std::bind(&WebServer::handleSetHeapReserve, this));
+    server.on("/setdetector", HTTP_POST, std::bind(&WebServer::handleSetDetector, this));
+    server.on("/setadaptive", HTTP_POST, std::bind(&WebServer::handleSetAdaptive, this));
+    server.on("/setcatchup", HTTP_POST, std::bind(&WebServer::handleSetCatchUp, this));
+    server.on("/setguard", HTTP_POST, std::bind(&WebServer::handleSetGuard, this));
+    server.on("/setpredictive", HTTP_POST, std::bind(&WebServer::handleSetPredictive, this));
+    server.on("/setpowersave", HTTP_POST, std::bind(&WebServer::handleSetPowerSave, this));
     server.on("/pressure.csv", [this]() { handlePressureCsv(); });
     server.on("/api/pressure/readings", HTTP_GET, [this]() { handlePressureReadingsApi(); });
+    server.on("/api/pressure/query", HTTP_GET, [this]() { handlePressureQueryApi(); });
+    server.on("/api/pressure/export.bin", HTTP_GET, [this]() { handlePressureExport(); });
+    server.on("/api/pressure/markers", HTTP_GET, [this]() { handlePressureMarkersApi(); });
+    server.on("/api/pressure/quantiles", HTTP_GET, [this]() { handlePressureQuantilesApi(); });
+    server.on("/api/pump/runtime", HTTP_GET, [this]() { handlePumpRuntimeApi(); });
+    server.on("/api/schedule/preview", HTTP_GET, [this]() { handleSchedulePreviewApi(); });
+    server.on("/api/backflush/stats", HTTP_GET, [this]() { handleBackflushStatsApi(); });
+    server.on("/api/tasks", HTTP_GET, [this]() { handleTaskStatsApi(); });
+#ifdef ENABLE_PROFILER
+    server.on("/debug/profile", HTTP_GET, [this]() { handleProfileApi(); });
+#endif
+    
+    // Request headers needed for resumable downloads
+    static const char* headerKeys[] = { "Range", "If-Range" };
+    server.collectHeaders(headerKeys, 2);
+    
+    // Requests keep the device out of light sleep for a while, so follow-up requests are answered quickly
+    server.addHook([this](const String&, const String&, WiFiClient*, ESP8266WebServer::ContentTypeFunction) {
+        if (powerManager) {
+            powerManager->noteWebRequest(millis());
+        }
+        return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+    });
     
     server.begin();
     Serial.println("HTTP server started");
 }
 
 void WebServer::handleClient() {
+    PROFILE_STAGE(PROFILE_WEB);
+    
     server.handleClient();
     
     // Handle OTA updates
@@ -607,6 +738,14 @@ void WebServer::handleAPI() {
       json += ",\"backflush_elapsed\":" + String(elapsedTime);
     }
     
+    // Add automatic backflush guard state
+    if (backflushController) {
+      json += ",\"backflush_state\":\"" + String(BackflushController::stateName(backflushController->getState())) + "\"";
+      json += ",\"backflush_armed\":" + String(backflushController->isArmed() ? "true" : "false");
+      json += ",\"backflushes_today\":" + String(backflushController->getFlushesToday());
+      json += ",\"lockout_remaining\":" + String(backflushController->getLockoutRemaining(millis()));
+    }
+    
     // Add next scheduled backflush if available
     time_t nextScheduleTime;
     unsigned int nextScheduleDuration;
@@ -614,6 +753,57 @@ void WebServer::handleAPI() {
       json += ",\"next_scheduled_backflush\":" + String(nextScheduleTime);
       json += ",\"next_scheduled_duration\":" + String(nextScheduleDuration);
     }
+    json += ",\"schedules_missed\":" + String(scheduler.getMissedCount());
+    
+    // Add clogging rate since the last backflush if enough readings are available
+    float clogRate, clogRateError;
+    const ClogRateEstimator& estimator = pressureLogger.getClogRate();
+    if (estimator.getSlope(clogRate, clogRateError)) {
+      json += ",\"clog_rate\":" + String(clogRate, 4);
+      json += ",\"clog_rate_stderr\":" + String(clogRateError, 4);
+      json += ",\"clog_rate_r2\":" + String(estimator.getRSquared(), 3);
+      json += ",\"clog_rate_samples\":" + String(estimator.getSampleCount());
+    }
+    float clogRatePerPumpHour;
+    if (pressureLogger.getClogRatePerPumpHour(clogRatePerPumpHour)) {
+      json += ",\"clog_rate_per_pump_hour\":" + String(clogRatePerPumpHour, 5);
+    }
+    
+    // Add inferred pump state and today's runtime
+    const PumpRuntime& pumpRuntime = pressureLogger.getPumpRuntime();
+    json += ",\"pump_on\":" + String(pumpRuntime.isPumpOn() ? "true" : "false");
+    if (timeManager.isTimeInitialized()) {
+      const PumpRuntime::DayRuntime* today = pumpRuntime.getDay(pressureLogger.getLocalDay(timeManager.getCurrentGMTTime()));
+      json += ",\"pump_runtime_today\":" + String(today ? today->onSeconds : 0);
+    }
+    
+    // Add forecast threshold crossing and any pending predictive backflush (local time)
+    time_t forecastTime;
+    if (timeManager.isTimeInitialized() &&
+        estimator.forecastCrossing(backflushThreshold, timeManager.getCurrentGMTTime(), forecastTime)) {
+      json += ",\"threshold_forecast\":" + String(timeManager.gmtToLocal(forecastTime));
+    }
+    time_t predictiveTime;
+    unsigned int predictiveDuration;
+    if (scheduler.getPredictiveBackflush(predictiveTime, predictiveDuration)) {
+      json += ",\"predictive_backflush\":" + String(predictiveTime);
+      json += ",\"predictive_duration\":" + String(predictiveDuration);
+    }
+    
+    // Add pressure history size across the RAM and flash tiers
+    json += ",\"history_readings\":" + String(pressureLogger.getTotalReadingCount());
+    json += ",\"history_recent_readings\":" + String(pressureLogger.getReadingCount());
+    json += ",\"history_segments\":" + String(pressureLogger.getHistoryStore().getSegmentCount());
+    json += ",\"history_capacity\":" + String(pressureLogger.getCapacity());
+    json += ",\"heap_reserve\":" + String(settings.getHeapReserve());
+    json += ",\"free_heap\":" + String(ESP.getFreeHeap());
+    json += ",\"max_free_block\":" + String(ESP.getMaxFreeBlockSize());
+    
+    // Add power saving state; the share of time spent running tasks approximates the average current
+    if (powerManager) {
+      json += ",\"sleep_mode\":\"" + String(PowerManager::modeName(powerManager->getMode())) + "\"";
+      json += ",\"active_percent\":" + String(powerManager->getActivePercent(), 1);
+    }
     
     json += "}";
     server.send(200, "application/json", json);
@@ -634,6 +824,7 @@ void WebServer::handleBackflushConfig() {
       // Update settings
       settings.setBackflushThreshold(newThreshold);
       settings.setBackflushDuration(newDuration);
+      pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
       
       backflushConfigChanged = true;
       
@@ -671,15 +862,28 @@ void WebServer::handleBackflushLog() {
     <div class='container'>
       <h1>Backflush Event Log</h1>)HTML");
   
-  // Add event count
-  html += "    <p>Total events: " + String(backflushLogger.getEventCount()) + "</p>\n";
+  // Add event count and the page shown, newest events on the first page
+  const int pageSize = 50;
+  int totalEvents = backflushLogger.getEventCount();
+  int totalPages = max(1, (totalEvents + pageSize - 1) / pageSize);
+  int page = server.hasArg("page") ? server.arg("page").toInt() : 1;
+  page = constrain(page, 1, totalPages);
+  html += "    <p>Total events: " + String(totalEvents) + " (page " + String(page) + " of " + String(totalPages) + ")</p>\n";
   server.send(200, "text/html", html);
   
-  // Add events table
-  server.sendContent(backflushLogger.getEventsAsHtml());
+  // Stream the events table straight from the log
+  backflushLogger.writeEventsHtml((page - 1) * pageSize, pageSize, [this](const char* data, size_t length) {
+    server.sendContent(data, length);
+  });
   
   // Add navigation and action buttons
   html = "    <p>\n";
+  if (page > 1) {
+    html += "      <a href='/log?page=" + String(page - 1) + "' class='button'>Newer</a>\n";
+  }
+  if (page < totalPages) {
+    html += "      <a href='/log?page=" + String(page + 1) + "' class='button'>Older</a>\n";
+  }
   html += "      <a href='/' class='button'>Back to Dashboard</a>\n";
   html += "      <a href='/clearlog' class='button danger' onclick='return confirm(\"Are you sure you want to clear all log entries?\")'>Clear Log</a>\n";
   html += "    </p>\n";
@@ -752,6 +956,18 @@ void WebServer::handlePressureHistory() {
     server.sendContent("var currentPressure = " + String(currentPressure, 2) + ";\n");
     server.sendContent("var currentTime = " + String(utcTime) + ";\n");
     
+    // Add clogging rate since the last backflush (null until enough readings are available)
+    float clogRate, clogRateError;
+    const ClogRateEstimator& estimator = pressureLogger.getClogRate();
+    if (estimator.getSlope(clogRate, clogRateError)) {
+        server.sendContent("var clogRate = {rate: " + String(clogRate, 4) +
+                           ", stderr: " + String(clogRateError, 4) +
+                           ", r2: " + String(estimator.getRSquared(), 3) +
+                           ", samples: " + String(estimator.getSampleCount()) + "};\n");
+    } else {
+        server.sendContent("var clogRate = null;\n");
+    }
+    
     // Add loading indicator and chart update function
     server.sendContent(F(R"HTML(
       var loading = true;
@@ -851,6 +1067,9 @@ void WebServer::handlePressureHistory() {
               tooltip: {
                 callbacks: {
                   label: function(context) {
+                    if (context.raw && context.raw.marker) {
+                      return (markerStyles[context.raw.marker.type] || { label: context.raw.marker.type }).label;
+                    }
                     return `Pressure: ${context.parsed.y.toFixed(2)} bar`;
                   }
                 }
@@ -887,6 +1106,9 @@ void WebServer::handlePressureHistory() {
           }
         });
         
+        // Overlay event markers for the charted range
+        loadMarkers(pressureData[0].time, currentTime + 1);
+        
         // Add reset zoom button functionality
         document.getElementById('reset-zoom').addEventListener('click', function() {
           if (pressureChart) {
@@ -938,6 +1160,39 @@ void WebServer::handlePressureHistory() {
         document.dispatchEvent(new Event('dataLoaded'));
       }
       
+      // Event marker colours and tooltip labels
+      var markerStyles = {
+        backflush_start: { color: 'rgb(231, 76, 60)', label: 'Backflush started' },
+        backflush_end: { color: 'rgb(39, 174, 96)', label: 'Backflush finished' },
+        reboot: { color: 'rgb(142, 68, 173)', label: 'Reboot' },
+        time_sync: { color: 'rgb(243, 156, 18)', label: 'Clock adjusted' },
+        settings_change: { color: 'rgb(52, 152, 219)', label: 'Settings changed' },
+        pump_start: { color: 'rgb(22, 160, 133)', label: 'Pump started' },
+        pump_stop: { color: 'rgb(127, 140, 141)', label: 'Pump stopped' },
+        abnormal_rise: { color: 'rgb(211, 84, 0)', label: 'Abnormal pressure rise' }
+      };
+      
+      // Fetch markers for a time range and show them along the bottom of the chart
+      function loadMarkers(from, to) {
+        fetch(`/api/pressure/markers?from=${from}&to=${to}`)
+          .then(response => response.json())
+          .then(data => {
+            if (!pressureChart || !data.markers || data.markers.length === 0) return;
+            pressureChart.data.datasets.push({
+              label: 'Events',
+              type: 'scatter',
+              data: data.markers.map(m => ({ x: m.time * 1000, y: pressureChart.options.scales.y.min, marker: m })),
+              pointStyle: 'triangle',
+              pointRadius: 7,
+              pointHoverRadius: 9,
+              pointBackgroundColor: data.markers.map(m => (markerStyles[m.type] || { color: '#999' }).color),
+              borderWidth: 0
+            });
+            pressureChart.update('none');
+          })
+          .catch(error => console.error('Error loading markers:', error));
+      }
+      
       // Function to load all data in chunks
       function loadAllData() {
         var offset = 0;
@@ -1033,6 +1288,57 @@ void WebServer::handlePressureHistory() {
               <button type="button" onclick="savePressureMaxInterval()" class='btn'>Save</button>
               <p id="pressureMaxIntervalStatus" style="font-weight: bold; margin-top: 10px;"></p>
             </div></form> </div>
+          <div class='settings-form'> <form> <div class='form-group'>
+                <label for='heapReserve' style="width: 220px;">Memory Reserve (bytes):</label>
+                <input type='number' id='heapReserve' name='heapReserve' min='4096' max='32768' step='1024' value=')HTML"));
+      server.sendContent(String(settings.getHeapReserve()));
+      server.sendContent(F(R"HTML('>
+              <button type="button" onclick="saveHeapReserve()" class='btn'>Save</button>
+              <p><small>Free memory kept for the web server; the rest holds recent readings (currently )HTML"));
+      server.sendContent(String(pressureLogger.getCapacity()));
+      server.sendContent(F(R"HTML( readings)</small></p>
+              <p id="heapReserveStatus" style="font-weight: bold; margin-top: 10px;"></p>
+            </div></form> </div>
+          <div class='settings-form'> <form> <div class='form-group'>
+                <label for='pumpStepThreshold' style="width: 220px;">Pump On/Off Step (bar):</label>
+                <input type='number' id='pumpStepThreshold' name='pumpStepThreshold' min='0.05' max='2' step='0.05' value=')HTML"));
+      server.sendContent(String(settings.getPumpStepThreshold(), 2));
+      server.sendContent(F(R"HTML('>
+              <button type="button" onclick="savePumpStepThreshold()" class='btn'>Save</button>
+              <p id="pumpStepThresholdStatus" style="font-weight: bold; margin-top: 10px;"></p>
+            </div></form> </div>
+          <div class='settings-form'> <form> <div class='form-group'>
+                <label for='riseThreshold' style="width: 220px;">Abnormal Rise Alarm (bar):</label>
+                <input type='number' id='riseThreshold' name='riseThreshold' min='0.05' max='2' step='0.05' value=')HTML"));
+      server.sendContent(String(settings.getRiseAlarmThreshold(), 2));
+      server.sendContent(F(R"HTML('>
+              <button type="button" onclick="saveRiseThreshold()" class='btn'>Save</button>
+              <p><small>Sustained rise above the running pressure that raises an event marker</small></p>
+              <p id="riseThresholdStatus" style="font-weight: bold; margin-top: 10px;"></p>
+            </div></form> </div>
+          <div class='settings-form'> <form> <div class='form-group'>
+                <label for='pumpOnThreshold' style="width: 220px;">Pump Running Above (bar):</label>
+                <input type='number' id='pumpOnThreshold' name='pumpOnThreshold' min='0.05' max='2' step='0.05' value=')HTML"));
+      server.sendContent(String(settings.getPumpOnThreshold(), 2));
+      server.sendContent(F(R"HTML('>
+              <button type="button" onclick="savePumpOnThreshold()" class='btn'>Save</button>
+              <p><small>Counted as stopped again below half of this, for the pump runtime</small></p>
+              <p id="pumpOnThresholdStatus" style="font-weight: bold; margin-top: 10px;"></p>
+            </div></form> </div>
+          <div class='settings-form'> <form> <div class='form-group'>
+                <label for='powerSave' style="width: 220px;">Power Saving:</label>
+                <select id='powerSave' name='powerSave'>)HTML"));
+      static const char* const POWER_SAVE_MODES[] = {"Off", "Modem sleep", "Light sleep when idle"};
+      for (uint8_t mode = 0; mode <= 2; mode++) {
+        server.sendContent("<option value='" + String(mode) + "'" + (settings.getPowerSave() == mode ? " selected" : "") + ">" + POWER_SAVE_MODES[mode] + "</option>");
+      }
+      server.sendContent(F(R"HTML(</select>
+              <button type="button" onclick="savePowerSave()" class='btn'>Save</button>
+              <p><small>Light sleep is left while web pages are in use or a backflush runs; CPU active )HTML"));
+      server.sendContent(powerManager ? String(powerManager->getActivePercent(), 1) : String("-"));
+      server.sendContent(F(R"HTML(% of the time</small></p>
+              <p id="powerSaveStatus" style="font-weight: bold; margin-top: 10px;"></p>
+            </div></form> </div>
       </div>
     </div>
     
@@ -1078,6 +1384,12 @@ void WebServer::handlePressureHistory() {
         const formatDate = (date) => {
           return date.toLocaleString(undefined, dateFormatOptions);
         };
+        
+        // Format clogging rate with its uncertainty
+        const clogRateHTML = clogRate
+          ? `<strong>${clogRate.rate >= 0 ? '+' : ''}${clogRate.rate.toFixed(3)}</strong> &plusmn; ${clogRate.stderr.toFixed(3)} bar/day
+             <div style="margin-top: 5px; font-size: 0.9em;">R&sup2; ${clogRate.r2.toFixed(2)} over ${clogRate.samples} readings</div>`
+          : 'Not enough readings since the last backflush';
       )HTML"));
       server.sendContent(F(R"HTML(
         // Create the summary HTML
@@ -1104,6 +1416,10 @@ void WebServer::handlePressureHistory() {
                 Average: <strong>${avgPressure.toFixed(2)}</strong> bar
               </div>
             </div>
+            <div style="background: white; padding: 10px; border-radius: 4px; box-shadow: 0 1px 3px rgba(0,0,0,0.1);">
+              <div style="font-size: 0.9em; color: #666; margin-bottom: 5px;">Clogging Rate</div>
+              <div style="font-size: 1.1em;">${clogRateHTML}</div>
+            </div>
           </div>
         `;
         
@@ -1145,6 +1461,21 @@ void WebServer::handlePressureHistory() {
       function savePressureMaxInterval() {
         saveParameter('/setpressuremaxinterval', 'pressureMaxInterval', 'pressureMaxIntervalStatus');
       }
+      function saveHeapReserve() {
+        saveParameter('/setheapreserve', 'heapReserve', 'heapReserveStatus');
+      }
+      function savePumpStepThreshold() {
+        saveParameter('/setdetector', 'pumpStepThreshold', 'pumpStepThresholdStatus');
+      }
+      function saveRiseThreshold() {
+        saveParameter('/setdetector', 'riseThreshold', 'riseThresholdStatus');
+      }
+      function savePumpOnThreshold() {
+        saveParameter('/setdetector', 'pumpOnThreshold', 'pumpOnThresholdStatus');
+      }
+      function savePowerSave() {
+        saveParameter('/setpowersave', 'powerSave', 'powerSaveStatus');
+      }
     </script>
     )HTML"));
     
@@ -1374,9 +1705,11 @@ void WebServer::handleStopBackflush() {
     needManualBackflush = false;
     
     // Turn off relay and LED
-    digitalWrite(RELAY_PIN, LOW);  // Deactivate relay
-    digitalWrite(LED_PIN, HIGH);   // Turn LED OFF (inverse logic on NodeMCU)
+    RelayTimer::stop(true);
     Serial.println("Manual backflush stopped");
+    backflushLogger.endEvent(elapsedTime);
+    pressureLogger.addMarker(MARKER_BACKFLUSH_END, elapsedTime);
+    pressureLogger.markBackflush();
     
     Serial.println("Backflush stopped manually");
     Serial.print("Actual duration: ");
@@ -1688,6 +2021,7 @@ void WebServer::handleSensorConfig() {
         }
     }
     
+    pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
     server.send(200, "text/plain", message);
 }
 
@@ -1697,6 +2031,7 @@ void WebServer::handleResetCalibration() {
     settings.reset();
     // Reload the calibration to ensure it's in memory
     settings.loadCalibration();
+    pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
     server.send(200, "text/plain", "Calibration reset to default values");
 }
 
@@ -1719,6 +2054,9 @@ void WebServer::handlePressureReadingsApi() {
             JsonObject readingObj = readingsArray.add<JsonObject>();
             readingObj["time"] = reading.timestamp;
             readingObj["pressure"] = reading.pressure;
+            if (reading.flags & PRESSURE_FLAG_FORCED) {
+                readingObj["forced"] = true;
+            }
             
             // Add formatted time string
             char timeStr[20];
@@ -1753,21 +2091,468 @@ void WebServer::handlePressureReadingsApi() {
     server.send(200, "application/json", json);
 }
 
-void WebServer::handlePressureCsv() {
-    Serial.printf("[Memory] handlePressureCsv start: %d bytes free\n", ESP.getFreeHeap());
-    // FIXME chunk this into 2k chunks
-    String csv = pressureLogger.getReadingsAsCsv();
+void WebServer::handlePressureQueryApi() {
+    // Parse query parameters, defaulting to all readings in hourly averages
+    time_t from = server.hasArg("from") ? (time_t)server.arg("from").toInt() : 0;
+    time_t to = server.hasArg("to") ? (time_t)server.arg("to").toInt() : timeManager.getCurrentGMTTime() + 1;
+    
+    uint32_t bucketSeconds = 3600;
+    if (server.hasArg("bucket") && !parseDuration(server.arg("bucket"), bucketSeconds)) {
+        server.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid bucket, use e.g. 5m, 1h or 1d\"}");
+        return;
+    }
+    
+    AggregateFunction function = AggregateFunction::AVG;
+    if (server.hasArg("agg") && !PressureLogger::parseAggregateFunction(server.arg("agg"), function)) {
+        server.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid agg, use min, max, avg, count, first, last or p95\"}");
+        return;
+    }
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    String chunk = "{\"from\":" + String(from) + ",\"to\":" + String(to) +
+                   ",\"bucket\":" + String(bucketSeconds) +
+                   ",\"agg\":\"" + PressureLogger::aggregateFunctionName(function) + "\",\"points\":[";
+    
+    // Stream buckets as [start,value,count] triples, flushing in small chunks
+    bool first = true;
+    size_t buckets = pressureLogger.queryAggregate(from, to, bucketSeconds, function,
+        [&](const AggregateBucket& bucket) {
+            if (!first) chunk += ",";
+            first = false;
+            chunk += "[" + String(bucket.start) + ",";
+            chunk += (function == AggregateFunction::COUNT) ? String(bucket.count) : String(bucket.value, 3);
+            chunk += "," + String(bucket.count) + "]";
+            if (chunk.length() >= 1024) {
+                server.sendContent(chunk);
+                chunk = "";
+            }
+        });
+    
+    chunk += "],\"count\":" + String(buckets) + "}";
+    server.sendContent(chunk);
+    server.sendContent("");
+}
+
+void WebServer::handlePressureMarkersApi() {
+    time_t from = server.hasArg("from") ? (time_t)server.arg("from").toInt() : 0;
+    time_t to = server.hasArg("to") ? (time_t)server.arg("to").toInt() : timeManager.getCurrentGMTTime() + 1;
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    String chunk = "{\"from\":" + String(from) + ",\"to\":" + String(to) + ",\"markers\":[";
+    bool first = true;
+    size_t count = pressureLogger.getMarkers(from, to, [&](const EventMarker& marker) {
+        if (!first) chunk += ",";
+        first = false;
+        chunk += "{\"time\":" + String(marker.timestamp) +
+                 ",\"type\":\"" + eventMarkerTypeName(marker.type) +
+                 "\",\"value\":" + String(marker.value) + "}";
+        if (chunk.length() >= 1024) {
+            server.sendContent(chunk);
+            chunk = "";
+        }
+    });
+    
+    chunk += "],\"count\":" + String(count) + "}";
+    server.sendContent(chunk);
+    server.sendContent("");
+}
+
+void WebServer::handleBackflushStatsApi() {
+    int limit = server.hasArg("count") ? server.arg("count").toInt() : 20;
+    limit = constrain(limit, 1, 200);
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    // Newest analysed events first, accumulating the averages and the trend of
+    // the reduction over time on the way
+    ClogRateEstimator reductionTrend;
+    float sumReduction = 0, sumRecovered = 0, sumTau = 0;
+    size_t analysed = 0;
+    String chunk = "{\"events\":[";
+    backflushLogger.getEvents(0, limit, [&](const BackflushEvent& event) {
+        if (isnan(event.postPressure)) {
+            return;
+        }
+        float reduction = BackflushAnalyzer::reductionPercent(event.pressure, event.postPressure);
+        if (analysed == 0) {
+            reductionTrend.reset(event.timestamp);
+        }
+        reductionTrend.addSample(event.timestamp, reduction);
+        sumReduction += reduction;
+        sumRecovered += event.postPressure;
+        sumTau += event.recoveryTau;
+        
+        if (analysed > 0) chunk += ",";
+        analysed++;
+        chunk += "{\"time\":" + String(event.timestamp) +
+                 ",\"type\":\"" + BackflushLogger::typeName(event.type) +
+                 "\",\"before\":" + String(event.pressure, 3) +
+                 ",\"recovered\":" + String(event.postPressure, 3) +
+                 ",\"reduction\":" + String(reduction, 1) +
+                 ",\"tau\":" + String(event.recoveryTau, 1) + "}";
+        if (chunk.length() >= 1024) {
+            server.sendContent(chunk);
+            chunk = "";
+        }
+    });
+    
+    chunk += "],\"analysed\":" + String(analysed);
+    if (analysed > 0) {
+        chunk += ",\"mean_reduction\":" + String(sumReduction / analysed, 1);
+        chunk += ",\"mean_recovered\":" + String(sumRecovered / analysed, 3);
+        chunk += ",\"mean_tau\":" + String(sumTau / analysed, 1);
+    }
+    
+    // Change of the reduction in percentage points per 30 days; falling means the media needs service
+    float slope, stdError;
+    if (reductionTrend.getSlope(slope, stdError)) {
+        chunk += ",\"reduction_trend\":" + String(slope * 30, 2);
+        chunk += ",\"reduction_trend_stderr\":" + String(stdError * 30, 2);
+    }
+    chunk += "}";
+    server.sendContent(chunk);
+    server.sendContent("");
+}
+
+void WebServer::handlePressureQuantilesApi() {
+    // Before the first sync the clock is the uptime, and the days are meaningless
+    if (!timeManager.isTimeInitialized()) {
+        server.send(503, "application/json", "{\"success\":false,\"message\":\"Time not synchronized\"}");
+        return;
+    }
+    
+    int days = server.hasArg("days") ? server.arg("days").toInt() : 7;
+    days = constrain(days, 1, (int)DailySketches::DAYS);
+    
+    const DailySketches& sketches = pressureLogger.getDailySketches();
+    uint32_t today = pressureLogger.getLocalDay(timeManager.getCurrentGMTTime());
+    uint32_t firstDay = today - days + 1;
+    
+    // One entry per day that has samples, newest first
+    String json = "{\"relative_accuracy\":" + String(QuantileSketch::RELATIVE_ACCURACY, 3) + ",\"days\":[";
+    bool first = true;
+    forEachRecentDay(today, days, [&](uint32_t day) {
+        const QuantileSketch* sketch = sketches.getDay(day);
+        if (!sketch) {
+            return;
+        }
+        if (!first) json += ",";
+        first = false;
+        json += "{\"date\":\"" + timeManager.formatGMTDate((time_t)day * 86400) + "\"," + sketchSummaryJson(*sketch) + "}";
+    });
+    
+    // The whole period, from the merged daily sketches
+    json += "],\"period\":{\"days\":" + String(days) + "," + sketchSummaryJson(sketches.merge(firstDay, today)) + "}}";
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServer::handlePumpRuntimeApi() {
+    if (!timeManager.isTimeInitialized()) {
+        server.send(503, "application/json", "{\"success\":false,\"message\":\"Time not synchronized\"}");
+        return;
+    }
+    
+    int days = server.hasArg("days") ? server.arg("days").toInt() : 7;
+    days = constrain(days, 1, (int)PumpRuntime::DAYS);
+    
+    const PumpRuntime& pumpRuntime = pressureLogger.getPumpRuntime();
+    uint32_t today = pressureLogger.getLocalDay(timeManager.getCurrentGMTTime());
+    uint32_t firstDay = today - days + 1;
+    
+    // One entry per day that has been observed, newest first
+    String json = "{\"pump_on\":" + String(pumpRuntime.isPumpOn() ? "true" : "false") +
+                  ",\"on_threshold\":" + String(pumpRuntime.getOnThreshold(), 2) + ",\"days\":[";
+    uint32_t totalOn = 0;
+    uint32_t totalStarts = 0;
+    bool first = true;
+    forEachRecentDay(today, days, [&](uint32_t day) {
+        const PumpRuntime::DayRuntime* runtime = pumpRuntime.getDay(day);
+        if (!runtime) {
+            return;
+        }
+        if (!first) json += ",";
+        first = false;
+        json += "{\"date\":\"" + timeManager.formatGMTDate((time_t)day * 86400) + "\"";
+        json += ",\"runtime\":" + String(runtime->onSeconds);
+        json += ",\"observed\":" + String(runtime->observedSeconds);
+        json += ",\"starts\":" + String(runtime->starts);
+        json += ",\"duty_cycle\":" + (runtime->observedSeconds ? String((float)runtime->onSeconds / runtime->observedSeconds, 3) : String("null")) + "}";
+        totalOn += runtime->onSeconds;
+        totalStarts += runtime->starts;
+    });
+    
+    // The whole period
+    float dutyCycle;
+    json += "],\"period\":{\"days\":" + String(days);
+    json += ",\"runtime\":" + String(totalOn);
+    json += ",\"starts\":" + String(totalStarts);
+    json += ",\"duty_cycle\":" + (pumpRuntime.getDutyCycle(firstDay, today, dutyCycle) ? String(dutyCycle, 3) : String("null")) + "}";
+    
+    // Clogging rate normalised to pump runtime
+    float clogRatePerPumpHour;
+    if (pressureLogger.getClogRatePerPumpHour(clogRatePerPumpHour)) {
+        json += ",\"clog_rate_per_pump_hour\":" + String(clogRatePerPumpHour, 5);
+    }
+    json += "}";
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+void WebServer::handleTaskStatsApi() {
+    if (!taskScheduler) {
+        server.send(503, "application/json", "{\"success\":false,\"message\":\"Task scheduler not available\"}");
+        return;
+    }
+    
+    // Configuration and run statistics of every task, times in ms unless noted
+    String json = "{\"uptime\":" + String(millis()) + ",\"tasks\":[";
+    for (size_t i = 0; i < taskScheduler->getTaskCount(); i++) {
+        const TaskStats& stats = taskScheduler->getStats(i);
+        if (i > 0) json += ",";
+        json += "{\"name\":\"" + String(stats.name) + "\"";
+        json += ",\"period\":" + String(stats.period);
+        json += ",\"deadline\":" + String(stats.deadline);
+        json += ",\"priority\":" + String(stats.priority);
+        json += ",\"enabled\":" + String(stats.enabled ? "true" : "false");
+        json += ",\"runs\":" + String(stats.runs);
+        json += ",\"overruns\":" + String(stats.overruns);
+        json += ",\"skipped\":" + String(stats.skipped);
+        json += ",\"last_us\":" + String(stats.lastMicros);
+        json += ",\"avg_us\":" + String(stats.runs ? (uint32_t)(stats.totalMicros / stats.runs) : 0);
+        json += ",\"worst_us\":" + String(stats.worstMicros);
+        json += ",\"worst_lateness\":" + String(stats.worstLateness) + "}";
+    }
+    json += "]";
+    
+    // Relay on-time error of the backflushes that ran to their deadline, actual minus intended (us)
+    const RelayTimingStats& relay = RelayTimer::getStats();
+    json += ",\"relay_off\":{\"count\":" + String(relay.count);
+    json += ",\"by_timer\":" + String(relay.timerCount);
+    json += ",\"early_stops\":" + String(relay.earlyStops);
+    json += ",\"min_us\":" + String(relay.minMicros);
+    json += ",\"avg_us\":" + String(relay.getAverageMicros());
+    json += ",\"max_us\":" + String(relay.maxMicros);
+    json += ",\"histogram\":[";
+    for (size_t i = 0; i < RelayTimingStats::HISTOGRAM_BUCKETS; i++) {
+        if (i > 0) json += ",";
+        json += String(relay.histogram[i]);
+    }
+    json += "]}}";
+    
+    // Start a new measurement period
+    if (server.arg("reset") == "1") {
+        taskScheduler->resetStats();
+        RelayTimer::resetStats();
+    }
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+
+#ifdef ENABLE_PROFILER
+void WebServer::handleProfileApi() {
+    // Durations in microseconds; histogram bucket i counts [2^i, 2^(i+1)) us
+    String json = "{\"cpu_mhz\":" + String(ESP.getCpuFreqMHz()) + ",\"stages\":[";
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        const Profiler::StageStats& stats = Profiler::getStats((ProfileStage)i);
+        if (i > 0) json += ",";
+        json += "{\"name\":\"" + String(Profiler::stageName((ProfileStage)i)) + "\"";
+        json += ",\"count\":" + String(stats.count);
+        json += ",\"min\":" + String(stats.minMicros);
+        json += ",\"avg\":" + String(stats.count ? (uint32_t)(stats.totalMicros / stats.count) : 0);
+        json += ",\"max\":" + String(stats.maxMicros);
+        json += ",\"histogram\":[";
+        for (size_t bucket = 0; bucket < Profiler::HISTOGRAM_BUCKETS; bucket++) {
+            if (bucket > 0) json += ",";
+            json += String(stats.histogram[bucket]);
+        }
+        json += "]}";
+    }
+    json += "]}";
+    
+    // Start a new measurement period
+    if (server.arg("reset") == "1") {
+        Profiler::reset();
+    }
+    
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.send(200, "application/json", json);
+}
+#endif
+
+void WebServer::handleSchedulePreviewApi() {
+    if (!timeManager.isTimeInitialized()) {
+        server.send(503, "application/json", "{\"success\":false,\"message\":\"Time not synchronized\"}");
+        return;
+    }
+    
+    int count = server.hasArg("count") ? server.arg("count").toInt() : 50;
+    count = constrain(count, 1, 500);
+    
+    uint32_t horizonSeconds = 365 * 86400;
+    if (server.hasArg("horizon") && (!parseDuration(server.arg("horizon"), horizonSeconds, 3660UL * 86400))) {
+        server.send(400, "application/json", "{\"success\":false,\"message\":\"Invalid horizon, use e.g. 7d or 365d (at most 3660d)\"}");
+        return;
+    }
+    
+    // An unsaved schedule, given with the /scheduleupdate form fields, is merged in
+    // without saving: in place of schedule `id`, or as a new one when there is no id
+    BackflushSchedule candidate;
+    size_t candidateIndex = scheduler.getScheduleCount();
+    bool hasCandidate = server.hasArg("type");
+    if (hasCandidate) {
+        String error;
+        if (!parseScheduleForm(candidate, error)) {
+            server.send(400, "application/json", "{\"success\":false,\"message\":\"" + error + "\"}");
+            return;
+        }
+        int id = server.hasArg("id") ? server.arg("id").toInt() : -1;
+        if (id >= 0 && (size_t)id < scheduler.getScheduleCount()) {
+            candidateIndex = id;
+        } else if (candidateIndex >= MAX_SCHEDULES) {
+            server.send(400, "application/json", "{\"success\":false,\"message\":\"Maximum number of schedules reached\"}");
+            return;
+        }
+    }
+    
+    time_t from = timeManager.getCurrentTime();
+    time_t until = from + horizonSeconds;
     
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    String chunk = "{\"from\":" + String(from) + ",\"until\":" + String(until) + ",\"firings\":[";
+    
+    // Stream the merged runs, flushing in small chunks
+    bool first = true;
+    ScheduleFiringCallback emit = [&](const ScheduleFiring& firing) {
+        int year, month, day;
+        TimeManager::civilFromDays(firing.time / 86400, year, month, day);
+        int minuteOfDay = (firing.time % 86400) / 60;
+        char datetime[20];
+        snprintf(datetime, sizeof(datetime), "%04d-%02d-%02d %02d:%02d", year, month, day, minuteOfDay / 60, minuteOfDay % 60);
+        
+        if (!first) chunk += ",";
+        first = false;
+        chunk += "{\"time\":" + String(firing.time) + ",\"datetime\":\"" + datetime + "\"";
+        chunk += ",\"duration\":" + String(firing.duration) + ",\"schedules\":[";
+        bool firstSchedule = true;
+        for (size_t i = 0; i < MAX_SCHEDULES; i++) {
+            if (firing.schedules & (1UL << i)) {
+                if (!firstSchedule) chunk += ",";
+                firstSchedule = false;
+                chunk += String(i);
+            }
+        }
+        chunk += "]}";
+        if (chunk.length() >= 1024) {
+            server.sendContent(chunk);
+            chunk = "";
+        }
+    };
+    size_t firings = scheduler.previewSchedules(from, until, count, emit,
+                                                hasCandidate ? &candidate : nullptr, candidateIndex);
+    
+    chunk += "],\"count\":" + String(firings);
+    if (hasCandidate) {
+        chunk += ",\"candidate\":" + String(candidateIndex);
+    }
+    chunk += "}";
+    server.sendContent(chunk);
+    server.sendContent("");
+}
+
+void WebServer::handlePressureExport() {
+    String range = server.header("Range");
+    
+    // A fresh download gets the latest readings; resumed ones must see the same data
+    if (range.length() == 0) {
+        pressureLogger.saveReadings();
+    }
+    
+    // The flash tier is exported as a single history file
+    const FlashHistoryStore& history = pressureLogger.getHistoryStore();
+    size_t size = history.getExportSize();
+    
+    // ETag from the record count and first/last timestamps identifies this version of the history
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%x-%x-%x\"", (unsigned)history.getRecordCount(),
+             (unsigned)history.getFirstTimestamp(), (unsigned)history.getLastTimestamp());
+    
+    // Only honour the range if the client's copy is of the same version (If-Range)
+    size_t start = 0;
+    size_t end = size - 1;
+    bool partial = false;
+    if (range.length() > 0 && (!server.hasHeader("If-Range") || server.header("If-Range") == etag)) {
+        if (!parseByteRange(range, size, start, end)) {
+            server.sendHeader("Content-Range", "bytes */" + String(size));
+            server.send(416, "text/plain", "Requested range not satisfiable");
+            return;
+        }
+        partial = true;
+    }
+    
+    server.sendHeader("Accept-Ranges", "bytes");
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Content-Disposition", "attachment; filename=pressure_history.bin");
+    if (partial) {
+        server.sendHeader("Content-Range", "bytes " + String(start) + "-" + String(end) + "/" + String(size));
+    }
+    server.setContentLength(end - start + 1);
+    server.send(partial ? 206 : 200, "application/octet-stream", "");
+    
+    // Stream the requested bytes straight from flash
+    uint8_t buffer[512];
+    size_t offset = start;
+    while (offset <= end) {
+        size_t bytesRead = history.readExport(offset, buffer, min(sizeof(buffer), end - offset + 1));
+        if (bytesRead == 0) {
+            break;
+        }
+        server.sendContent((const char*)buffer, bytesRead);
+        offset += bytesRead;
+    }
+}
+
+void WebServer::handlePressureCsv() {
     // Generate filename with current date
     time_t now = timeManager.getCurrentTime();
     struct tm* timeinfo = localtime(&now);
     char filename[32];
     strftime(filename, sizeof(filename), "pressure_%Y%m%d.csv", timeinfo);
     
-    server.sendHeader("Content-Type", "text/csv");
     server.sendHeader("Content-Disposition", "attachment; filename=" + String(filename));
-    server.send(200, "text/csv", csv);
-    Serial.printf("[Memory] handlePressureCsv end: %d bytes free\n", ESP.getFreeHeap());
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "");
+    
+    // Stream the whole history from both tiers in small chunks
+    String chunk = F("Timestamp,Date,Time,Pressure (bar)\r\n");
+    pressureLogger.queryReadings(0, timeManager.getCurrentGMTTime() + 1, [&](const PressureReading& reading) {
+        struct tm* readingTime = gmtime(&reading.timestamp);
+        char row[48];
+        snprintf(row, sizeof(row), "%u,%04d-%02d-%02d,%02d:%02d:%02d,%.2f\r\n", (unsigned)reading.timestamp,
+                 readingTime->tm_year + 1900, readingTime->tm_mon + 1, readingTime->tm_mday,
+                 readingTime->tm_hour, readingTime->tm_min, readingTime->tm_sec, reading.pressure);
+        chunk += row;
+        if (chunk.length() >= 1024) {
+            server.sendContent(chunk);
+            chunk = "";
+        }
+    });
+    server.sendContent(chunk);
+    server.sendContent("");
 }
 
 void WebServer::handleSetRetention() {
@@ -1782,6 +2567,7 @@ void WebServer::handleSetRetention() {
         if (retentionDays >= 1 && retentionDays <= 90) {
             // Update the setting
             settings.setDataRetentionDays(retentionDays);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
             
             // Immediately prune old data based on new retention period
             pressureLogger.pruneOldData();
@@ -1809,6 +2595,7 @@ void WebServer::handleSetPressureThreshold() {
         float newThreshold = server.arg("threshold").toFloat();
         if (newThreshold > 0 && newThreshold <= 1.0) {
             settings.setPressureChangeThreshold(newThreshold);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
             success = true;
             message = "Pressure change threshold updated to " + String(newThreshold, 2) + " bar";
         }
@@ -1827,6 +2614,7 @@ void WebServer::handleSetPressureMaxInterval() {
         unsigned int newInterval = server.arg("pressureMaxInterval").toInt();
         if (newInterval >= 1 && newInterval <= 1440) {
             settings.setPressureChangeMaxInterval(newInterval);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
             success = true;
             message = "Pressure change max interval updated to " + String(newInterval) + " minutes";
         }
@@ -1838,6 +2626,180 @@ void WebServer::handleSetPressureMaxInterval() {
     server.send(200, "application/json", jsonResponse);
 }
 
+void WebServer::handleSetHeapReserve() {
+    bool success = false;
+    String message = "Failed to update memory reserve";
+    if (server.hasArg("heapReserve")) {
+        unsigned int newReserve = server.arg("heapReserve").toInt();
+        if (newReserve >= 4096 && newReserve <= 32768) {
+            settings.setHeapReserve(newReserve);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = "Memory reserve updated to " + String(newReserve) + " bytes";
+        }
+        else {
+            message = "Invalid memory reserve. Must be between 4096 and 32768 bytes.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
+void WebServer::handleSetPowerSave() {
+    bool success = false;
+    String message = "Failed to update power saving";
+    if (server.hasArg("powerSave")) {
+        int mode = server.arg("powerSave").toInt();
+        if (mode >= 0 && mode <= 2) {
+            settings.setPowerSave(mode);
+            if (powerManager) {
+                powerManager->setMaxMode((PowerManager::SleepMode)mode);
+            }
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = "Power saving set to " + String(PowerManager::modeName((PowerManager::SleepMode)mode)) + " sleep";
+        }
+        else {
+            message = "Invalid power saving mode. Must be 0-2.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
+void WebServer::handleSetDetector() {
+    bool success = false;
+    String message = "Failed to update change detection settings";
+    if (server.hasArg("pumpStepThreshold") || server.hasArg("riseThreshold") || server.hasArg("pumpOnThreshold")) {
+        float stepThreshold = server.hasArg("pumpStepThreshold") ? server.arg("pumpStepThreshold").toFloat() : settings.getPumpStepThreshold();
+        float riseThreshold = server.hasArg("riseThreshold") ? server.arg("riseThreshold").toFloat() : settings.getRiseAlarmThreshold();
+        float onThreshold = server.hasArg("pumpOnThreshold") ? server.arg("pumpOnThreshold").toFloat() : settings.getPumpOnThreshold();
+        if (stepThreshold >= 0.05f && stepThreshold <= 2.0f && riseThreshold >= 0.05f && riseThreshold <= 2.0f &&
+            onThreshold >= 0.05f && onThreshold <= 2.0f) {
+            settings.setPumpStepThreshold(stepThreshold);
+            settings.setRiseAlarmThreshold(riseThreshold);
+            settings.setPumpOnThreshold(onThreshold);
+            if (changeDetector) {
+                // Restarts only for new step or rise thresholds, as a restart forgets
+                // that the pump is running and would report a spurious start
+                changeDetector->configure(stepThreshold, riseThreshold);
+                changeDetector->setPumpOnThreshold(onThreshold);
+            }
+            pressureLogger.setPumpOnThreshold(onThreshold);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = "Pump on " + String(onThreshold, 2) + " bar, step " + String(stepThreshold, 2) + " bar, rise alarm " + String(riseThreshold, 2) + " bar";
+        }
+        else {
+            message = "Invalid threshold. Must be between 0.05 and 2.0 bar.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
+void WebServer::handleSetPredictive() {
+    bool success = false;
+    String message = "Failed to update predictive backflush settings";
+    if (server.hasArg("predictiveWindow") && server.hasArg("quietStart") && server.hasArg("quietEnd")) {
+        int windowHours = server.arg("predictiveWindow").toInt();
+        int quietStart = server.arg("quietStart").toInt();
+        int quietEnd = server.arg("quietEnd").toInt();
+        if (windowHours >= 0 && windowHours <= 168 && quietStart >= 0 && quietStart <= 23 && quietEnd >= 0 && quietEnd <= 23) {
+            settings.setPredictiveWindowHours(windowHours);
+            settings.setQuietHours(quietStart, quietEnd);
+            scheduler.setPredictiveWindow(windowHours);
+            scheduler.setQuietHours(quietStart, quietEnd);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = windowHours == 0 ? String("Predictive backflush disabled")
+                                       : "Predictive backflush window updated to " + String(windowHours) + " hours";
+        }
+        else {
+            message = "Invalid values. Window must be 0-168 hours and quiet hours 0-23.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
+void WebServer::handleSetCatchUp() {
+    bool success = false;
+    String message = "Failed to update missed schedule settings";
+    if (server.hasArg("policy") && server.hasArg("window")) {
+        int policy = server.arg("policy").toInt();
+        int window = server.arg("window").toInt();
+        if (policy >= 0 && policy <= 2 && window >= 1 && window <= 1440) {
+            settings.setCatchUpPolicy(policy);
+            settings.setCatchUpWindow(window);
+            scheduler.setCatchUpPolicy((CatchUpPolicy)policy, window);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = "Missed schedule handling updated";
+        }
+        else {
+            message = "Invalid values. Window must be 1-1440 minutes.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
+void WebServer::handleSetAdaptive() {
+    bool success = false;
+    String message = "Failed to update adaptive duration settings";
+    if (server.hasArg("enabled") && server.hasArg("minDuration") && server.hasArg("maxSlope") && server.hasArg("minDrop")) {
+        bool enabled = server.arg("enabled") == "1";
+        int minDuration = server.arg("minDuration").toInt();
+        float maxSlope = server.arg("maxSlope").toFloat();
+        int minDrop = server.arg("minDrop").toInt();
+        if (minDuration >= 3 && minDuration <= 300 && maxSlope >= 0.01f && maxSlope <= 1.0f && minDrop >= 0 && minDrop <= 90) {
+            settings.setAdaptiveBackflush(enabled);
+            settings.setAdaptiveMinDuration(minDuration);
+            settings.setAdaptiveMaxSlope(maxSlope);
+            settings.setAdaptiveMinDrop(minDrop);
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = enabled ? String("Adaptive duration enabled") : String("Adaptive duration disabled");
+        }
+        else {
+            message = "Invalid values. Minimum must be 3-300 seconds, slope 0.01-1 bar/min and drop 0-90%.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
+void WebServer::handleSetGuard() {
+    bool success = false;
+    String message = "Failed to update backflush guard settings";
+    if (server.hasArg("hysteresis") && server.hasArg("lockout") && server.hasArg("maxPerDay")) {
+        float hysteresis = server.arg("hysteresis").toFloat();
+        int lockout = server.arg("lockout").toInt();
+        int maxPerDay = server.arg("maxPerDay").toInt();
+        if (hysteresis >= 0.0f && hysteresis <= 1.0f && lockout >= 0 && lockout <= 1440 && maxPerDay >= 0 && maxPerDay <= 48) {
+            settings.setBackflushHysteresis(hysteresis);
+            settings.setBackflushLockout(lockout);
+            settings.setBackflushMaxPerDay(maxPerDay);
+            if (backflushController) {
+                BackflushGuard guard = backflushController->getGuard();
+                guard.hysteresis = hysteresis;
+                guard.lockoutSeconds = lockout * 60;
+                guard.maxPerDay = maxPerDay;
+                backflushController->configure(guard);
+            }
+            pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
+            success = true;
+            message = "Backflush guard updated";
+        }
+        else {
+            message = "Invalid values. Hysteresis must be 0-1 bar, lockout 0-1440 minutes and limit 0-48 per day.";
+        }
+    }
+    String jsonResponse = "{\"success\":" + String(success ? "true" : "false") + ",\"message\":\"" + message + "\"}";
+    server.send(200, "application/json", jsonResponse);
+}
+
 void WebServer::handleOTAUploadPage() {
     String html = F(R"HTML(
 <!DOCTYPE html>
@@ -2039,6 +3001,166 @@ void WebServer::handleSchedulePage() {
         server.sendContent(html);
     }
 
+    // Add predictive backflush settings with the current forecast
+    html = "<h2>Predictive Backflush</h2>\n<div class='schedule-form'>\n";
+    html += "<p>Backflush during quiet hours when the pressure trend is forecast to reach the threshold within the window.</p>\n";
+    time_t forecastTime;
+    if (pressureLogger.getClogRate().forecastCrossing(backflushThreshold, timeManager.getCurrentGMTTime(), forecastTime)) {
+        time_t localForecast = timeManager.gmtToLocal(forecastTime);
+        char timeStr[30];
+        strftime(timeStr, sizeof(timeStr), "%A, %B %d at %H:%M", gmtime(&localForecast));
+        html += "<p>Threshold forecast: <strong>" + String(timeStr) + "</strong></p>\n";
+    } else {
+        html += "<p>Threshold forecast: <strong>no significant upward trend</strong></p>\n";
+    }
+    time_t predictiveTime;
+    unsigned int predictiveDuration;
+    if (scheduler.getPredictiveBackflush(predictiveTime, predictiveDuration)) {
+        char timeStr[30];
+        strftime(timeStr, sizeof(timeStr), "%A, %B %d at %H:%M", gmtime(&predictiveTime));
+        html += "<p>Planned backflush: <strong>" + String(timeStr) + "</strong> for " + String(predictiveDuration) + " seconds</p>\n";
+    }
+    html += "<div class='form-row'><label for='predictiveWindow'>Window (hours):</label>";
+    html += "<input type='number' id='predictiveWindow' min='0' max='168' value='" + String(scheduler.getPredictiveWindowHours()) + "'>";
+    html += "&nbsp;<small>0 disables predictive backflush</small></div>\n";
+    html += "<div class='form-row'><label>Quiet hours:</label><div class='time-input'>";
+    html += "<input type='number' id='quietStart' min='0' max='23' value='" + String(scheduler.getQuietStartHour()) + "'> to ";
+    html += "<input type='number' id='quietEnd' min='0' max='23' value='" + String(scheduler.getQuietEndHour()) + "'></div></div>\n";
+    html += F(R"HTML(<div class='button-row'><button type='button' class='button button-primary' onclick='savePredictive()'>Save</button></div>
+        <p id='predictiveStatus' style='font-weight: bold;'></p>
+        <script>
+            function savePredictive() {
+                const status = document.getElementById('predictiveStatus');
+                const body = 'predictiveWindow=' + encodeURIComponent(document.getElementById('predictiveWindow').value) +
+                             '&quietStart=' + encodeURIComponent(document.getElementById('quietStart').value) +
+                             '&quietEnd=' + encodeURIComponent(document.getElementById('quietEnd').value);
+                fetch('/setpredictive', {
+                    method: 'POST', headers: { 'Content-Type': 'application/x-www-form-urlencoded' }, body: body
+                })
+                .then(response => response.json())
+                .then(data => {
+                    status.textContent = data.message;
+                    status.style.color = data.success ? '#27ae60' : '#e74c3c';
+                })
+                .catch(error => {
+                    status.textContent = 'Error saving predictive backflush settings: ' + error;
+                    status.style.color = '#e74c3c';
+                });
+            }
+        </script>
+        </div>
+)HTML");
+    server.sendContent(html);
+
+    // Add missed schedule handling
+    static const char* const CATCH_UP_POLICIES[] = {"Run once", "Skip", "Run once if recent"};
+    html = "<h2>Missed Schedules</h2>\n<div class='schedule-form'>\n";
+    html += "<p>Schedules that could not run at their time (device off, clock corrected, busy) are counted as missed. Missed so far: <strong>" + String(scheduler.getMissedCount()) + "</strong></p>\n";
+    html += "<div class='form-row'><label for='catchUpPolicy'>When missed:</label><select id='catchUpPolicy'>";
+    for (int i = 0; i < 3; i++) {
+        html += "<option value='" + String(i) + "'" + ((int)scheduler.getCatchUpPolicy() == i ? " selected" : "") + ">" + CATCH_UP_POLICIES[i] + "</option>";
+    }
+    html += "</select></div>\n";
+    html += "<div class='form-row'><label for='catchUpWindow'>Recent within (minutes):</label>";
+    html += "<input type='number' id='catchUpWindow' min='1' max='1440' value='" + String(scheduler.getCatchUpWindow()) + "'></div>\n";
+    html += F(R"HTML(<div class='button-row'><button type='button' class='button button-primary' onclick='saveCatchUp()'>Save</button></div>
+        <p id='catchUpStatus' style='font-weight: bold;'></p>
+        <script>
+            function saveCatchUp() {
+                const status = document.getElementById('catchUpStatus');
+                const body = 'policy=' + encodeURIComponent(document.getElementById('catchUpPolicy').value) +
+                             '&window=' + encodeURIComponent(document.getElementById('catchUpWindow').value);
+                fetch('/setcatchup', {
+                    method: 'POST', headers: { 'Content-Type': 'application/x-www-form-urlencoded' }, body: body
+                })
+                .then(response => response.json())
+                .then(data => {
+                    status.textContent = data.message;
+                    status.style.color = data.success ? '#27ae60' : '#e74c3c';
+                })
+                .catch(error => {
+                    status.textContent = 'Error saving missed schedule settings: ' + error;
+                    status.style.color = '#e74c3c';
+                });
+            }
+        </script>
+        </div>
+)HTML");
+    server.sendContent(html);
+
+    // Add adaptive backflush duration settings
+    html = "<h2>Adaptive Duration</h2>\n<div class='schedule-form'>\n";
+    html += "<p>End each backflush once the pressure has stopped falling, instead of always running for the full duration, which then becomes the maximum.</p>\n";
+    html += "<div class='form-row'><label for='adaptiveEnabled'>Enabled:</label>";
+    html += "<input type='checkbox' id='adaptiveEnabled'" + String(settings.getAdaptiveBackflush() ? " checked" : "") + "></div>\n";
+    html += "<div class='form-row'><label for='adaptiveMinDuration'>Minimum (seconds):</label>";
+    html += "<input type='number' id='adaptiveMinDuration' min='3' max='300' value='" + String(settings.getAdaptiveMinDuration()) + "'></div>\n";
+    html += "<div class='form-row'><label for='adaptiveMaxSlope'>Settled below (bar/min):</label>";
+    html += "<input type='number' id='adaptiveMaxSlope' min='0.01' max='1' step='0.01' value='" + String(settings.getAdaptiveMaxSlope(), 2) + "'></div>\n";
+    html += "<div class='form-row'><label for='adaptiveMinDrop'>Drop from peak (%):</label>";
+    html += "<input type='number' id='adaptiveMinDrop' min='0' max='90' value='" + String(settings.getAdaptiveMinDrop()) + "'></div>\n";
+    html += F(R"HTML(<div class='button-row'><button type='button' class='button button-primary' onclick='saveAdaptive()'>Save</button></div>
+        <p id='adaptiveStatus' style='font-weight: bold;'></p>
+        <script>
+            function saveAdaptive() {
+                const status = document.getElementById('adaptiveStatus');
+                const body = 'enabled=' + (document.getElementById('adaptiveEnabled').checked ? '1' : '0') +
+                             '&minDuration=' + encodeURIComponent(document.getElementById('adaptiveMinDuration').value) +
+                             '&maxSlope=' + encodeURIComponent(document.getElementById('adaptiveMaxSlope').value) +
+                             '&minDrop=' + encodeURIComponent(document.getElementById('adaptiveMinDrop').value);
+                fetch('/setadaptive', {
+                    method: 'POST', headers: { 'Content-Type': 'application/x-www-form-urlencoded' }, body: body
+                })
+                .then(response => response.json())
+                .then(data => {
+                    status.textContent = data.message;
+                    status.style.color = data.success ? '#27ae60' : '#e74c3c';
+                })
+                .catch(error => {
+                    status.textContent = 'Error saving adaptive duration settings: ' + error;
+                    status.style.color = '#e74c3c';
+                });
+            }
+        </script>
+        </div>
+)HTML");
+    server.sendContent(html);
+
+    // Add automatic backflush guard settings
+    html = "<h2>Automatic Backflush Guard</h2>\n<div class='schedule-form'>\n";
+    html += "<p>After an automatic backflush the threshold only re-arms once the pressure has dropped below it by the hysteresis and the lockout has passed. Manual and scheduled backflushes are not limited.</p>\n";
+    html += "<div class='form-row'><label for='guardHysteresis'>Hysteresis (bar):</label>";
+    html += "<input type='number' id='guardHysteresis' min='0' max='1' step='0.05' value='" + String(settings.getBackflushHysteresis(), 2) + "'></div>\n";
+    html += "<div class='form-row'><label for='guardLockout'>Lockout (minutes):</label>";
+    html += "<input type='number' id='guardLockout' min='0' max='1440' value='" + String(settings.getBackflushLockout()) + "'></div>\n";
+    html += "<div class='form-row'><label for='guardMaxPerDay'>Max per day (0 = no limit):</label>";
+    html += "<input type='number' id='guardMaxPerDay' min='0' max='48' value='" + String(settings.getBackflushMaxPerDay()) + "'></div>\n";
+    html += F(R"HTML(<div class='button-row'><button type='button' class='button button-primary' onclick='saveGuard()'>Save</button></div>
+        <p id='guardStatus' style='font-weight: bold;'></p>
+        <script>
+            function saveGuard() {
+                const status = document.getElementById('guardStatus');
+                const body = 'hysteresis=' + encodeURIComponent(document.getElementById('guardHysteresis').value) +
+                             '&lockout=' + encodeURIComponent(document.getElementById('guardLockout').value) +
+                             '&maxPerDay=' + encodeURIComponent(document.getElementById('guardMaxPerDay').value);
+                fetch('/setguard', {
+                    method: 'POST', headers: { 'Content-Type': 'application/x-www-form-urlencoded' }, body: body
+                })
+                .then(response => response.json())
+                .then(data => {
+                    status.textContent = data.message;
+                    status.style.color = data.success ? '#27ae60' : '#e74c3c';
+                })
+                .catch(error => {
+                    status.textContent = 'Error saving backflush guard settings: ' + error;
+                    status.style.color = '#e74c3c';
+                });
+            }
+        </script>
+        </div>
+)HTML");
+    server.sendContent(html);
+
     // Add form for creating new schedule
     html = F(R"HTML(
         <h2>Add New Schedule</h2>
@@ -2057,10 +3179,16 @@ void WebServer::handleSchedulePage() {
                         <option value="daily">Daily</option>
                         <option value="weekly">Weekly</option>
                         <option value="monthly">Monthly</option>
+                        <option value="cron">Cron expression</option>
                     </select>
                 </div>
                 
-                <div class="form-row">
+                <div class="form-row hidden" id="expressionRow">
+                    <label for="expression">Expression:</label>
+                    <input type="text" id="expression" name="expression" placeholder="minute hour day month weekday, e.g. 0 6 * * 1-5">
+                </div>
+                
+                <div class="form-row" id="timeRow">
                     <label for="time">Time:</label>
                     <div class="time-input">
                         <input type="number" id="hour" name="hour" min="0" max="23" value="12" required> : 
@@ -2093,6 +3221,20 @@ void WebServer::handleSchedulePage() {
                     <input type="number" id="duration" name="duration" min="5" max="300" value="30" required>
                 </div>
                 
+                <p>Only run if (leave empty for no condition):</p>
+                <div class="form-row">
+                    <label for="minPressure">Pressure at least (bar):</label>
+                    <input type="number" id="minPressure" name="minPressure" min="0" max="10" step="0.01">
+                </div>
+                <div class="form-row">
+                    <label for="minRise">Risen since last backflush by (bar):</label>
+                    <input type="number" id="minRise" name="minRise" min="0" max="10" step="0.01">
+                </div>
+                <div class="form-row">
+                    <label for="minClogRate">Clogging rate at least (bar/day):</label>
+                    <input type="number" id="minClogRate" name="minClogRate" min="0" max="6" step="0.001">
+                </div>
+                
                 <div class="button-row">
                     <button type="submit" class="button button-primary">Save Schedule</button>
                     <button type="button" id="cancelButton" class="button button-secondary hidden">Cancel</button>
@@ -2128,14 +3270,23 @@ void WebServer::handleSchedulePage() {
                 case ScheduleType::MONTHLY:
                     scheduleList += "Monthly";
                     break;
+                case ScheduleType::CRON:
+                    scheduleList += "Cron";
+                    break;
             }
             scheduleList += "</p>";
             
             // Time
-            scheduleList += "<p><strong>Time:</strong> " + 
-                            String(schedule.hour) + ":" + 
-                            (schedule.minute < 10 ? "0" : "") + String(schedule.minute) + 
-                            "</p>";
+            if (schedule.type == ScheduleType::CRON) {
+                char expression[200];
+                formatCronExpression(schedule.mask, expression, sizeof(expression));
+                scheduleList += "<p><strong>Expression:</strong> <code>" + String(expression) + "</code></p>";
+            } else {
+                scheduleList += "<p><strong>Time:</strong> " + 
+                                String(schedule.hour) + ":" + 
+                                (schedule.minute < 10 ? "0" : "") + String(schedule.minute) + 
+                                "</p>";
+            }
             
             // Days
             if (schedule.type == ScheduleType::WEEKLY) {
@@ -2166,9 +3317,39 @@ void WebServer::handleSchedulePage() {
             // Duration
             scheduleList += "<p><strong>Duration:</strong> " + String(schedule.duration) + " seconds</p>";
             
+            // Conditions
+            const ScheduleConditions& conditions = schedule.conditions;
+            if (conditions.minPressure > 0 || conditions.minRise > 0 || conditions.minClogRate > 0) {
+                scheduleList += "<p><strong>Only if:</strong> ";
+                bool first = true;
+                if (conditions.minPressure > 0) {
+                    scheduleList += "pressure &ge; " + String(conditions.minPressure, 2) + " bar";
+                    first = false;
+                }
+                if (conditions.minRise > 0) {
+                    if (!first) scheduleList += ", ";
+                    scheduleList += "risen &ge; " + String(conditions.minRise, 2) + " bar";
+                    first = false;
+                }
+                if (conditions.minClogRate > 0) {
+                    if (!first) scheduleList += ", ";
+                    scheduleList += "clogging &ge; " + String(conditions.minClogRate, 3) + " bar/day";
+                }
+                scheduleList += "</p>";
+            }
+            
             // Status
             scheduleList += "<p><strong>Status:</strong> " + String(schedule.enabled ? "Enabled" : "Disabled") + "</p>";
             
+            // Run history
+            ScheduleRunState runState = scheduler.getRunState(i);
+            if (runState.missed > 0) {
+                scheduleList += "<p><strong>Missed:</strong> " + String(runState.missed) + " (" + String(runState.caughtUp) + " run late)</p>";
+            }
+            if (runState.skipped > 0) {
+                scheduleList += "<p><strong>Skipped:</strong> " + String(runState.skipped) + " (condition not met)</p>";
+            }
+            
             // Edit/Delete buttons
             scheduleList += "<div class='button-row'>";
             scheduleList += "<button class='button button-secondary' onclick='editSchedule(" + String(i) + ")'>Edit</button>";
@@ -2206,9 +3387,15 @@ void WebServer::handleSchedulePage() {
                 const scheduleType = document.getElementById('scheduleType').value;
                 const weekdaysRow = document.getElementById('weekdaysRow');
                 const monthdaysRow = document.getElementById('monthdaysRow');
+                const isCron = scheduleType === 'cron';
                 
                 weekdaysRow.classList.add('hidden');
                 monthdaysRow.classList.add('hidden');
+                document.getElementById('expressionRow').classList.toggle('hidden', !isCron);
+                document.getElementById('timeRow').classList.toggle('hidden', isCron);
+                document.getElementById('hour').required = !isCron;
+                document.getElementById('minute').required = !isCron;
+                document.getElementById('expression').required = isCron;
                 
                 if (scheduleType === 'weekly') {
                     weekdaysRow.classList.remove('hidden');
@@ -2235,7 +3422,11 @@ void WebServer::handleSchedulePage() {
                         document.getElementById('scheduleType').value = schedule.type;
                         document.getElementById('hour').value = schedule.hour;
                         document.getElementById('minute').value = schedule.minute;
+                        document.getElementById('expression').value = schedule.expression;
                         document.getElementById('duration').value = schedule.duration;
+                        document.getElementById('minPressure').value = schedule.minPressure || '';
+                        document.getElementById('minRise').value = schedule.minRise || '';
+                        document.getElementById('minClogRate').value = schedule.minClogRate || '';
                         
                         // Update days checkboxes
                         if (schedule.type === 'weekly') {
@@ -2278,12 +3469,7 @@ void WebServer::handleSchedulePage() {
     server.sendContent("");
 }
 
-void WebServer::handleScheduleUpdate() {
-    int id = server.arg("id").toInt();
-    bool isNew = (id == -1);
-    
-    // Create schedule object from form data
-    BackflushSchedule schedule;
+bool WebServer::parseScheduleForm(BackflushSchedule& schedule, String& error) {
     schedule.enabled = server.hasArg("enabled");
     
     // Parse schedule type
@@ -2294,6 +3480,19 @@ void WebServer::handleScheduleUpdate() {
         schedule.type = ScheduleType::WEEKLY;
     } else if (typeStr == "monthly") {
         schedule.type = ScheduleType::MONTHLY;
+    } else if (typeStr == "cron") {
+        schedule.type = ScheduleType::CRON;
+        if (!parseCronExpression(server.arg("expression").c_str(), schedule.mask)) {
+            error = "Invalid cron expression";
+            return false;
+        }
+        // Valid fields can still describe a date that never comes, such as 31 February
+        BackflushSchedule probe = schedule;
+        probe.enabled = true;
+        if (nextScheduleTime(probe, timeManager.getCurrentTime()) == 0) {
+            error = "Cron expression never fires";
+            return false;
+        }
     }
     
     // Parse time
@@ -2327,11 +3526,31 @@ void WebServer::handleScheduleUpdate() {
     // Parse duration
     schedule.duration = constrain(server.arg("duration").toInt(), 5, 300);
     
+    // Parse conditions, empty or 0 for none
+    schedule.conditions.minPressure = constrain(server.arg("minPressure").toFloat(), 0.0f, 10.0f);
+    schedule.conditions.minRise = constrain(server.arg("minRise").toFloat(), 0.0f, 10.0f);
+    schedule.conditions.minClogRate = constrain(server.arg("minClogRate").toFloat(), 0.0f, 6.0f);
+    return true;
+}
+
+void WebServer::handleScheduleUpdate() {
+    int id = server.arg("id").toInt();
+    bool isNew = (id == -1);
+    
+    // Create schedule object from form data
+    BackflushSchedule schedule;
+    String error;
+    if (!parseScheduleForm(schedule, error)) {
+        server.send(400, "text/plain", error);
+        return;
+    }
+    
     if (isNew) {
         scheduler.addSchedule(schedule);
     } else {
         scheduler.updateSchedule(id, schedule);
     }
+    pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
     
     // Redirect back to schedule page
     server.sendHeader("Location", "/schedule");
@@ -2341,6 +3560,7 @@ void WebServer::handleScheduleUpdate() {
 void WebServer::handleScheduleDelete() {
     int id = server.arg("id").toInt();
     scheduler.deleteSchedule(id);
+    pressureLogger.addMarker(MARKER_SETTINGS_CHANGE);
     
     // Redirect back to schedule page
     server.sendHeader("Location", "/schedule");
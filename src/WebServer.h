@@ -12,6 +12,10 @@
 #include "PressureLogger.h"
 #include "BackflushScheduler.h"
 #include "Display.h"
+#include "ChangeDetector.h"
+#include "BackflushController.h"
+#include "TaskScheduler.h"
+#include "PowerManager.h"
 
 // External pin definitions from main.cpp
 extern const int RELAY_PIN;
@@ -51,6 +55,10 @@ private:
  
     // Display reference for OTA updates
     Display* display;
+    ChangeDetector* changeDetector;
+    BackflushController* backflushController;
+    TaskScheduler* taskScheduler;
+    PowerManager* powerManager;
 
     // Helper function to draw arc segments for the gauge
     String drawArcSegment(float cx, float cy, float radius, float startAngle, float endAngle, String color, float opacity);
@@ -75,12 +83,31 @@ private:
     void handleOTAUploadPage();
     void handleOTAUpload();
     void handleSchedulePage();
+    bool parseScheduleForm(BackflushSchedule& schedule, String& error);
     void handleScheduleUpdate();
     void handleScheduleDelete();
     void handleResetCalibration();
     void handlePressureReadingsApi();
+    void handlePressureQueryApi();
+    void handlePressureExport();
+    void handlePressureMarkersApi();
+    void handlePressureQuantilesApi();
+    void handlePumpRuntimeApi();
+    void handleBackflushStatsApi();
     void handleSetPressureThreshold();
     void handleSetPressureMaxInterval();
+    void handleSetHeapReserve();
+    void handleSetDetector();
+    void handleSetAdaptive();
+    void handleSetCatchUp();
+    void handleSchedulePreviewApi();
+    void handleSetGuard();
+    void handleSetPredictive();
+    void handleTaskStatsApi();
+    void handleSetPowerSave();
+#ifdef ENABLE_PROFILER
+    void handleProfileApi();
+#endif
 
 public:
     WebServer(float& pressure, int& rawADC, float& voltage, float& threshold, unsigned int& duration, 
@@ -89,6 +116,10 @@ public:
              Settings& settings, PressureLogger& pressureLog, BackflushScheduler& sched);
     
     void setDisplay(Display* displayPtr) { display = displayPtr; }
+    void setChangeDetector(ChangeDetector* detector) { changeDetector = detector; }
+    void setBackflushController(BackflushController* controller) { backflushController = controller; }
+    void setTaskScheduler(TaskScheduler* scheduler) { taskScheduler = scheduler; }
+    void setPowerManager(PowerManager* manager) { powerManager = manager; }
     void begin();
     void handleClient();
     bool isOTAEnabled() const { return otaEnabled; }
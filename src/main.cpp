@@ -12,6 +12,13 @@
 #include "BackflushLogger.h"
 #include "PressureLogger.h"
 #include "BackflushScheduler.h"
+#include "ChangeDetector.h"
+#include "BackflushMonitor.h"
+#include "BackflushController.h"
+#include "TaskScheduler.h"
+#include "PowerManager.h"
+#include "Profiler.h"
+#include "RelayTimer.h"
 
 #ifdef GIT_SHA_STR
   #pragma message("GIT_SHA_STR is defined as: " GIT_SHA_STR)
@@ -71,6 +78,7 @@ Settings* settings;
 BackflushLogger* backflushLogger;
 PressureLogger* pressureLogger;
 BackflushScheduler* scheduler;
+ChangeDetector* changeDetector;
 
 // Variables
 float currentPressure = 0.0;
@@ -81,7 +89,6 @@ unsigned long lastPressureUpdate = 0;  // Last pressure update time (ms)
 const unsigned long PRESSURE_UPDATE_INTERVAL = 100; // Update interval (ms)
 const float HALF_LIFE = 1.0f;  // Half-life for EMA in seconds
 float alpha = 0.0f;           // EMA alpha coefficient (will be calculated)
-unsigned long lastReadTime = 0;
 const unsigned long readInterval = 1000;  // Read pressure every 1 second
 
 // Backflush configuration
@@ -93,13 +100,49 @@ float backflushTriggerPressure = 0.0;  // Store the pressure that triggered the
 bool backflushConfigChanged = false;
 String currentBackflushType = "Auto";  // Track whether the current backflush is Auto or Manual
 bool needManualBackflush = false;
+BackflushMonitor backflushMonitor;    // Ends the backflush early in adaptive mode
+const uint16_t ADAPTIVE_HOLD_SECONDS = 5; // Pressure must stay settled this long
+BackflushController backflushController; // Hysteresis, lockout and daily limit for automatic backflushes
+const uint32_t BACKFLUSH_SETTLE_SECONDS = 60; // Pressure ignored this long after a backflush
+
+// Periodic work, run by the task scheduler (ms)
+TaskScheduler taskScheduler(micros);
+const uint32_t BACKFLUSH_CHECK_INTERVAL = 100;       // While a backflush runs or is requested
+const uint32_t BACKFLUSH_IDLE_CHECK_INTERVAL = 1000; // Otherwise, at the pressure read cadence
+const uint32_t WEB_POLL_INTERVAL = 20;         // While a client is active
+const uint32_t WEB_IDLE_POLL_INTERVAL = 250;   // Otherwise, lets the device sleep between polls
+const uint32_t POWER_UPDATE_INTERVAL = 1000;
+const uint32_t SCHEDULE_CHECK_INTERVAL = 30000;
+const uint32_t DISPLAY_REFRESH_INTERVAL = 60000;
+const uint32_t TIME_UPDATE_INTERVAL = 1000;
+const uint32_t SETTINGS_SAVE_INTERVAL = 1000;
+int webTask = -1;
+int backflushTask = -1;
+
+// WiFi sleep between tasks
+PowerManager powerManager;
+
+// A sync reported before the pressure logger exists, marked once it does
+bool timeSyncPending = false;
+int32_t pendingTimeStep = 0;
 
 // Function prototypes
 float readPressure();
 void setupWiFi();
 void resetSettings();
 void handleBackflush();
+void setupTasks();
+void checkSchedules();
+void readSensors();
+void updatePowerMode();
+void startBackflush();
+void finishBackflush(unsigned long elapsedTime, bool recovered);
+void configureBackflushGuard();
+void updatePredictiveBackflush();
+FilterState getFilterState();
 void saveBackflushConfig();
+void handlePressureEvent(ChangeDetector::Event event);
+void handleTimeSync(int32_t step);
 
 void setup() {
   Serial.begin(115200);
@@ -116,6 +159,7 @@ void setup() {
   pinMode(LED_PIN, OUTPUT);
   digitalWrite(LED_PIN, HIGH);  // LED is off when HIGH on NodeMCU (inverse logic)
   Serial.println("LED initialized");
+  RelayTimer::begin(RELAY_PIN, LED_PIN);
   
   // Initialize settings
   settings = new Settings();
@@ -181,7 +225,9 @@ void setup() {
   setupWiFi();
   
   // Initialize time manager after WiFi is connected
+  // The callback is registered first, as begin() may already sync
   timeManager = new TimeManager();
+  timeManager->setTimeSyncCallback(handleTimeSync);
   timeManager->begin();
   
   displayManager->setTimeManager(timeManager);
@@ -194,10 +240,28 @@ void setup() {
   // Initialize pressure logger
   pressureLogger = new PressureLogger(*timeManager, *settings);
   pressureLogger->begin();
+  pressureLogger->addMarker(MARKER_REBOOT, ESP.getResetInfoPtr()->reason);
+  if (timeSyncPending) {
+    handleTimeSync(pendingTimeStep);
+  }
   
   // Initialize backflush scheduler
   scheduler = new BackflushScheduler(*timeManager);
   scheduler->begin();
+  scheduler->setQuietHours(settings->getQuietStartHour(), settings->getQuietEndHour());
+  scheduler->setPredictiveWindow(settings->getPredictiveWindowHours());
+  scheduler->setCatchUpPolicy((CatchUpPolicy)settings->getCatchUpPolicy(), settings->getCatchUpWindow());
+  scheduler->setSkipCallback([](size_t, const char*) {
+    backflushLogger->logSkipped(currentPressure); // Keep skipped runs in the event log
+  });
+  
+  // Initialize pump start/stop and abnormal rise detection
+  changeDetector = new ChangeDetector();
+  changeDetector->configure(settings->getPumpStepThreshold(), settings->getRiseAlarmThreshold());
+  changeDetector->setPumpOnThreshold(settings->getPumpOnThreshold());
+  
+  // Initialize the automatic backflush guard
+  configureBackflushGuard();
   
   // Initialize web server
   webServer = new WebServer(currentPressure, rawADCValue, sensorVoltage, backflushThreshold, backflushDuration, 
@@ -208,94 +272,144 @@ void setup() {
   // Connect components for bidirectional communication
   displayManager->setWebServer(webServer);
   displayManager->setScheduler(scheduler);
+  displayManager->setPressureLogger(pressureLogger);
   webServer->setDisplay(displayManager);
+  webServer->setChangeDetector(changeDetector);
+  webServer->setBackflushController(&backflushController);
+  webServer->setTaskScheduler(&taskScheduler);
+  webServer->setPowerManager(&powerManager);
+  powerManager.setMaxMode((PowerManager::SleepMode)settings->getPowerSave());
   
   delay(2000);  // Display startup message for 2 seconds
+  
+  setupTasks();
 }
 
 void loop() {
-  // Update time from NTP server
-  timeManager->update();
-  
-  // Handle WiFi and server
-  webServer->handleClient();
-  
-  // Check for scheduled backflush if time is initialized
-  static unsigned long lastScheduleCheck = 0;
-  static unsigned long lastDisplayUpdate = 0;
-  
-  if (timeManager->isTimeInitialized()) {
-    unsigned long currentMillis = millis();
-    
-    // Check for scheduled backflush every 30 seconds
-    if (currentMillis - lastScheduleCheck >= 30000) {
-      lastScheduleCheck = currentMillis;
-      
-      // Check if a scheduled backflush should be triggered
-      unsigned int scheduledDuration = 0;
-      if (!backflushActive && scheduler->checkSchedules(timeManager->getCurrentTime(), scheduledDuration)) {
-        // Set the backflush duration to the scheduled duration
-        backflushDuration = scheduledDuration;
-        
-        // Set flag for scheduled backflush
-        currentBackflushType = "Scheduled";
-        needManualBackflush = true; // Use the manual backflush flag to trigger it
-      }
-    }
-    
-    // Update the next scheduled backflush display every minute
-    if (displayManager && displayManager->isDisplayAvailable() && 
-        (currentMillis - lastDisplayUpdate >= 60000 || lastDisplayUpdate == 0)) {
-      lastDisplayUpdate = currentMillis;
+  // Run the tasks that are due, then sleep until the next one. The time spent
+  // running tasks is measured as a proxy for the average current.
+  unsigned long cycleStart = micros();
+  taskScheduler.run(millis());
+  unsigned long activeTime = micros() - cycleStart;
+  delay(taskScheduler.getIdleTime(millis()));
+  powerManager.recordCycle(millis(), activeTime, micros() - cycleStart);
+}
+
+void setupTasks() {
+  uint32_t now = millis();
+  backflushTask = taskScheduler.addTask("backflush", BACKFLUSH_IDLE_CHECK_INTERVAL, handleBackflush, now, TaskScheduler::PRIORITY_HIGH);
+  webTask = taskScheduler.addTask("web", WEB_POLL_INTERVAL, []() { webServer->handleClient(); }, now);
+  taskScheduler.addTask("pressure", readInterval, readSensors, now);
+  taskScheduler.addTask("schedules", SCHEDULE_CHECK_INTERVAL, checkSchedules, now);
+  taskScheduler.addTask("display", DISPLAY_REFRESH_INTERVAL, []() {
+    // Keeps the next scheduled backflush on the display current
+    if (displayManager && displayManager->isDisplayAvailable() && timeManager->isTimeInitialized()) {
       displayManager->updateDisplay();
     }
+  }, now, TaskScheduler::PRIORITY_LOW);
+  taskScheduler.addTask("time", TIME_UPDATE_INTERVAL, []() { timeManager->update(); }, now, TaskScheduler::PRIORITY_LOW);
+  taskScheduler.addTask("settings", SETTINGS_SAVE_INTERVAL, saveBackflushConfig, now, TaskScheduler::PRIORITY_LOW);
+  taskScheduler.addTask("power", POWER_UPDATE_INTERVAL, updatePowerMode, now, TaskScheduler::PRIORITY_LOW);
+}
+
+void updatePowerMode() {
+  uint32_t now = millis();
+  PowerManager::SleepMode previous = powerManager.getMode();
+  PowerManager::SleepMode mode = powerManager.selectMode(now, backflushActive, webServer->isOTAEnabled());
+  if (mode != previous) {
+    // In light sleep the SDK suspends the CPU during delay() and keeps the station
+    // associated, waking on the next timer and on DTIM beacons for incoming TCP
+    static const WiFiSleepType_t SLEEP_TYPES[] = {WIFI_NONE_SLEEP, WIFI_MODEM_SLEEP, WIFI_LIGHT_SLEEP};
+    WiFi.setSleepMode(SLEEP_TYPES[mode]);
+    Serial.print("WiFi sleep mode: ");
+    Serial.println(PowerManager::modeName(mode));
   }
   
-  // Read pressure at regular intervals
-  unsigned long currentTime = millis();
-  if (currentTime - lastReadTime >= readInterval) {
-    bool resetButtonPressed = digitalRead(RESET_BUTTON_PIN) == LOW;
-    currentPressure = readPressure();
-    if (!resetButtonPressed) displayManager->updateDisplay();
-    lastReadTime = currentTime;
+  // Poll for requests quickly only while a client is active
+  uint32_t poll = powerManager.isWebActive(now) ? WEB_POLL_INTERVAL : WEB_IDLE_POLL_INTERVAL;
+  if (taskScheduler.getStats(webTask).period != poll) {
+    taskScheduler.setPeriod(webTask, poll, now);
+  }
+}
+
+void checkSchedules() {
+  if (!timeManager->isTimeInitialized() || backflushActive) {
+    return;
+  }
+  
+  // Check if a scheduled backflush should be triggered
+  unsigned int scheduledDuration = 0;
+  if (scheduler->checkSchedules(timeManager->getCurrentTime(), getFilterState(), scheduledDuration)) {
+    // Set the backflush duration to the scheduled duration
+    backflushDuration = scheduledDuration;
     
-    // Record pressure reading if time is initialized
-    if (timeManager->isTimeInitialized()) {
-      pressureLogger->addReading(currentPressure);
-      pressureLogger->update(); // Check if we need to save readings
-    }
+    // Set flag for scheduled backflush
+    currentBackflushType = "Scheduled";
+    needManualBackflush = true; // Use the manual backflush flag to trigger it
+  } else if (scheduler->checkPredictiveBackflush(timeManager->getCurrentTime(), scheduledDuration)) {
+    // Backflush ahead of the forecast threshold crossing, during quiet hours
+    backflushDuration = scheduledDuration;
+    currentBackflushType = "Predictive";
+    needManualBackflush = true;
+  }
+}
 
-    // Handle reset button - power cycle if held for 3 seconds
-    static unsigned long reset_button_pressed_time = 0;
-    if (resetButtonPressed) {
-      if (reset_button_pressed_time == 0) {
-        reset_button_pressed_time = millis();
-      }
-      int remainingSeconds = 3 - ((millis() - reset_button_pressed_time) / 1000);
-      displayManager->showResetCountdown("Hold to restart", remainingSeconds);
-      
-      if (millis() - reset_button_pressed_time >= 3000) {
-        ESP.restart();
-      }
-    } else {
-      reset_button_pressed_time = 0;
-    }
+void readSensors() {
+  unsigned long currentTime = millis();
+  bool resetButtonPressed = digitalRead(RESET_BUTTON_PIN) == LOW;
+  currentPressure = readPressure();
+  if (!resetButtonPressed) displayManager->updateDisplay();
+  
+  // Follow the pressure during an adaptive backflush
+  if (backflushActive && backflushMonitor.isActive()) {
+    backflushMonitor.update((currentTime - backflushStartTime) / 1000.0f, currentPressure);
   }
   
-  // Handle backflush control
-  handleBackflush();
+  // Look for pump start/stop and abnormal rises (a backflush itself would look like a step)
+  if (!backflushActive) {
+    ChangeDetector::Event event = changeDetector->update(currentPressure);
+    if (event != ChangeDetector::NONE) {
+      handlePressureEvent(event);
+    }
+  }
   
+  // Record pressure reading if time is initialized
+  if (timeManager->isTimeInitialized()) {
+    pressureLogger->addReading(currentPressure);
+    pressureLogger->update(); // Check if we need to save readings
+    backflushLogger->update(currentPressure); // Recovery after the last backflush
+    updatePredictiveBackflush();
+  }
+
+  // Handle reset button - power cycle if held for 3 seconds
+  static unsigned long reset_button_pressed_time = 0;
+  if (resetButtonPressed) {
+    if (reset_button_pressed_time == 0) {
+      reset_button_pressed_time = millis();
+    }
+    int remainingSeconds = 3 - ((millis() - reset_button_pressed_time) / 1000);
+    displayManager->showResetCountdown("Hold to restart", remainingSeconds);
+    
+    if (millis() - reset_button_pressed_time >= 3000) {
+      ESP.restart();
+    }
+  } else {
+    reset_button_pressed_time = 0;
+  }
+}
+
+void saveBackflushConfig() {
   // Save backflush config if changed
   if (backflushConfigChanged) {
+    PROFILE_STAGE(PROFILE_SETTINGS);
     settings->setBackflushThreshold(backflushThreshold);
     settings->setBackflushDuration(backflushDuration);
     backflushConfigChanged = false;
   }
-  
-  delay(50);
 }
 
 float readPressure() {
+    PROFILE_STAGE(PROFILE_READ_PRESSURE);
     static bool firstReading = true;
     static unsigned long lastReadTime = 0;
     static float smoothedPressure = 0.0;
@@ -420,74 +534,182 @@ void setupWiFi() {
   displayManager->showWiFiConnected(WiFi.SSID(), WiFi.localIP());
 }
 
+void startBackflush() {
+  backflushActive = true;
+  backflushStartTime = millis();
+  backflushTriggerPressure = currentPressure; // Store the pressure that triggered the backflush
+  
+  // Requested flushes are Manual unless the scheduler set the type
+  if (!backflushController.wasRequested()) {
+    currentBackflushType = "Auto";
+  } else if (currentBackflushType != "Scheduled" && currentBackflushType != "Predictive") {
+    currentBackflushType = "Manual";
+  }
+  
+  // Out of light sleep first, which suspends the CPU and would delay the deadline
+  updatePowerMode();
+  
+  // Relay and LED on; the timer turns them off after the duration even if the loop is held up
+  RelayTimer::start(backflushDuration * 1000UL);
+  
+  // In adaptive mode the duration is only the upper bound
+  if (settings->getAdaptiveBackflush()) {
+    BackflushCriteria criteria;
+    criteria.minSeconds = min(settings->getAdaptiveMinDuration(), backflushDuration);
+    criteria.maxSeconds = backflushDuration;
+    criteria.maxSlope = settings->getAdaptiveMaxSlope();
+    criteria.minDropPercent = settings->getAdaptiveMinDrop();
+    criteria.holdSeconds = ADAPTIVE_HOLD_SECONDS;
+    backflushMonitor.begin(criteria);
+  } else {
+    backflushMonitor.cancel();
+  }
+  
+  // Log the backflush event
+  backflushLogger->logEvent(backflushTriggerPressure, backflushDuration, BackflushLogger::parseType(currentBackflushType));
+  pressureLogger->addReading(backflushTriggerPressure, true);
+  pressureLogger->addMarker(MARKER_BACKFLUSH_START, encodePressure(backflushTriggerPressure));
+  
+  // Log to serial
+  Serial.println("\n=== BACKFLUSH STARTED ===");
+  Serial.print("Type: ");
+  Serial.println(currentBackflushType);
+  Serial.print("Trigger Pressure: ");
+  Serial.print(backflushTriggerPressure, 1);
+  Serial.println(" bar");
+  Serial.print("Duration: ");
+  Serial.print(backflushDuration);
+  Serial.println(" seconds");
+  
+  // Display message on OLED if available
+  if (displayManager && displayManager->isDisplayAvailable()) {
+    String message = "Type: " + String(currentBackflushType) + 
+                   "\nDuration: " + String(backflushDuration) + "s";
+    displayManager->showMessage("Backflush Started", message);
+  }
+  
+  if (currentBackflushType == "Scheduled" || currentBackflushType == "Predictive") {
+    // Reset to default for next time
+    currentBackflushType = "Auto";
+  }
+}
+
+void finishBackflush(unsigned long elapsedTime, bool recovered) {
+  backflushActive = false;
+  RelayTimer::stop(recovered);  // Relay and LED off, if the timer has not already
+  Serial.println("Backflush completed");
+  if (recovered) {
+    Serial.print("Pressure settled after ");
+    Serial.print(elapsedTime);
+    Serial.println(" seconds, stopped early");
+  }
+  backflushMonitor.cancel();
+  
+  // Start a fresh clogging rate fit for the cleaned filter
+  backflushLogger->endEvent(elapsedTime);
+  pressureLogger->addMarker(MARKER_BACKFLUSH_END, elapsedTime);
+  pressureLogger->markBackflush();
+  
+  // No longer logging backflush end events as per user request
+  Serial.print("Backflush completed with trigger pressure: ");
+  Serial.print(backflushTriggerPressure, 1);
+  Serial.println(" bar");
+}
+
 void handleBackflush() {
-  // Check if backflush should be activated
-  if (!backflushActive && (currentPressure >= backflushThreshold || needManualBackflush)) {
-    // Start backflush
-    backflushActive = true;
-    backflushStartTime = millis();
-    backflushTriggerPressure = currentPressure; // Store the pressure that triggered the backflush
-    
-    // If needManualBackflush is true but currentBackflushType is not set, default to "Manual"
-    if (needManualBackflush && currentBackflushType != "Scheduled") {
-      currentBackflushType = "Manual";
-    }
-    
-    digitalWrite(RELAY_PIN, HIGH);  // Activate relay
-    digitalWrite(LED_PIN, LOW);    // Turn LED ON (inverse logic on NodeMCU)
-    
-    // Log the backflush event
-    backflushLogger->logEvent(backflushTriggerPressure, backflushDuration, currentBackflushType);
-    pressureLogger->addReading(backflushTriggerPressure, true);
-    
-    // Log to serial
-    Serial.println("\n=== BACKFLUSH STARTED ===");
-    Serial.print("Type: ");
-    Serial.println(currentBackflushType);
-    Serial.print("Trigger Pressure: ");
-    Serial.print(backflushTriggerPressure, 1);
-    Serial.println(" bar");
-    Serial.print("Duration: ");
-    Serial.print(backflushDuration);
-    Serial.println(" seconds");
-    
-    // Display message on OLED if available
-    if (displayManager && displayManager->isDisplayAvailable()) {
-      String message = "Type: " + String(currentBackflushType) + 
-                     "\nDuration: " + String(backflushDuration) + "s";
-      displayManager->showMessage("Backflush Started", message);
+  PROFILE_STAGE(PROFILE_BACKFLUSH);
+  unsigned long now = millis();
+  RelayTimer::update();
+  
+  if (backflushController.getState() == BackflushController::FLUSHING) {
+    if (!backflushActive) {
+      // Stopped from the web page, which has already logged the end
+      backflushController.stop(now);
+      backflushMonitor.cancel();
+    } else if (backflushMonitor.getStopReason() == BackflushMonitor::RECOVERED) {
+      backflushController.stop(now);
+      finishBackflush((now - backflushStartTime) / 1000, true);
     }
-    
-    // Reset the flags
+  }
+  
+  // Manual, scheduled and predictive backflushes bypass the lockout and daily limit
+  if (needManualBackflush) {
+    backflushController.request();
     needManualBackflush = false;
-    if (currentBackflushType == "Scheduled") {
-      // Reset to default for next time
-      currentBackflushType = "Auto";
-    }
   }
   
-  // Check if backflush should be stopped
-  if (backflushActive) {
-    unsigned long elapsedTime = (millis() - backflushStartTime) / 1000;  // Convert to seconds
-    if (elapsedTime >= backflushDuration) {
-      // Stop backflush
-      backflushActive = false;
-      digitalWrite(RELAY_PIN, LOW);  // Deactivate relay
-      digitalWrite(LED_PIN, HIGH);   // Turn LED OFF (inverse logic on NodeMCU)
-      Serial.println("Backflush completed");
-      
-      // No longer logging backflush end events as per user request
-      Serial.print("Backflush completed with trigger pressure: ");
-      Serial.print(backflushTriggerPressure, 1);
-      Serial.println(" bar");
-    }
+  uint32_t day = timeManager->isTimeInitialized() ? BackflushController::dayOf(timeManager->getCurrentTime()) : 0;
+  backflushController.setThreshold(backflushThreshold);
+  switch (backflushController.update(now, currentPressure, day, backflushDuration)) {
+    case BackflushController::START:
+      startBackflush();
+      break;
+    case BackflushController::STOP:
+      finishBackflush((now - backflushStartTime) / 1000, false);
+      break;
+    case BackflushController::NONE:
+      break;
   }
+  
+  // The relay timer enforces the deadline, so only a running or pending flush
+  // needs the fast checks; otherwise the CPU can sleep between pressure reads
+  bool busy = backflushActive || needManualBackflush || backflushController.getState() == BackflushController::FLUSHING;
+  uint32_t period = busy ? BACKFLUSH_CHECK_INTERVAL : BACKFLUSH_IDLE_CHECK_INTERVAL;
+  if (taskScheduler.getStats(backflushTask).period != period) {
+    taskScheduler.setPeriod(backflushTask, period, now);
+  }
+}
+
+void configureBackflushGuard() {
+  BackflushGuard guard;
+  guard.threshold = backflushThreshold;
+  guard.hysteresis = settings->getBackflushHysteresis();
+  guard.settleSeconds = BACKFLUSH_SETTLE_SECONDS;
+  guard.lockoutSeconds = settings->getBackflushLockout() * 60;
+  guard.maxPerDay = settings->getBackflushMaxPerDay();
+  backflushController.configure(guard);
 }
 
 
 
 
 
+void updatePredictiveBackflush() {
+  if (scheduler->getPredictiveWindowHours() == 0 || backflushActive) {
+    return;
+  }
+  
+  // Forecast when the pressure trend reaches the backflush threshold
+  time_t now = timeManager->getCurrentGMTTime();
+  time_t eta;
+  if (!pressureLogger->getClogRate().forecastCrossing(backflushThreshold, now, eta) ||
+      eta > now + (time_t)scheduler->getPredictiveWindowHours() * 3600) {
+    scheduler->cancelPredictiveBackflush();
+    return;
+  }
+  
+  // Pre-schedule the backflush at the next quiet time if that comes before the crossing
+  time_t quietTime = scheduler->getNextQuietTime(timeManager->gmtToLocal(now));
+  if (quietTime < timeManager->gmtToLocal(eta)) {
+    scheduler->setPredictiveBackflush(quietTime, backflushDuration);
+  } else {
+    scheduler->cancelPredictiveBackflush();
+  }
+}
+
+FilterState getFilterState() {
+  // Conditions of scheduled backflushes are checked against the running statistics
+  FilterState filter;
+  filter.pressure = currentPressure;
+  
+  float recovered;
+  filter.rise = backflushLogger->getLastRecoveredPressure(recovered) ? currentPressure - recovered : NAN;
+  
+  float slope, stdError;
+  filter.clogRate = pressureLogger->getClogRate().getSlope(slope, stdError) ? slope : NAN;
+  return filter;
+}
+
 void resetSettings() {
   // Display reset message
   displayManager->showResetMessage();
@@ -536,3 +758,37 @@ void resetSettings() {
   // Restart the ESP
   ESP.restart();
 }
+
+void handlePressureEvent(ChangeDetector::Event event) {
+  Serial.print(ChangeDetector::eventName(event));
+  Serial.print(" at ");
+  Serial.print(currentPressure, 2);
+  Serial.println(" bar");
+  
+  switch (event) {
+    case ChangeDetector::PUMP_STARTED:
+      pressureLogger->addMarker(MARKER_PUMP_START, encodePressure(currentPressure));
+      break;
+    case ChangeDetector::PUMP_STOPPED:
+      pressureLogger->addMarker(MARKER_PUMP_STOP, encodePressure(currentPressure));
+      break;
+    case ChangeDetector::ABNORMAL_RISE:
+      pressureLogger->addMarker(MARKER_ABNORMAL_RISE, encodePressure(currentPressure));
+      break;
+    default:
+      break;
+  }
+}
+
+void handleTimeSync(int32_t step) {
+  if (!pressureLogger) {
+    timeSyncPending = true;
+    pendingTimeStep = step;
+    return;
+  }
+  timeSyncPending = false;
+  pressureLogger->addMarker(MARKER_TIME_SYNC, step);
+  if (scheduler) {
+    scheduler->invalidateNextTimes(); // Schedule fire times follow the clock
+  }
+}
@@ -0,0 +1,118 @@
+// Feed synthetic exponential recoveries, one sample a second as in the firmware,
+// to the backflush recovery analysis and check the recovered pressure and the
+// time constant it reports with the area method, and the cases without a result.
+//
+//   backflush_analyzer_test
+//
+// Prints each failed check and exits with status 1 if there was one.
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o backflush_analyzer_test backflush_analyzer_test.cpp ../../src/BackflushAnalyzer.cpp
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "BackflushAnalyzer.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+struct Result {
+    bool finished;
+    uint32_t seconds;        // Until the analysis finished
+    bool valid;
+    float recovered;
+    float tau;
+};
+
+// Sample p(t) = final + (start - final) * exp(-t / tau) + wobble * sin(t) every second
+static Result analyze(float start, float final, float tau, float wobble = 0) {
+    BackflushAnalyzer analyzer;
+    uint32_t now = 5000;
+    analyzer.begin(now);
+
+    Result result = {false, 0, false, 0, 0};
+    for (uint32_t t = 0; t <= 600; t++) {
+        float pressure = final + (start - final) * expf(-(float)t / tau) + wobble * sinf((float)t);
+        if (analyzer.update(now + t * 1000, pressure)) {
+            result.finished = true;
+            result.seconds = t;
+            break;
+        }
+    }
+    result.valid = analyzer.getResult(result.recovered, result.tau);
+    return result;
+}
+
+static bool near(float value, float expected, float tolerance) {
+    return fabsf(value - expected) <= tolerance;
+}
+
+static void testRisingRecovery() {
+    // Pressure back up from 0.3 to 1.2 bar with a 10 s time constant
+    Result result = analyze(0.3f, 1.2f, 10);
+    CHECK(result.finished && result.valid);
+    CHECK(near(result.recovered, 1.2f, 0.02f));
+    CHECK(near(result.tau, 10, 1.5f));
+    CHECK(result.seconds < 120);
+}
+
+static void testFallingRecovery() {
+    // Pressure settling down from 1.8 to 1.0 bar with a 30 s time constant. A slow
+    // recovery counts as settled while still a little above its final level, once
+    // it moves less than the band in the settle time, which also shortens tau.
+    Result result = analyze(1.8f, 1.0f, 30);
+    CHECK(result.finished && result.valid);
+    CHECK(result.recovered >= 1.0f && result.recovered <= 1.03f);
+    CHECK(near(result.tau, 30, 4));
+}
+
+static void testPumpNotRunning() {
+    Result result = analyze(0.3f, 0.0f, 5);
+    CHECK(result.finished);
+    CHECK(!result.valid);
+}
+
+static void testNoStep() {
+    // Already settled: no time constant to measure
+    Result result = analyze(1.2f, 1.2f, 10);
+    CHECK(result.finished && result.valid);
+    CHECK(result.tau == 0);
+    CHECK(result.seconds == 20);
+}
+
+static void testNeverSettles() {
+    // Wobbling by more than the settle band, given up after five minutes
+    Result result = analyze(0.3f, 1.2f, 10, 0.05f);
+    CHECK(result.finished);
+    CHECK(result.seconds == 300);
+    CHECK(near(result.recovered, 1.2f, 0.06f));
+}
+
+static void testReduction() {
+    CHECK(near(BackflushAnalyzer::reductionPercent(2.0f, 1.5f), 25, 0.001f));
+    CHECK(BackflushAnalyzer::reductionPercent(0, 1.5f) == 0);
+}
+
+int main() {
+    testRisingRecovery();
+    testFallingRecovery();
+    testPumpNotRunning();
+    testNoStep();
+    testNeverSettles();
+    testReduction();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
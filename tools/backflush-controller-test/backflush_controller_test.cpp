@@ -0,0 +1,178 @@
+// Drive the firmware's backflush controller with synthetic pressure traces and
+// check its state machine: the transitions after a flush, re-arming only below
+// the hysteresis, no re-trigger while settling or locked out, the daily limit
+// and its reset at local midnight.
+//
+//   backflush_controller_test
+//
+// Prints each failed check and exits with status 1 if there was one.
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o backflush_controller_test backflush_controller_test.cpp ../../src/BackflushController.cpp
+
+#include <stdio.h>
+
+#include "BackflushController.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static const uint32_t DURATION = 30;  // Seconds
+
+static BackflushGuard makeGuard(uint32_t settleSeconds, uint32_t lockoutSeconds, uint8_t maxPerDay) {
+    BackflushGuard guard;
+    guard.threshold = 2.0f;
+    guard.hysteresis = 0.2f;
+    guard.settleSeconds = settleSeconds;
+    guard.lockoutSeconds = lockoutSeconds;
+    guard.maxPerDay = maxPerDay;
+    return guard;
+}
+
+// Feed a constant pressure once a second from `from` up to `to` (ms), returning
+// the number of flushes started
+static int holdPressure(BackflushController& controller, uint32_t from, uint32_t to, float pressure, uint32_t day = 0) {
+    int starts = 0;
+    for (uint32_t now = from; now < to; now += 1000) {
+        if (controller.update(now, pressure, day, DURATION) == BackflushController::START) {
+            starts++;
+        }
+    }
+    return starts;
+}
+
+// Run a flush to its end: START at `now`, STOP after the duration. Returns the end time.
+static uint32_t runFlush(BackflushController& controller, uint32_t now, float pressure, uint32_t day = 0) {
+    CHECK(controller.update(now, pressure, day, DURATION) == BackflushController::START);
+    uint32_t end = now + DURATION * 1000;
+    CHECK(controller.update(end - 1, pressure, day, DURATION) == BackflushController::NONE);
+    CHECK(controller.update(end, pressure, day, DURATION) == BackflushController::STOP);
+    return end;
+}
+
+static void testTransitions() {
+    BackflushController controller;
+    controller.configure(makeGuard(60, 3600, 0));
+
+    CHECK(controller.update(0, 1.5f, 0, DURATION) == BackflushController::NONE);
+    CHECK(controller.getState() == BackflushController::IDLE);
+    CHECK(controller.isArmed());
+
+    CHECK(controller.update(1000, 2.1f, 0, DURATION) == BackflushController::START);
+    CHECK(controller.getState() == BackflushController::FLUSHING);
+    CHECK(!controller.isArmed());
+    CHECK(controller.update(30999, 2.5f, 0, DURATION) == BackflushController::NONE);
+    CHECK(controller.update(31000, 2.5f, 0, DURATION) == BackflushController::STOP);
+    CHECK(controller.getState() == BackflushController::SETTLING);
+
+    // High pressure while settling and locked out starts nothing
+    CHECK(holdPressure(controller, 32000, 91000, 2.5f) == 0);
+    CHECK(controller.getState() == BackflushController::SETTLING);
+    CHECK(holdPressure(controller, 91000, 92000, 2.5f) == 0);
+    CHECK(controller.getState() == BackflushController::LOCKOUT);
+    CHECK(controller.getLockoutRemaining(92000) == 3600 - 61);
+    CHECK(holdPressure(controller, 92000, 31000 + 3600000, 2.5f) == 0);
+    CHECK(controller.getState() == BackflushController::LOCKOUT);
+
+    // After the lockout the trigger stays disarmed until below threshold - hysteresis
+    uint32_t idleAt = 31000 + 3600000;
+    CHECK(controller.update(idleAt, 2.5f, 0, DURATION) == BackflushController::NONE);
+    CHECK(controller.getState() == BackflushController::IDLE);
+    CHECK(!controller.isArmed());
+    CHECK(holdPressure(controller, idleAt + 1000, idleAt + 10000, 1.9f) == 0);
+    CHECK(!controller.isArmed());
+    CHECK(holdPressure(controller, idleAt + 10000, idleAt + 20000, 2.0f) == 0);
+    CHECK(controller.update(idleAt + 20000, 1.79f, 0, DURATION) == BackflushController::NONE);
+    CHECK(controller.isArmed());
+    CHECK(controller.update(idleAt + 21000, 2.0f, 0, DURATION) == BackflushController::START);
+}
+
+static void testRearmDuringLockout() {
+    BackflushController controller;
+    controller.configure(makeGuard(60, 600, 0));
+    uint32_t end = runFlush(controller, 0, 2.2f);
+
+    // Dropping below the hysteresis while locked out arms the trigger, but the
+    // flush waits for the lockout to pass
+    CHECK(holdPressure(controller, end + 61000, end + 120000, 1.5f) == 0);
+    CHECK(controller.isArmed());
+    CHECK(holdPressure(controller, end + 120000, end + 600000, 2.5f) == 0);
+    CHECK(controller.getState() == BackflushController::LOCKOUT);
+    CHECK(controller.update(end + 600000, 2.5f, 0, DURATION) == BackflushController::START);
+}
+
+static void testDailyLimit() {
+    BackflushController controller;
+    controller.configure(makeGuard(0, 0, 2));
+
+    uint32_t now = 0;
+    for (int i = 0; i < 2; i++) {
+        now = runFlush(controller, now, 2.5f) + 1000;
+        CHECK(controller.update(now, 1.0f, 0, DURATION) == BackflushController::NONE);
+        now += 1000;
+    }
+    CHECK(controller.getFlushesToday() == 2);
+    CHECK(controller.isDailyLimitReached());
+    CHECK(holdPressure(controller, now, now + 60000, 2.5f) == 0);
+    now += 60000;
+
+    // Requested flushes bypass the limit and do not count towards it
+    controller.request();
+    now = runFlush(controller, now, 2.5f) + 1000;
+    CHECK(controller.wasRequested());
+    CHECK(controller.getFlushesToday() == 2);
+    CHECK(holdPressure(controller, now, now + 60000, 1.0f) == 0);
+    now += 60000;
+    CHECK(controller.isArmed());
+    CHECK(controller.update(now, 2.5f, 0, DURATION) == BackflushController::NONE);
+    now += 1000;
+
+    // The next day the count starts over
+    CHECK(controller.update(now, 2.5f, 1, DURATION) == BackflushController::START);
+    CHECK(controller.getFlushesToday() == 1);
+    CHECK(!controller.wasRequested());
+}
+
+static void testLocalDay() {
+    // 2023-11-14 00:00 UTC, in a zone two hours ahead of UTC
+    const int64_t midnightUtc = 1699920000;
+    const int32_t offset = 2 * 3600;
+
+    // 22:30 UTC is already the next day locally
+    int64_t gmt = midnightUtc + 22 * 3600 + 1800;
+    CHECK(BackflushController::dayOf(gmt) == midnightUtc / 86400);
+    CHECK(BackflushController::dayOf(gmt + offset) == midnightUtc / 86400 + 1);
+
+    // One flush a day: the one at 23:00 local time uses up the day, and the
+    // limit resets at local midnight, two hours before midnight UTC
+    BackflushController controller;
+    controller.configure(makeGuard(0, 0, 1));
+    int64_t eveningGmt = midnightUtc + 21 * 3600;
+    uint32_t now = runFlush(controller, 0, 2.5f, BackflushController::dayOf(eveningGmt + offset)) + 1000;
+    CHECK(controller.update(now, 1.0f, BackflushController::dayOf(eveningGmt + offset), DURATION) == BackflushController::NONE);
+    CHECK(controller.update(now + 1000, 2.5f, BackflushController::dayOf(eveningGmt + offset), DURATION) == BackflushController::NONE);
+    CHECK(controller.isDailyLimitReached());
+
+    int64_t afterMidnightGmt = midnightUtc + 22 * 3600 + 1800;
+    CHECK(controller.update(now + 2000, 2.5f, BackflushController::dayOf(afterMidnightGmt + offset), DURATION) == BackflushController::START);
+}
+
+int main() {
+    testTransitions();
+    testRearmDuringLockout();
+    testDailyLimit();
+    testLocalDay();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
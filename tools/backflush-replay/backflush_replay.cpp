@@ -0,0 +1,123 @@
+// Replay a recorded backflush pressure trace through the adaptive duration logic
+// of the firmware and report when it would have stopped the flush.
+//
+//   backflush_replay trace.csv [options]
+//
+// The trace is CSV with the time in seconds and the pressure in bar in the first
+// two columns; times are taken relative to the first row and lines that do not
+// parse (e.g. a header) are skipped, so pressure_export output works as is.
+//
+//   --min S      minimum duration (default 20)
+//   --max S      maximum duration (default 120)
+//   --slope B    settled below this many bar/min (default 0.1)
+//   --drop P     ...and at least P percent below the peak (default 10)
+//   --hold S     criteria must hold this long (default 5)
+//   --expect A-B exit with status 1 unless the flush stops between A and B seconds
+//   -v           print the smoothed level and slope for every sample
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o backflush_replay backflush_replay.cpp ../../src/BackflushMonitor.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BackflushMonitor.h"
+
+static void usage() {
+    fprintf(stderr, "Usage: backflush_replay trace.csv [--min S] [--max S] [--slope B] [--drop P] [--hold S] [--expect A-B] [-v]\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+
+    // Same defaults as the firmware settings
+    BackflushCriteria criteria;
+    criteria.minSeconds = 20;
+    criteria.maxSeconds = 120;
+    criteria.maxSlope = 0.1f;
+    criteria.minDropPercent = 10;
+    criteria.holdSeconds = 5;
+
+    float expectFrom = -1, expectTo = -1;
+    bool verbose = false;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "-v")) {
+            verbose = true;
+        } else if (value && !strcmp(arg, "--min")) {
+            criteria.minSeconds = atoi(value); i++;
+        } else if (value && !strcmp(arg, "--max")) {
+            criteria.maxSeconds = atoi(value); i++;
+        } else if (value && !strcmp(arg, "--slope")) {
+            criteria.maxSlope = atof(value); i++;
+        } else if (value && !strcmp(arg, "--drop")) {
+            criteria.minDropPercent = atof(value); i++;
+        } else if (value && !strcmp(arg, "--hold")) {
+            criteria.holdSeconds = atoi(value); i++;
+        } else if (value && !strcmp(arg, "--expect") && sscanf(value, "%f-%f", &expectFrom, &expectTo) == 2) {
+            i++;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    FILE* file = fopen(argv[1], "r");
+    if (!file) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 2;
+    }
+
+    BackflushMonitor monitor;
+    monitor.begin(criteria);
+
+    char line[256];
+    double start = 0;
+    bool haveStart = false;
+    bool stopped = false;
+    float seconds = 0;
+    while (fgets(line, sizeof(line), file)) {
+        double t;
+        float pressure;
+        if (sscanf(line, "%lf,%f", &t, &pressure) != 2) {
+            continue;
+        }
+        if (!haveStart) {
+            start = t;
+            haveStart = true;
+        }
+        seconds = (float)(t - start);
+
+        stopped = monitor.update(seconds, pressure);
+        if (verbose) {
+            printf("%8.1f  %6.3f  level %6.3f  slope %+7.3f bar/min  drop %5.1f%%\n", seconds, pressure,
+                   monitor.getLevel(), monitor.getSlopePerMinute(), monitor.getDropPercent());
+        }
+        if (stopped) {
+            break;
+        }
+    }
+    fclose(file);
+
+    if (!haveStart) {
+        fprintf(stderr, "No samples in %s\n", argv[1]);
+        return 2;
+    }
+
+    if (stopped) {
+        printf("Stopped after %.1f s (%s), level %.3f bar, %.1f%% below peak\n", seconds,
+               BackflushMonitor::stopReasonName(monitor.getStopReason()), monitor.getLevel(), monitor.getDropPercent());
+    } else {
+        printf("Trace ended after %.1f s without stopping\n", seconds);
+    }
+
+    if (expectFrom >= 0 && (!stopped || seconds < expectFrom || seconds > expectTo)) {
+        fprintf(stderr, "Expected a stop between %.1f and %.1f s\n", expectFrom, expectTo);
+        return 1;
+    }
+    return 0;
+}
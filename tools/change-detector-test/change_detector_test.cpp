@@ -0,0 +1,157 @@
+// Feed synthetic pressure traces, one sample a second as in the firmware, to the
+// change-point detector and check the events it reports: pump starts and stops
+// on level steps, none on noise or on a level between the pump off and on
+// thresholds, an abnormal rise on a jump and on a slow sustained rise, and that
+// re-applying the same thresholds keeps the pump state.
+//
+//   change_detector_test
+//
+// Prints each failed check and exits with status 1 if there was one.
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o change_detector_test change_detector_test.cpp ../../src/ChangeDetector.cpp
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ChangeDetector.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// Deterministic noise of +-amplitude
+static float noise(float amplitude) {
+    static uint32_t state = 12345;
+    state = state * 1664525u + 1013904223u;
+    return ((state >> 8) / 16777216.0f * 2 - 1) * amplitude;
+}
+
+struct Events {
+    int started;
+    int stopped;
+    int rises;
+    int firstAt;             // Sample of the first event, -1 if none
+};
+
+// Feed `samples` samples going linearly from `from` to `to` bar, plus noise
+static Events feed(ChangeDetector& detector, int samples, float from, float to, float amplitude = 0.01f) {
+    Events events = {0, 0, 0, -1};
+    for (int i = 0; i < samples; i++) {
+        float pressure = from + (to - from) * i / samples + noise(amplitude);
+        ChangeDetector::Event event = detector.update(pressure);
+        if (event == ChangeDetector::NONE) {
+            continue;
+        }
+        if (events.firstAt < 0) {
+            events.firstAt = i;
+        }
+        if (event == ChangeDetector::PUMP_STARTED) events.started++;
+        if (event == ChangeDetector::PUMP_STOPPED) events.stopped++;
+        if (event == ChangeDetector::ABNORMAL_RISE) events.rises++;
+    }
+    return events;
+}
+
+static ChangeDetector makeDetector() {
+    ChangeDetector detector;
+    detector.configure(0.3f, 0.3f);
+    detector.setPumpOnThreshold(0.2f);
+    return detector;
+}
+
+static void testPumpStartStop() {
+    ChangeDetector detector = makeDetector();
+    Events idle = feed(detector, 120, 0.0f, 0.0f);
+    CHECK(idle.firstAt < 0);
+    CHECK(!detector.isPumpRunning());
+
+    Events start = feed(detector, 120, 1.2f, 1.2f);
+    CHECK(start.started == 1 && start.stopped == 0 && start.rises == 0);
+    CHECK(start.firstAt >= 0 && start.firstAt <= 20);
+    CHECK(detector.isPumpRunning());
+
+    Events stop = feed(detector, 120, 0.0f, 0.0f);
+    CHECK(stop.stopped == 1 && stop.started == 0 && stop.rises == 0);
+    CHECK(stop.firstAt >= 0 && stop.firstAt <= 20);
+    CHECK(!detector.isPumpRunning());
+}
+
+static void testNoiseOnly() {
+    // An hour of running with sensor noise reports nothing
+    ChangeDetector detector = makeDetector();
+    feed(detector, 1, 1.2f, 1.2f);
+    CHECK(detector.isPumpRunning());
+    Events events = feed(detector, 3600, 1.2f, 1.2f, 0.05f);
+    CHECK(events.firstAt < 0);
+}
+
+static void testHysteresis() {
+    // A drop to 0.15 bar is below the pump-on level but not below half of it
+    ChangeDetector detector = makeDetector();
+    feed(detector, 120, 1.2f, 1.2f);
+    Events events = feed(detector, 120, 0.15f, 0.15f, 0.005f);
+    CHECK(events.stopped == 0);
+    CHECK(detector.isPumpRunning());
+}
+
+static void testRiseJump() {
+    ChangeDetector detector = makeDetector();
+    feed(detector, 120, 0.0f, 0.0f);
+    feed(detector, 200, 1.0f, 1.0f);
+    CHECK(detector.hasReference());
+
+    // A jump of more than the rise threshold while running, reported once
+    Events events = feed(detector, 300, 1.5f, 1.5f);
+    CHECK(events.rises == 1 && events.started == 0 && events.stopped == 0);
+}
+
+static void testSlowRise() {
+    // Too gradual for a step, picked up by the CUSUM against the reference
+    ChangeDetector detector = makeDetector();
+    feed(detector, 120, 0.0f, 0.0f);
+    feed(detector, 200, 1.0f, 1.0f);
+    Events ramp = feed(detector, 3600, 1.0f, 1.4f);
+    Events hold = feed(detector, 1800, 1.4f, 1.4f);
+    CHECK(ramp.rises + hold.rises == 1);
+    CHECK(ramp.started + ramp.stopped + hold.started + hold.stopped == 0);
+}
+
+static void testReconfigureKeepsState() {
+    ChangeDetector detector = makeDetector();
+    feed(detector, 120, 0.0f, 0.0f);
+    feed(detector, 120, 1.2f, 1.2f);
+    CHECK(detector.isPumpRunning());
+
+    // Saving the detector settings with only a new pump-on level keeps the state
+    detector.configure(0.3f, 0.3f);
+    detector.setPumpOnThreshold(0.4f);
+    CHECK(detector.isPumpRunning());
+    Events events = feed(detector, 120, 1.2f, 1.2f);
+    CHECK(events.firstAt < 0);
+
+    // New step thresholds start over
+    detector.configure(0.4f, 0.3f);
+    CHECK(!detector.isPumpRunning());
+}
+
+int main() {
+    testPumpStartStop();
+    testNoiseOnly();
+    testHysteresis();
+    testRiseJump();
+    testSlowRise();
+    testReconfigureKeepsState();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
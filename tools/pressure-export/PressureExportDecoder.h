@@ -0,0 +1,74 @@
+#ifndef PRESSUREEXPORTDECODER_H
+#define PRESSUREEXPORTDECODER_H
+
+// Host-side decoder for the binary pressure history served at /api/pressure/export.bin.
+// Fields are decoded byte by byte so the result does not depend on the host's endianness.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+
+#include "PressureRecord.h"
+
+struct DecodedReading {
+    uint32_t timestamp;  // GMT seconds since epoch
+    float pressure;      // bar
+    uint8_t flags;
+};
+
+class PressureExportDecoder {
+private:
+    static uint16_t readU16(const uint8_t* p) {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    static uint32_t readU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+public:
+    // Decode a complete export. Returns false and sets error if the data is not a valid export;
+    // a truncated trailing record (e.g. an interrupted download) is ignored.
+    static bool decode(const std::vector<uint8_t>& data, PressureFileHeader& header,
+                       std::vector<DecodedReading>& readings, std::string& error) {
+        if (data.size() < sizeof(PressureFileHeader)) {
+            error = "file too short for header";
+            return false;
+        }
+
+        const uint8_t* p = data.data();
+        header.magic = readU32(p);
+        header.version = readU16(p + 4);
+        header.headerSize = readU16(p + 6);
+        header.recordSize = readU16(p + 8);
+        header.pressureScale = readU16(p + 10);
+        header.recordCount = readU32(p + 12);
+
+        if (!isValidPressureFileHeader(header)) {
+            error = "not a pressure history export";
+            return false;
+        }
+        if (data.size() < header.headerSize) {
+            error = "file too short for header";
+            return false;
+        }
+
+        size_t available = (data.size() - header.headerSize) / header.recordSize;
+        size_t count = available < header.recordCount ? available : header.recordCount;
+
+        readings.clear();
+        readings.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t* record = p + header.headerSize + i * header.recordSize;
+            DecodedReading reading;
+            reading.timestamp = readU32(record);
+            reading.pressure = decodePressure(readU16(record + 4), header.pressureScale);
+            reading.flags = record[6];
+            readings.push_back(reading);
+        }
+        return true;
+    }
+};
+
+#endif // PRESSUREEXPORTDECODER_H
@@ -0,0 +1,84 @@
+// Convert a /api/pressure/export.bin download to CSV or column files.
+//
+//   pressure_export history.bin              CSV on stdout
+//   pressure_export history.bin -c PREFIX    PREFIX.timestamp.u32, PREFIX.pressure.f32,
+//                                            PREFIX.flags.u8 and PREFIX.schema.txt
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o pressure_export pressure_export.cpp
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iterator>
+
+#include "PressureExportDecoder.h"
+
+static bool writeColumn(const std::string& path, const void* data, size_t size) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, file) == size;
+    fclose(file);
+    return ok;
+}
+
+// Column files are raw arrays in host byte order, one value per reading
+static bool writeColumns(const std::string& prefix, const std::vector<DecodedReading>& readings) {
+    std::vector<uint32_t> timestamps;
+    std::vector<float> pressures;
+    std::vector<uint8_t> flags;
+    for (const auto& reading : readings) {
+        timestamps.push_back(reading.timestamp);
+        pressures.push_back(reading.pressure);
+        flags.push_back(reading.flags);
+    }
+
+    if (!writeColumn(prefix + ".timestamp.u32", timestamps.data(), timestamps.size() * sizeof(uint32_t)) ||
+        !writeColumn(prefix + ".pressure.f32", pressures.data(), pressures.size() * sizeof(float)) ||
+        !writeColumn(prefix + ".flags.u8", flags.data(), flags.size())) {
+        return false;
+    }
+
+    std::string schema = "rows " + std::to_string(readings.size()) + "\n"
+                         "timestamp uint32 seconds since epoch (GMT)\n"
+                         "pressure float32 bar\n"
+                         "flags uint8\n";
+    return writeColumn(prefix + ".schema.txt", schema.data(), schema.size());
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2 && !(argc == 4 && strcmp(argv[2], "-c") == 0)) {
+        fprintf(stderr, "Usage: %s <export.bin> [-c <prefix>]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    PressureFileHeader header;
+    std::vector<DecodedReading> readings;
+    std::string error;
+    if (!PressureExportDecoder::decode(data, header, readings, error)) {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+    if (readings.size() < header.recordCount) {
+        fprintf(stderr, "Warning: export truncated, %zu of %u records\n", readings.size(), (unsigned)header.recordCount);
+    }
+
+    if (argc == 4) {
+        return writeColumns(argv[3], readings) ? 0 : 1;
+    }
+
+    printf("timestamp,pressure,flags\n");
+    for (const auto& reading : readings) {
+        printf("%u,%.3f,%u\n", (unsigned)reading.timestamp, reading.pressure, (unsigned)reading.flags);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Check the relay on-time error statistics that RelayTimer keeps: the error of
+// runs stopped by the loop (slightly early) and by the timer (late), across a
+// wrap of micros(), the histogram buckets, early stops and the reset.
+//
+//   relay_timing_test
+//
+// Prints each failed check and exits with status 1 if there was one.
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o relay_timing_test relay_timing_test.cpp ../../src/RelayTimingStats.cpp
+
+#include <stdio.h>
+
+#include "RelayTimingStats.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static const uint32_t DURATION = 30000000;  // 30 s in us
+
+static void testErrors() {
+    RelayTimingStats stats;
+
+    // The loop reaches the deadline 200 us before the timer
+    stats.recordRun(1000, 1000 + DURATION - 200, DURATION, false);
+    // The interrupt switches off 50 us late
+    stats.recordRun(5000, 5000 + DURATION + 50, DURATION, true);
+    stats.recordEarlyStop();
+
+    CHECK(stats.count == 2);
+    CHECK(stats.timerCount == 1);
+    CHECK(stats.earlyStops == 1);
+    CHECK(stats.minMicros == -200);
+    CHECK(stats.maxMicros == 50);
+    CHECK(stats.getAverageMicros() == -75);
+    CHECK(stats.histogram[0] == 1);   // Early offs count with the smallest errors
+    CHECK(stats.histogram[5] == 1);   // 50 us is in [32, 64)
+}
+
+static void testWrap() {
+    // micros() wraps between on and off
+    RelayTimingStats stats;
+    uint32_t on = 0xFFFFFFFFu - 1000000;
+    stats.recordRun(on, on + DURATION + 3000, DURATION, true);
+    CHECK(stats.count == 1);
+    CHECK(stats.minMicros == 3000 && stats.maxMicros == 3000);
+    CHECK(stats.histogram[11] == 1);  // [2048, 4096)
+}
+
+static void testLastBucket() {
+    // A stall of a second lands in the last bucket
+    RelayTimingStats stats;
+    stats.recordRun(0, DURATION + 1000000, DURATION, true);
+    CHECK(stats.histogram[RelayTimingStats::HISTOGRAM_BUCKETS - 1] == 1);
+    CHECK(stats.maxMicros == 1000000);
+}
+
+static void testReset() {
+    RelayTimingStats stats;
+    stats.recordRun(0, DURATION + 10, DURATION, true);
+    stats.recordEarlyStop();
+    stats.reset();
+    CHECK(stats.count == 0 && stats.timerCount == 0 && stats.earlyStops == 0);
+    CHECK(stats.getAverageMicros() == 0);
+    uint32_t total = 0;
+    for (size_t i = 0; i < RelayTimingStats::HISTOGRAM_BUCKETS; i++) {
+        total += stats.histogram[i];
+    }
+    CHECK(total == 0);
+
+    // The first run after a reset sets both min and max
+    stats.recordRun(0, DURATION + 7, DURATION, false);
+    CHECK(stats.minMicros == 7 && stats.maxMicros == 7);
+}
+
+int main() {
+    testErrors();
+    testWrap();
+    testLastBucket();
+    testReset();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Compare the cost of finding the next backflush schedule fire time with the
+// previous mktime based search and with the firmware's calendar arithmetic, and
+// check that both agree.
+//
+//   scheduler_bench [iterations]
+//
+// The firmware computes fire times with nextScheduleTime() only when a schedule
+// fires or the schedules or the clock change; every other check is a comparison
+// against the cached time, which is also measured.
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o scheduler_bench scheduler_bench.cpp ../../src/BackflushSchedule.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include <vector>
+
+#include "BackflushSchedule.h"
+
+// Search used before the fire times were cached, as a reference
+static time_t legacyNextScheduleTime(const BackflushSchedule& schedule, time_t currentTime) {
+    static const int DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    struct tm currentTm;
+    localtime_r(&currentTime, &currentTm);
+    int currentYear = currentTm.tm_year + 1900;
+    int currentMonth = currentTm.tm_mon + 1;
+
+    struct tm nextTm = currentTm;
+    nextTm.tm_hour = schedule.hour;
+    nextTm.tm_min = schedule.minute;
+    nextTm.tm_sec = 0;
+
+    switch (schedule.type) {
+        case ScheduleType::DAILY: {
+            time_t next = mktime(&nextTm);
+            return next <= currentTime ? next + 86400 : next;
+        }
+        case ScheduleType::WEEKLY: {
+            time_t baseTime = mktime(&nextTm);
+            if (baseTime <= currentTime) {
+                nextTm.tm_mday++;
+                baseTime = mktime(&nextTm);
+            }
+            for (int i = 0; i < 7; i++) {
+                struct tm checkTm;
+                localtime_r(&baseTime, &checkTm);
+                if (schedule.daysActive & (1 << checkTm.tm_wday)) {
+                    return baseTime;
+                }
+                baseTime += 86400;
+            }
+            return 0;
+        }
+        case ScheduleType::MONTHLY: {
+            for (int monthOffset = 0; monthOffset < 12; monthOffset++) {
+                int checkYear = currentYear + (currentMonth + monthOffset - 1) / 12;
+                int checkMonth = ((currentMonth - 1 + monthOffset) % 12) + 1;
+                int days = DAYS_IN_MONTH[checkMonth - 1];
+                if (checkMonth == 2 && (checkYear % 400 == 0 || (checkYear % 100 != 0 && checkYear % 4 == 0))) {
+                    days = 29;
+                }
+                for (int day = 1; day <= days; day++) {
+                    if (monthOffset == 0 && day < currentTm.tm_mday) {
+                        continue;
+                    }
+                    if (schedule.daysActive & (1 << (day - 1))) {
+                        struct tm matchTm = nextTm;
+                        matchTm.tm_year = checkYear - 1900;
+                        matchTm.tm_mon = checkMonth - 1;
+                        matchTm.tm_mday = day;
+                        time_t matchTime = mktime(&matchTm);
+                        if (matchTime > currentTime) {
+                            return matchTime;
+                        }
+                    }
+                }
+            }
+            return 0;
+        }
+        case ScheduleType::CRON:
+            return 0;
+    }
+    return 0;
+}
+
+static BackflushSchedule randomSchedule() {
+    BackflushSchedule schedule;
+    schedule.enabled = true;
+    schedule.type = (ScheduleType)(rand() % 3);
+    schedule.hour = rand() % 24;
+    schedule.minute = rand() % 60;
+    schedule.daysActive = schedule.type == ScheduleType::WEEKLY ? (rand() % 127) + 1 : (rand() % 0x7FFFFFFF) + 1;
+    compileSchedule(schedule);
+    return schedule;
+}
+
+template <typename F>
+static double nanosPerCall(long iterations, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        f(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: scheduler_bench [iterations]\n");
+        return 2;
+    }
+
+    // Times are local seconds, as on the device where the C library runs in UTC
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    const size_t CASES = 1024;
+    std::vector<BackflushSchedule> schedules;
+    std::vector<time_t> times;
+    srand(1);
+    for (size_t i = 0; i < CASES; i++) {
+        schedules.push_back(randomSchedule());
+        times.push_back(1700000000 + (time_t)(rand() % (20 * 366)) * 86400 + rand() % 86400);
+    }
+
+    // Both must agree before their speed means anything
+    size_t mismatches = 0;
+    for (size_t i = 0; i < CASES; i++) {
+        time_t expected = legacyNextScheduleTime(schedules[i], times[i]);
+        time_t actual = nextScheduleTime(schedules[i], times[i]);
+        if (expected != actual) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "Mismatch for type %d %02d:%02d days 0x%08x at %ld: %ld != %ld\n",
+                        (int)schedules[i].type, schedules[i].hour, schedules[i].minute,
+                        (unsigned)schedules[i].daysActive, (long)times[i], (long)actual, (long)expected);
+            }
+        }
+    }
+
+    volatile time_t sink = 0;
+    double legacy = nanosPerCall(iterations, [&](long i) {
+        sink = sink + legacyNextScheduleTime(schedules[i % CASES], times[i % CASES]);
+    });
+    double computed = nanosPerCall(iterations, [&](long i) {
+        sink = sink + nextScheduleTime(schedules[i % CASES], times[i % CASES]);
+    });
+    time_t cached = nextScheduleTime(schedules[0], times[0]);
+    double check = nanosPerCall(iterations, [&](long i) {
+        sink = sink + (times[i % CASES] >= cached);
+    });
+
+    printf("mktime search:     %10.1f ns/call\n", legacy);
+    printf("calendar compute:  %10.1f ns/call\n", computed);
+    printf("cached check:      %10.1f ns/call\n", check);
+    printf("%zu cases, %zu mismatches\n", CASES, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+// Drive the firmware's task scheduler with a simulated clock and check its timer
+// wheel: run counts and priority order, skipped periods after a late run,
+// setPeriod and setEnabled while a task is queued, the idle time to tasks more
+// than a revolution ahead or already due, and the wrap of millis().
+//
+//   task_scheduler_test
+//
+// Prints each failed check and exits with status 1 if there was one.
+//
+// Build: g++ -std=c++17 -O2 -I../../src -o task_scheduler_test task_scheduler_test.cpp ../../src/TaskScheduler.cpp
+
+#include <stdio.h>
+#include <string>
+
+#include "TaskScheduler.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// The tasks take no time unless a test advances the clock from a callback
+static unsigned long fakeMicros = 0;
+
+static unsigned long readClock() {
+    return fakeMicros;
+}
+
+// Call run() every millisecond from `from` up to `to`, returning the number of runs
+static size_t runEveryMs(TaskScheduler& scheduler, uint32_t from, uint32_t to) {
+    size_t ran = 0;
+    for (uint32_t now = from; now != to; now++) {
+        ran += scheduler.run(now);
+    }
+    return ran;
+}
+
+static void testPeriodsAndPriority() {
+    TaskScheduler scheduler(readClock);
+    std::string order;
+    int slow = scheduler.addTask("slow", 250, [&]() { order += 's'; }, 0, TaskScheduler::PRIORITY_LOW);
+    int fast = scheduler.addTask("fast", 100, [&]() { order += 'f'; }, 0, TaskScheduler::PRIORITY_NORMAL);
+    int urgent = scheduler.addTask("urgent", 500, [&]() { order += 'u'; }, 0, TaskScheduler::PRIORITY_HIGH);
+
+    // All three are due at 0 and run by priority, not in the order they were added
+    CHECK(scheduler.run(0) == 3);
+    CHECK(order == "ufs");
+
+    runEveryMs(scheduler, 1, 1001);
+    CHECK(scheduler.getStats(fast).runs == 11);
+    CHECK(scheduler.getStats(slow).runs == 5);
+    CHECK(scheduler.getStats(urgent).runs == 3);
+    CHECK(scheduler.getStats(fast).skipped == 0);
+    CHECK(scheduler.getStats(fast).worstLateness == 0);
+    CHECK(scheduler.getStats(fast).overruns == 0);
+}
+
+static void testSkippedPeriods() {
+    TaskScheduler scheduler(readClock);
+    int id = scheduler.addTask("sensor", 100, []() {}, 0);
+    CHECK(scheduler.run(0) == 1);
+
+    // Due at 100, but the loop only gets back at 550: one late run, the periods
+    // at 200-500 are skipped and the phase is kept
+    CHECK(scheduler.run(550) == 1);
+    const TaskStats& stats = scheduler.getStats(id);
+    CHECK(stats.runs == 2);
+    CHECK(stats.skipped == 4);
+    CHECK(stats.worstLateness == 450);
+    CHECK(stats.overruns == 1);
+    CHECK(scheduler.getIdleTime(550) == 50);
+    CHECK(scheduler.run(599) == 0);
+    CHECK(scheduler.run(600) == 1);
+    CHECK(stats.skipped == 4);
+
+    // A run that takes longer than the deadline is an overrun even if it started on time
+    TaskScheduler timed(readClock);
+    int slowTask = timed.addTask("slow", 100, []() { fakeMicros += 30000; }, 0, TaskScheduler::PRIORITY_NORMAL, 20);
+    timed.run(0);
+    CHECK(timed.getStats(slowTask).overruns == 1);
+    CHECK(timed.getStats(slowTask).lastMicros == 30000);
+}
+
+static void testSetPeriodWhileQueued() {
+    TaskScheduler scheduler(readClock);
+    int id = scheduler.addTask("web", 100, []() {}, 0);
+    scheduler.run(0);
+
+    // Queued for 100; slowing it down at 50 moves it to 50 + 1000
+    scheduler.setPeriod(id, 1000, 50);
+    CHECK(scheduler.getStats(id).period == 1000);
+    CHECK(scheduler.getStats(id).deadline == 1000);
+    CHECK(runEveryMs(scheduler, 50, 1050) == 0);
+    CHECK(scheduler.run(1050) == 1);
+    CHECK(scheduler.getIdleTime(1050) == 1000);
+
+    // Speeding it up again while queued takes effect at once
+    scheduler.setPeriod(id, 20, 1100);
+    CHECK(scheduler.getIdleTime(1100) == 20);
+    CHECK(runEveryMs(scheduler, 1100, 1200) == 4);
+
+    // A task may change its own period from its callback
+    TaskScheduler self(readClock);
+    int selfId = -1;
+    selfId = self.addTask("self", 100, [&]() { self.setPeriod(selfId, 300, 0); }, 0);
+    self.run(0);
+    CHECK(self.getIdleTime(0) == 300);
+    CHECK(runEveryMs(self, 1, 300) == 0);
+    CHECK(self.run(300) == 1);
+}
+
+static void testSetEnabledWhileQueued() {
+    TaskScheduler scheduler(readClock);
+    int id = scheduler.addTask("display", 100, []() {}, 0);
+    scheduler.run(0);
+
+    // Disabled while queued it never runs, and nothing else is waiting
+    scheduler.setEnabled(id, false, 30);
+    CHECK(runEveryMs(scheduler, 30, 500) == 0);
+    CHECK(scheduler.getIdleTime(500) == UINT32_MAX);
+
+    // Enabled again it is due at once and then keeps its new phase
+    scheduler.setEnabled(id, true, 500);
+    CHECK(scheduler.getIdleTime(500) == 0);
+    CHECK(scheduler.run(500) == 1);
+    CHECK(scheduler.getIdleTime(500) == 100);
+
+    // Enabling a task that is already queued leaves its due time alone
+    scheduler.setEnabled(id, true, 550);
+    CHECK(scheduler.getIdleTime(550) == 50);
+
+    // A task disabled by one due at the same time does not run
+    TaskScheduler pair(readClock);
+    int second = -1;
+    pair.addTask("first", 100, [&]() { pair.setEnabled(second, false, 0); }, 0, TaskScheduler::PRIORITY_HIGH);
+    second = pair.addTask("second", 100, []() {}, 0);
+    CHECK(pair.run(0) == 1);
+    CHECK(pair.getStats(second).runs == 0);
+}
+
+static void testIdleTime() {
+    TaskScheduler scheduler(readClock);
+    scheduler.addTask("backflush", 2000, []() {}, 0);
+    scheduler.run(0);
+
+    // More than a revolution (640 ms) ahead
+    CHECK(scheduler.getIdleTime(0) == 2000);
+    CHECK(scheduler.getIdleTime(10) == 1990);
+
+    // Exactly a revolution ahead lands in the slot of now, which must not count
+    // as this revolution
+    scheduler.addTask("revolution", 640, []() {}, 0);
+    scheduler.run(0);
+    CHECK(scheduler.getIdleTime(5) == 635);
+    CHECK(scheduler.getIdleTime(639) == 1);
+
+    // Several tasks in the same slot: the earliest one
+    TaskScheduler slot(readClock);
+    slot.addTask("a", 107, []() {}, 0);
+    slot.addTask("b", 103, []() {}, 0);
+    slot.run(0);
+    CHECK(slot.getIdleTime(0) == 103);
+
+    // A task that became due after run() while the clock moved on into a later
+    // slot is due now, even if another one is due shortly
+    TaskScheduler late(readClock);
+    late.addTask("a", 20, []() {}, 0);
+    late.addTask("b", 50, []() {}, 0);
+    late.run(0);
+    CHECK(late.getIdleTime(35) == 0);
+    CHECK(late.run(35) == 1);
+    CHECK(late.getIdleTime(35) == 5);
+
+    // After a stall of more than a revolution everything overdue is due now
+    CHECK(late.getIdleTime(2000) == 0);
+    CHECK(late.run(2000) == 2);
+    CHECK(late.getIdleTime(2000) == 20);
+}
+
+static void testMillisWrap() {
+    const uint32_t start = UINT32_MAX - 500;
+    TaskScheduler scheduler(readClock);
+    int sensor = scheduler.addTask("sensor", 100, []() {}, start);
+    int slow = scheduler.addTask("slow", 1000, []() {}, start);
+
+    // Every run through the wrap, on time
+    CHECK(runEveryMs(scheduler, start, start + 2001) == 21 + 3);
+    CHECK(scheduler.getStats(sensor).runs == 21);
+    CHECK(scheduler.getStats(sensor).skipped == 0);
+    CHECK(scheduler.getStats(sensor).worstLateness == 0);
+    CHECK(scheduler.getStats(slow).runs == 3);
+
+    // The idle time just before the wrap to a task just after it
+    TaskScheduler idle(readClock);
+    idle.addTask("sensor", 100, []() {}, UINT32_MAX - 49);
+    idle.run(UINT32_MAX - 49);
+    CHECK(idle.getIdleTime(UINT32_MAX - 10) == 61);
+    CHECK(idle.getIdleTime(UINT32_MAX) == 51);
+    CHECK(idle.run(49) == 0);
+    CHECK(idle.run(50) == 1);
+
+    // A late run across the wrap skips the periods in between
+    CHECK(idle.run(520) == 1);
+    CHECK(idle.getStats(0).skipped == 3);
+    CHECK(idle.getIdleTime(520) == 30);
+}
+
+int main() {
+    testPeriodsAndPriority();
+    testSkippedPeriods();
+    testSetPeriodWhileQueued();
+    testSetEnabledWhileQueued();
+    testIdleTime();
+    testMillisWrap();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}